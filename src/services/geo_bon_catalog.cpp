@@ -4,8 +4,26 @@
 #include "util/curl.h"
 
 #include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <thread>
 #include <util/log.h>
 #include <util/netcdf_parser.h>
+#include <util/ebv_batch.h>
+#include <util/ebv_difference.h>
+#include <util/file_status.h>
+#include <util/ebv_metadata_cache.h>
+#include <util/ebv_prefetcher.h>
+#include <util/ebv_raster_reader.h>
+#include <util/ebv_reader_pool.h>
+#include <util/ebv_reprojector.h>
+#include <util/ebv_response_cache.h>
+#include <util/http_compression.h>
 #include <util/stringsplit.h>
 #include <boost/algorithm/string.hpp>
 
@@ -21,31 +39,76 @@ class GeoBonCatalogService : public HTTPService {
         };
 
     protected:
+        /// Readers of EBV files, opened at most once for all (sub-)requests of one HTTP request.
+        /// A reader is opened again once its file was modified, since long-lived handles outlast rewrites of the file.
+        class FileHandles {
+            public:
+                auto raster_reader(const std::string &ebv_file) -> std::shared_ptr<const EbvRasterReader>;
+
+            private:
+                struct RasterReader {
+                    std::shared_ptr<const EbvRasterReader> reader;
+                    FileStatus file_status;
+                };
+
+                std::mutex mutex;
+                std::map<std::string, RasterReader> raster_readers;
+        };
+
         /// Dispatch requests
         void run() override;
 
+        /// Dispatch a single request, given by its parameters
+        auto dispatch(UserDB::User &user, const Parameters &request_params, FileHandles &file_handles) const -> Json::Value;
+
+        /// Run a JSON array of requests with one session and shared file handles
+        auto batch(UserDB::User &user, const std::string &requests_json) const -> Json::Value;
+
         /// Load and return an ID specified EBV dataset from the catalog
-        void dataset(const std::string &id) const;
+        auto dataset(const std::string &id) const -> Json::Value;
 
         /// Load and return all EBV classes from the catalog
-        void classes() const;
+        auto classes() const -> Json::Value;
 
         /// Load and return all EBV datasets from the catalog
-        void datasets(UserDB::User &user, const std::string &ebv_name) const;
+        auto datasets(UserDB::User &user, const std::string &ebv_name) const -> Json::Value;
 
         /// Extract and return EBV dataset subgroups
-        void subgroups(UserDB::User &user, const std::string &ebv_file) const;
+        auto subgroups(const std::string &ebv_file) const -> Json::Value;
 
         /// Extract and return EBV subgroup values
-        void subgroup_values(UserDB::User &user,
-                             const std::string &ebv_file,
+        auto subgroup_values(const std::string &ebv_file,
                              const std::string &ebv_subgroup,
-                             const std::vector<std::string> &ebv_group_path) const;
+                             const std::vector<std::string> &ebv_group_path) const -> Json::Value;
 
         /// Extract and return meta data for loading the dataset
-        void data_loading_info(UserDB::User &user,
-                               const std::string &ebv_file,
-                               const std::vector<std::string> &ebv_entity_path) const;
+        auto data_loading_info(const std::string &ebv_file,
+                               const std::vector<std::string> &ebv_entity_path) const -> Json::Value;
+
+        /// Extract and return a spatial window of an entity at one time step
+        auto entity_tile(const std::string &ebv_file,
+                         const std::vector<std::string> &ebv_entity_path,
+                         size_t time_index,
+                         const Parameters &request_params,
+                         FileHandles &file_handles) const -> Json::Value;
+
+        /// Extract and return an entity at one time step, reprojected to a raster of `width` x `height` pixels that
+        /// covers `bbox` in `crs`
+        auto reprojected_entity_tile(const std::string &ebv_file,
+                                     const std::vector<std::string> &ebv_entity_path,
+                                     size_t time_index,
+                                     const Parameters &request_params,
+                                     FileHandles &file_handles) const -> Json::Value;
+
+        /// Compare two entities, of one or two files, block by block.
+        /// Only used within batches, which hold all results, so the window must not exceed `ebv.tile.max_size`.
+        auto entity_difference(UserDB::User &user, const Parameters &request_params, FileHandles &file_handles) const -> Json::Value;
+
+        /// Send the result of `entity_difference` block by block, as it is computed
+        void streamEntityDifference(UserDB::User &user, HttpCompression::Encoding encoding) const;
+
+        /// Serve a request of the service in a process of the reader pool
+        static auto serve_reader_request(const EbvReaderPool::Message &request) -> EbvReaderPool::Message;
 
     private:
         struct EbvClass {
@@ -68,10 +131,77 @@ class GeoBonCatalogService : public HTTPService {
 
         static auto hasUserPermissions(UserDB::User &user, const std::string &ebv_file) -> bool;
 
+        static void checkUserPermissions(UserDB::User &user, const std::string &ebv_file);
+
         static void addUserPermissions(UserDB::User &user, const std::string &ebv_file);
 
         static auto requestJsonFromUrl(const std::string &url) -> Json::Value;
 
+        /// The encoding of the response, negotiated with the `Accept-Encoding` header in the FastCGI environment of the
+        /// request, which `HTTPService` provides
+        auto responseEncoding() const -> HttpCompression::Encoding;
+
+        /// Requests whose response only depends on the file and the parameters, see `responseCacheKey`
+        static auto isCacheableRequest(const std::string &request) -> bool;
+
+        static auto responseCacheKey(const Parameters &request_params) -> std::string;
+
+        /// Send a successful result, compressing it while it is serialized
+        void sendSuccessJSON(Json::Value &result, HttpCompression::Encoding encoding) const;
+
+        /// Send a serialized JSON body as it is stored
+        void sendBody(const EbvResponseCache::Body &body) const;
+
+        void sendJSONHeaders(HttpCompression::Encoding encoding) const;
+
+        /// Read a window of an entity, if it was not read ahead by the prefetcher
+        static auto readEntityTile(const std::string &ebv_file,
+                                   const std::vector<std::string> &ebv_entity_path,
+                                   size_t time_index,
+                                   int x, int y, int width, int height,
+                                   FileHandles &file_handles) -> EbvRasterReader::Tile;
+
+        /// Read a window of an entity in the reader pool, if it is running, and in this process otherwise
+        static auto readEntityTileUncached(const EbvPrefetcher::TileKey &key, FileHandles &file_handles) -> EbvRasterReader::Tile;
+
+        /// Read a tile on a thread of the prefetcher, only in a reader of the pool that is idle.
+        /// Reads ahead never run in this process, where they would hold locks of HDF5 that requests wait for.
+        static auto prefetchTile(const EbvPrefetcher::TileKey &key) -> EbvRasterReader::Tile;
+
+        static auto tileRequest(const EbvPrefetcher::TileKey &key) -> EbvReaderPool::Message;
+
+        static auto tileFromResponse(const EbvReaderPool::Message &response) -> EbvRasterReader::Tile;
+
+        /// Let the prefetcher read the tiles that the session will likely request after `key`, unless its `window` exceeds
+        /// `ebv.prefetch.max_size`
+        void recordTileAccess(const EbvPrefetcher::TileKey &key, const EbvRasterReader::Window &window) const;
+
+        /// Read a window of an entity, a negative `width` or `height` extends the window to the edge of the grid
+        static auto readTile(const EbvRasterReader &reader,
+                             const std::vector<std::string> &ebv_entity_path,
+                             size_t time_index,
+                             int x, int y, int width, int height) -> EbvRasterReader::Tile;
+
+        /// Operands and blocks of an `entity_difference` request
+        struct DifferenceRequest {
+            std::string operation_name;
+            EbvDifference::Operation operation;
+            EbvRasterReader::Window window;
+            size_t block_height;
+            size_t block_width;
+            EbvDifference::Read first;
+            EbvDifference::Read second;
+
+            /// Everything but the blocks
+            auto to_json() const -> Json::Value;
+        };
+
+        auto differenceRequest(UserDB::User &user,
+                               const Parameters &request_params,
+                               FileHandles &file_handles) const -> DifferenceRequest;
+
+        static auto tileToJson(const EbvRasterReader::Tile &tile) -> Json::Value;
+
         static auto combinePaths(const std::string &first, const std::string &second) -> std::string;
 
         template<class T>
@@ -83,37 +213,256 @@ REGISTER_HTTP_SERVICE(GeoBonCatalogService, "geo_bon_catalog"); // NOLINT(cert-e
 
 void GeoBonCatalogService::run() {
     try {
+        // before the warm-up, since forking copies only this thread
+        const auto reader_processes = Configuration::get<int>("ebv.reader_pool.processes", 0);
+        if (reader_processes > 0) {
+            EbvReaderPool::instance().start(
+                    static_cast<size_t>(reader_processes),
+                    &GeoBonCatalogService::serve_reader_request,
+                    std::chrono::milliseconds(Configuration::get<int>("ebv.reader_pool.timeout_ms", 60000))
+            );
+        }
+
+        if (Configuration::get<bool>("ebv.warm_up.enabled", false)) {
+            EbvMetadataCache::instance().warm_up_in_background(
+                    Configuration::get<std::string>("ebv.path"),
+                    static_cast<size_t>(Configuration::get<int>("ebv.warm_up.threads", 4))
+            );
+        }
+
+        static std::once_flag configure_flag;
+        std::call_once(configure_flag, []() {
+            EbvResponseCache::instance().configure(
+                    static_cast<size_t>(Configuration::get<int>("ebv.response_cache.max_bytes", 64 << 20)),
+                    static_cast<size_t>(Configuration::get<int>("ebv.compression.min_bytes", 1024)),
+                    Configuration::get<int>("ebv.compression.level", 6)
+            );
+            EbvReprojector::instance().configure(
+                    static_cast<size_t>(Configuration::get<int>("ebv.reprojection.max_bytes", 64 << 20)),
+                    static_cast<size_t>(Configuration::get<int>("ebv.reprojection.grid_step", 16))
+            );
+
+            if (Configuration::get<bool>("ebv.prefetch.enabled", false)) {
+                // in this process, reads ahead would hold the locks of HDF5 that requests wait for
+                if (EbvReaderPool::instance().is_running()) {
+                    EbvPrefetcher::instance().start(
+                            static_cast<size_t>(Configuration::get<int>("ebv.prefetch.threads", 1)),
+                            static_cast<size_t>(Configuration::get<int>("ebv.prefetch.max_bytes", 128 << 20)),
+                            static_cast<size_t>(Configuration::get<int>("ebv.prefetch.time_steps_ahead", 2)),
+                            &GeoBonCatalogService::prefetchTile
+                    );
+                } else {
+                    Log::info("GeoBonCatalogService: Prefetching requires the reader pool");
+                }
+            }
+        });
+
         const auto session = UserDB::loadSession(params.get("sessiontoken"));
+        const auto encoding = responseEncoding();
 
-        const std::string &request = params.get("request");
-
-        if (request == "dataset") {
-          this->dataset(params.get("id"));
-        } else if (request == "classes") {
-            this->classes();
-        } else if (request == "datasets") {
-            this->datasets(session->getUser(), params.get("ebv_name"));
-        } else if (request == "subgroups") {
-            this->subgroups(session->getUser(), params.get("ebv_path"));
-        } else if (request == "subgroup_values") {
-            this->subgroup_values(session->getUser(),
-                                  params.get("ebv_path"),
-                                  params.get("ebv_subgroup"),
-                                  split(params.get("ebv_group_path"), '/'));
-        } else if (request == "data_loading_info") {
-            this->data_loading_info(session->getUser(),
-                                    params.get("ebv_path"),
-                                    split(params.get("ebv_entity_path"), '/'));
-        } else { // FALLBACK
-            response.sendFailureJSON("GeoBonCatalogService: Invalid request");
+        if (isCacheableRequest(params.get("request"))) {
+            const std::string &ebv_file = params.get("ebv_path");
+            checkUserPermissions(session->getUser(), ebv_file);
+
+            auto &cache = EbvResponseCache::instance();
+            const auto key = responseCacheKey(params);
+
+            EbvResponseCache::Body body;
+            if (!cache.get(key, ebv_file, encoding, body)) {
+                const auto file_status = FileStatus::of(ebv_file); // before reading, a modification meanwhile is detected
+
+                FileHandles file_handles;
+                auto result = this->dispatch(session->getUser(), params, file_handles);
+                result["result"] = true;
+
+                Json::FastWriter writer;
+                writer.omitEndingLineFeed();
+                body = cache.put(key, file_status, writer.write(result), encoding);
+            }
+
+            sendBody(body);
+            return;
+        }
+
+        if (params.get("request") == "entity_difference") {
+            streamEntityDifference(session->getUser(), encoding);
+            return;
         }
 
+        Json::Value result;
+        if (params.get("request") == "batch") {
+            result = this->batch(session->getUser(), params.get("requests"));
+        } else {
+            FileHandles file_handles;
+            result = this->dispatch(session->getUser(), params, file_handles);
+        }
+
+        sendSuccessJSON(result, encoding);
     } catch (const std::exception &e) {
+        if (response.hasSentHeaders()) { // a streamed response broke off, its status was already sent
+            Log::warn(concat("GeoBonCatalogService: ", e.what()));
+            return;
+        }
         response.sendFailureJSON(e.what());
     }
 }
 
-void GeoBonCatalogService::dataset(const std::string &id) const { //Development - iDiv - Thomas Bauer
+auto GeoBonCatalogService::dispatch(UserDB::User &user,
+                                    const Parameters &request_params,
+                                    FileHandles &file_handles) const -> Json::Value {
+    const std::string &request = request_params.get("request");
+
+    if (request == "dataset") {
+        return this->dataset(request_params.get("id"));
+    } else if (request == "classes") {
+        return this->classes();
+    } else if (request == "datasets") {
+        return this->datasets(user, request_params.get("ebv_name"));
+    }
+
+    const std::string &ebv_file = request_params.get("ebv_path");
+
+    if (request == "subgroups") {
+        checkUserPermissions(user, ebv_file);
+        return this->subgroups(ebv_file);
+    } else if (request == "subgroup_values") {
+        checkUserPermissions(user, ebv_file);
+        return this->subgroup_values(ebv_file,
+                                     request_params.get("ebv_subgroup"),
+                                     split(request_params.get("ebv_group_path"), '/'));
+    } else if (request == "data_loading_info") {
+        checkUserPermissions(user, ebv_file);
+        return this->data_loading_info(ebv_file,
+                                       split(request_params.get("ebv_entity_path"), '/'));
+    } else if (request == "entity_tile") {
+        checkUserPermissions(user, ebv_file);
+        return this->entity_tile(ebv_file,
+                                 split(request_params.get("ebv_entity_path"), '/'),
+                                 static_cast<size_t>(request_params.getInt("time_index")),
+                                 request_params,
+                                 file_handles);
+    } else if (request == "entity_difference") {
+        return this->entity_difference(user, request_params, file_handles);
+    } else { // FALLBACK
+        throw GeoBonCatalogServiceException("GeoBonCatalogService: Invalid request");
+    }
+}
+
+auto GeoBonCatalogService::batch(UserDB::User &user, const std::string &requests_json) const -> Json::Value {
+    std::vector<EbvBatch::Request> requests;
+    try {
+        requests = EbvBatch::parse(requests_json,
+                                   static_cast<size_t>(Configuration::get<int>("ebv.batch.max_requests", 100)));
+    } catch (const EbvBatch::EbvBatchException &e) {
+        throw GeoBonCatalogServiceException(concat("GeoBonCatalogServiceException: ", e.what()));
+    }
+
+    std::vector<Json::Value> results(requests.size());
+
+    std::vector<Parameters> requests_params(requests.size());
+    std::map<std::string, std::vector<Json::ArrayIndex>> file_requests; // grouped by file
+    std::vector<Json::ArrayIndex> catalog_requests;
+
+    for (Json::ArrayIndex i = 0; i < requests.size(); ++i) {
+        if (!requests[i].error.empty()) { // fails on its own, the others still run
+            results[i] = Json::Value(Json::objectValue);
+            results[i]["success"] = false;
+            results[i]["error"] = concat("GeoBonCatalogServiceException: ", requests[i].error);
+            continue;
+        }
+
+        for (const auto &parameter : requests[i].parameters) {
+            requests_params[i][parameter.first] = parameter.second;
+        }
+
+        if (requests_params[i].hasParam("ebv_path")) {
+            file_requests[requests_params[i].get("ebv_path")].push_back(i);
+        } else {
+            catalog_requests.push_back(i);
+        }
+    }
+
+    FileHandles file_handles;
+
+    auto run_request = [&](Json::ArrayIndex i) {
+        Json::Value result;
+        try {
+            result = this->dispatch(user, requests_params[i], file_handles);
+            result["success"] = true;
+        } catch (const std::exception &e) {
+            result = Json::Value(Json::objectValue);
+            result["success"] = false;
+            result["error"] = e.what();
+        } catch (const H5::Exception &e) {
+            result = Json::Value(Json::objectValue);
+            result["success"] = false;
+            result["error"] = e.getDetailMsg();
+        }
+        results[i] = result;
+    };
+
+    // catalog requests may grant file permissions, so they run first and in order
+    for (const auto i : catalog_requests) {
+        run_request(i);
+    }
+
+    // requests for different files run concurrently, requests for the same file one after another
+    std::vector<const std::vector<Json::ArrayIndex> *> file_groups;
+    for (const auto &entry : file_requests) {
+        file_groups.push_back(&entry.second);
+    }
+
+    hbool_t is_thread_safe = false;
+    H5is_library_threadsafe(&is_thread_safe);
+    const auto number_of_threads = is_thread_safe
+                                   ? std::min<size_t>(file_groups.size(), Configuration::get<int>("ebv.batch.threads", 4))
+                                   : std::min<size_t>(file_groups.size(), 1);
+
+    std::atomic<size_t> next_group(0);
+    auto worker = [&]() {
+        for (auto g = next_group++; g < file_groups.size(); g = next_group++) {
+            for (const auto i : *file_groups[g]) {
+                run_request(i); // distinct indices of `results`, so it needs no lock
+            }
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (size_t t = 1; t < number_of_threads; ++t) {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for (auto &thread : threads) {
+        thread.join();
+    }
+
+    Json::Value results_json(Json::arrayValue);
+    for (auto &result : results) {
+        results_json.append(std::move(result));
+    }
+
+    Json::Value result(Json::objectValue);
+    result["results"] = results_json;
+    return result;
+}
+
+auto GeoBonCatalogService::FileHandles::raster_reader(const std::string &ebv_file) -> std::shared_ptr<const EbvRasterReader> {
+    const auto file_status = FileStatus::of(ebv_file);
+    if (!file_status.exists()) {
+        throw GeoBonCatalogServiceException(concat("GeoBonCatalogServiceException: Unable to open ", ebv_file));
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    auto &raster_reader = raster_readers[ebv_file];
+    if (!raster_reader.reader || raster_reader.file_status != file_status) {
+        raster_reader = RasterReader{std::make_shared<const EbvRasterReader>(ebv_file), file_status};
+    }
+
+    return raster_reader.reader;
+}
+
+auto GeoBonCatalogService::dataset(const std::string &id) const -> Json::Value { //Development - iDiv - Thomas Bauer
     const auto web_service_json = requestJsonFromUrl(combinePaths(
             Configuration::get<std::string>("ebv.webservice_endpoint"),
             concat("datasets/id/", boost::algorithm::replace_all_copy(id, " ", "%20"))
@@ -124,10 +473,10 @@ void GeoBonCatalogService::dataset(const std::string &id) const { //Development
     Json::Value result(Json::objectValue);
     result["dataset"] = dataset;
 
-    response.sendSuccessJSON(result);
+    return result;
 }
 
-void GeoBonCatalogService::classes() const {
+auto GeoBonCatalogService::classes() const -> Json::Value {
     const auto web_service_json = requestJsonFromUrl(combinePaths(
             Configuration::get<std::string>("ebv.webservice_endpoint"),
             "ebv"
@@ -153,10 +502,10 @@ void GeoBonCatalogService::classes() const {
     Json::Value result(Json::objectValue);
     result["classes"] = datasets;
 
-    response.sendSuccessJSON(result);
+    return result;
 }
 
-void GeoBonCatalogService::datasets(UserDB::User &user, const std::string &ebv_name) const {
+auto GeoBonCatalogService::datasets(UserDB::User &user, const std::string &ebv_name) const -> Json::Value {
     const auto web_service_json = requestJsonFromUrl(combinePaths(
             Configuration::get<std::string>("ebv.webservice_endpoint"),
             concat("datasets/ebvName/", boost::algorithm::replace_all_copy(ebv_name, " ", "%20"))
@@ -184,18 +533,14 @@ void GeoBonCatalogService::datasets(UserDB::User &user, const std::string &ebv_n
     Json::Value result(Json::objectValue);
     result["datasets"] = datasets;
 
-    response.sendSuccessJSON(result);
+    return result;
 }
 
-void GeoBonCatalogService::subgroups(UserDB::User &user, const std::string &ebv_file) const {
-    if (!hasUserPermissions(user, ebv_file)) {
-        throw GeoBonCatalogServiceException(concat("GeoBonCatalogServiceException: Missing access rights for ", ebv_file));
-    }
-
-    NetCdfParser net_cdf_parser(ebv_file);
+auto GeoBonCatalogService::subgroups(const std::string &ebv_file) const -> Json::Value {
+    const auto metadata = EbvMetadataCache::instance().get(ebv_file);
 
-    const auto subgroup_names = net_cdf_parser.ebv_subgroups();
-    const auto subgroup_descriptions = net_cdf_parser.ebv_subgroup_descriptions();
+    const auto subgroup_names = metadata->subgroups();
+    const auto subgroup_descriptions = metadata->subgroup_descriptions();
 
     Json::Value subgroups_json(Json::arrayValue);
     for (size_t i = 0; i < subgroup_names.size(); ++i) {
@@ -212,48 +557,486 @@ void GeoBonCatalogService::subgroups(UserDB::User &user, const std::string &ebv_
     Json::Value result(Json::objectValue);
     result["subgroups"] = subgroups_json;
 
-    response.sendSuccessJSON(result);
+    return result;
 }
 
-void GeoBonCatalogService::subgroup_values(UserDB::User &user,
-                                           const std::string &ebv_file,
+auto GeoBonCatalogService::subgroup_values(const std::string &ebv_file,
                                            const std::string &ebv_subgroup,
-                                           const std::vector<std::string> &ebv_group_path) const {
-    if (!hasUserPermissions(user, ebv_file)) {
-        throw GeoBonCatalogServiceException(concat("GeoBonCatalogServiceException: Missing access rights for ", ebv_file));
-    }
-
-    NetCdfParser net_cdf_parser(ebv_file);
-
+                                           const std::vector<std::string> &ebv_group_path) const -> Json::Value {
     Json::Value values(Json::arrayValue);
-    for (const auto &subgroup : net_cdf_parser.ebv_subgroup_values(ebv_subgroup, ebv_group_path)) {
+    for (const auto &subgroup : EbvMetadataCache::instance().subgroup_values(ebv_file, ebv_subgroup, ebv_group_path)) {
         values.append(subgroup.to_json());
     }
 
     Json::Value result(Json::objectValue);
     result["values"] = values;
 
-    response.sendSuccessJSON(result);
+    return result;
 }
 
-void GeoBonCatalogService::data_loading_info(UserDB::User &user,
-                                             const std::string &ebv_file,
-                                             const std::vector<std::string> &ebv_entity_path) const {
-    if (!hasUserPermissions(user, ebv_file)) {
-        throw GeoBonCatalogServiceException(concat("GeoBonCatalogServiceException: Missing access rights for ", ebv_file));
-    }
-
-    NetCdfParser net_cdf_parser(ebv_file);
-    const auto time_info = net_cdf_parser.time_info();
-    const auto unit_range = net_cdf_parser.unit_range(ebv_entity_path);
+auto GeoBonCatalogService::data_loading_info(const std::string &ebv_file,
+                                             const std::vector<std::string> &ebv_entity_path) const -> Json::Value {
+    auto &metadata_cache = EbvMetadataCache::instance();
+    const auto time_info = metadata_cache.time_info(ebv_file);
+    const auto unit_range = metadata_cache.unit_range(ebv_file, ebv_entity_path);
 
     Json::Value result(Json::objectValue);
     result["time_points"] = toJsonArray(time_info.time_points_unix);
     result["delta_unit"] = time_info.delta_unit;
-    result["crs_code"] = net_cdf_parser.crs_as_code();
+    result["crs_code"] = metadata_cache.crs_as_code(ebv_file);
     result["unit_range"] = toJsonArray(std::vector<double>{unit_range[0], unit_range[1]});
 
-    response.sendSuccessJSON(result);
+    return result;
+}
+
+auto GeoBonCatalogService::entity_tile(const std::string &ebv_file,
+                                       const std::vector<std::string> &ebv_entity_path,
+                                       size_t time_index,
+                                       const Parameters &request_params,
+                                       FileHandles &file_handles) const -> Json::Value {
+    if (request_params.hasParam("crs")) {
+        return this->reprojected_entity_tile(ebv_file, ebv_entity_path, time_index, request_params, file_handles);
+    }
+
+    EbvPrefetcher::TileKey key{ebv_file, ebv_entity_path, time_index,
+                               request_params.getInt("x", 0),
+                               request_params.getInt("y", 0),
+                               request_params.getInt("width", -1),
+                               request_params.getInt("height", -1)};
+
+    // windows up to the edge of the grid are resolved before reading, so that their size can be checked
+    if (key.width < 0 || key.height < 0) {
+        const auto metadata = EbvMetadataCache::instance().get(ebv_file);
+        if (metadata->has_geo_reference) {
+            if (key.width < 0) {
+                key.width = static_cast<int>(metadata->geo_reference.width) - key.x;
+            }
+            if (key.height < 0) {
+                key.height = static_cast<int>(metadata->geo_reference.height) - key.y;
+            }
+        }
+    }
+
+    const int max_size = Configuration::get<int>("ebv.tile.max_size", 4096);
+    const auto check_size = [max_size](long width, long height) {
+        if (width > max_size || height > max_size) {
+            throw GeoBonCatalogServiceException(concat("GeoBonCatalogServiceException: `width` and `height` must be at most ", max_size));
+        }
+    };
+    check_size(key.width, key.height);
+
+    const auto tile = readEntityTile(key.file, key.entity_path, key.time_index,
+                                     key.x, key.y, key.width, key.height,
+                                     file_handles);
+
+    // files without coordinates are only checked once the window is resolved
+    check_size(static_cast<long>(tile.window.width), static_cast<long>(tile.window.height));
+
+    recordTileAccess(key, tile.window);
+
+    return tileToJson(tile);
+}
+
+void GeoBonCatalogService::recordTileAccess(const EbvPrefetcher::TileKey &key, const EbvRasterReader::Window &window) const {
+    auto &prefetcher = EbvPrefetcher::instance();
+    if (!prefetcher.is_running()) {
+        return;
+    }
+
+    // the predictions have the same window, large ones would keep the readers busy for too long
+    const auto max_size = static_cast<size_t>(Configuration::get<int>("ebv.prefetch.max_size", 1024));
+    if (window.width > max_size || window.height > max_size) {
+        return;
+    }
+
+    try {
+        const auto metadata = EbvMetadataCache::instance().get(key.file);
+
+        // entities below the same value of the second to last subgroup
+        std::vector<std::vector<std::string>> siblings;
+        if (!key.entity_path.empty() && key.entity_path.size() == metadata->subgroup_names.size()) {
+            const std::vector<std::string> parent_path(key.entity_path.begin(), key.entity_path.end() - 1);
+
+            std::vector<std::string> names;
+            if (metadata->child_names(parent_path, names)) {
+                for (auto &name : names) {
+                    siblings.push_back(parent_path);
+                    siblings.back().push_back(std::move(name));
+                }
+            }
+        }
+
+        prefetcher.record(params.get("sessiontoken"),
+                          key,
+                          metadata->has_time_info ? metadata->time_points.count : 0,
+                          siblings);
+    } catch (const std::exception &e) {
+        Log::warn(concat("GeoBonCatalogService: Not prefetching `", key.file, "` (", e.what(), ")"));
+    }
+}
+
+auto GeoBonCatalogService::entity_difference(UserDB::User &user,
+                                            const Parameters &request_params,
+                                            FileHandles &file_handles) const -> Json::Value {
+    const auto request = differenceRequest(user, request_params, file_handles);
+
+    // unlike the streamed response, all blocks are held until the batch is sent
+    const auto max_size = static_cast<size_t>(Configuration::get<int>("ebv.tile.max_size", 4096));
+    if (request.window.width > max_size || request.window.height > max_size) {
+        throw GeoBonCatalogServiceException(concat("GeoBonCatalogServiceException: `width` and `height` of `entity_difference` "
+                                                   "within a batch must be at most ", max_size));
+    }
+
+    Json::Value blocks(Json::arrayValue);
+    EbvDifference::stream(request.window, request.block_height, request.block_width, request.operation,
+                          request.first, request.second,
+                          [&blocks](const EbvRasterReader::Tile &block) { blocks.append(tileToJson(block)); });
+
+    auto result = request.to_json();
+    result["blocks"] = blocks;
+    return result;
+}
+
+void GeoBonCatalogService::streamEntityDifference(UserDB::User &user, HttpCompression::Encoding encoding) const {
+    FileHandles file_handles;
+    const auto request = differenceRequest(user, params, file_handles);
+
+    HttpCompression::StreamBuffer buffer(
+            response,
+            encoding,
+            static_cast<size_t>(Configuration::get<int>("ebv.compression.min_bytes", 1024)),
+            Configuration::get<int>("ebv.compression.level", 6),
+            [this](HttpCompression::Encoding chosen_encoding) { sendJSONHeaders(chosen_encoding); }
+    );
+    std::ostream stream(&buffer);
+
+    Json::FastWriter writer;
+    writer.omitEndingLineFeed();
+
+    // the object without its closing brace, followed by the blocks as they are computed
+    auto header = request.to_json();
+    header["result"] = true;
+    auto header_json = writer.write(header);
+    header_json.pop_back();
+    stream << header_json << ",\"blocks\":[";
+
+    bool is_first = true;
+    EbvDifference::stream(request.window, request.block_height, request.block_width, request.operation,
+                          request.first, request.second,
+                          [&](const EbvRasterReader::Tile &block) {
+                              stream << (is_first ? "" : ",") << writer.write(tileToJson(block));
+                              is_first = false;
+                          });
+
+    stream << "]}";
+    buffer.finish();
+}
+
+auto GeoBonCatalogService::differenceRequest(UserDB::User &user,
+                                             const Parameters &request_params,
+                                             FileHandles &file_handles) const -> DifferenceRequest {
+    const std::string &first_file = request_params.get("ebv_path");
+    const std::string &first_entity = request_params.get("ebv_entity_path");
+    const auto first_time_index = static_cast<size_t>(request_params.getInt("time_index"));
+
+    // the second operand defaults to the first one, so that only what differs must be given
+    const std::string &second_file = request_params.get("other_ebv_path", first_file);
+    const std::string &second_entity = request_params.get("other_ebv_entity_path", first_entity);
+    const auto second_time_index = static_cast<size_t>(request_params.getInt("other_time_index", static_cast<int>(first_time_index)));
+
+    checkUserPermissions(user, first_file);
+    checkUserPermissions(user, second_file);
+
+    const auto first_entity_path = split(first_entity, '/');
+    const auto second_entity_path = split(second_entity, '/');
+
+    const auto first_reader = file_handles.raster_reader(first_file);
+    const auto grid_size = first_reader->grid_size(first_entity_path);
+    const auto second_grid_size = file_handles.raster_reader(second_file)->grid_size(second_entity_path);
+    if (grid_size.height != second_grid_size.height || grid_size.width != second_grid_size.width) {
+        throw GeoBonCatalogServiceException(concat("GeoBonCatalogServiceException: The grids of the entities differ, ",
+                                                   grid_size.height, "x", grid_size.width, " and ",
+                                                   second_grid_size.height, "x", second_grid_size.width));
+    }
+
+    const int x = request_params.getInt("x", 0);
+    const int y = request_params.getInt("y", 0);
+    const int width = request_params.getInt("width", static_cast<int>(grid_size.width) - x);
+    const int height = request_params.getInt("height", static_cast<int>(grid_size.height) - y);
+    if (x < 0 || y < 0 || width < 0 || height < 0
+        || static_cast<int64_t>(x) + width > static_cast<int64_t>(grid_size.width)
+        || static_cast<int64_t>(y) + height > static_cast<int64_t>(grid_size.height)) {
+        throw GeoBonCatalogServiceException("GeoBonCatalogServiceException: Invalid window");
+    }
+
+    const auto chunk_size = first_reader->chunk_size(first_entity_path);
+    const auto min_block_size = static_cast<size_t>(Configuration::get<int>("ebv.difference.min_block_size", 256));
+
+    const auto reader = [&file_handles](const std::string &file,
+                                        const std::vector<std::string> &entity_path,
+                                        size_t time_index) -> EbvDifference::Read {
+        return [&file_handles, file, entity_path, time_index](const EbvRasterReader::Window &window) {
+            return readEntityTile(file, entity_path, time_index,
+                                  static_cast<int>(window.x_offset), static_cast<int>(window.y_offset),
+                                  static_cast<int>(window.width), static_cast<int>(window.height),
+                                  file_handles);
+        };
+    };
+
+    const std::string operation_name = request_params.get("operation", "difference");
+
+    return DifferenceRequest{
+            .operation_name = operation_name,
+            .operation = EbvDifference::parse_operation(operation_name),
+            .window = EbvRasterReader::Window{
+                    .x_offset = static_cast<size_t>(x),
+                    .y_offset = static_cast<size_t>(y),
+                    .width = static_cast<size_t>(width),
+                    .height = static_cast<size_t>(height),
+            },
+            .block_height = EbvDifference::block_size(chunk_size.height, min_block_size),
+            .block_width = EbvDifference::block_size(chunk_size.width, min_block_size),
+            .first = reader(first_file, first_entity_path, first_time_index),
+            .second = reader(second_file, second_entity_path, second_time_index),
+    };
+}
+
+auto GeoBonCatalogService::DifferenceRequest::to_json() const -> Json::Value {
+    Json::Value result(Json::objectValue);
+    result["operation"] = operation_name;
+    result["x"] = static_cast<Json::UInt64>(window.x_offset);
+    result["y"] = static_cast<Json::UInt64>(window.y_offset);
+    result["width"] = static_cast<Json::UInt64>(window.width);
+    result["height"] = static_cast<Json::UInt64>(window.height);
+    return result;
+}
+
+auto GeoBonCatalogService::tileToJson(const EbvRasterReader::Tile &tile) -> Json::Value {
+    Json::Value result(Json::objectValue);
+    result["x"] = static_cast<Json::UInt64>(tile.window.x_offset);
+    result["y"] = static_cast<Json::UInt64>(tile.window.y_offset);
+    result["width"] = static_cast<Json::UInt64>(tile.window.width);
+    result["height"] = static_cast<Json::UInt64>(tile.window.height);
+    result["empty"] = tile.is_empty;
+
+    if (!tile.is_empty) {
+        Json::Value values(Json::arrayValue);
+        for (const auto value : tile.values) {
+            values.append(std::isnan(value) ? Json::Value(Json::nullValue) : Json::Value(value));
+        }
+        result["values"] = values;
+    }
+
+    return result;
+}
+
+auto GeoBonCatalogService::reprojected_entity_tile(const std::string &ebv_file,
+                                                   const std::vector<std::string> &ebv_entity_path,
+                                                   size_t time_index,
+                                                   const Parameters &request_params,
+                                                   FileHandles &file_handles) const -> Json::Value {
+    const auto bbox = split(request_params.get("bbox"), ',');
+    if (bbox.size() != 4) {
+        throw GeoBonCatalogServiceException("GeoBonCatalogServiceException: `bbox` must be `min_x,min_y,max_x,max_y`");
+    }
+    const EbvReprojector::Bounds bounds{
+            .min_x = std::stod(bbox[0]),
+            .min_y = std::stod(bbox[1]),
+            .max_x = std::stod(bbox[2]),
+            .max_y = std::stod(bbox[3]),
+    };
+
+    const int width = request_params.getInt("width", 256);
+    const int height = request_params.getInt("height", 256);
+    const int max_size = Configuration::get<int>("ebv.reprojection.max_size", 4096);
+    if (width <= 0 || height <= 0 || width > max_size || height > max_size) {
+        throw GeoBonCatalogServiceException(concat("GeoBonCatalogServiceException: `width` and `height` must be between 1 and ", max_size));
+    }
+
+    auto &metadata_cache = EbvMetadataCache::instance();
+    const auto source_crs = metadata_cache.crs_as_code(ebv_file);
+    if (source_crs.empty()) {
+        throw GeoBonCatalogServiceException("GeoBonCatalogServiceException: The CRS of the file has no authority code");
+    }
+    const auto source = metadata_cache.geo_reference(ebv_file);
+
+    const auto grid = EbvReprojector::instance().grid(source_crs, source, request_params.get("crs"), bounds,
+                                                      static_cast<size_t>(width), static_cast<size_t>(height));
+    const auto window = grid->source_window(source.width, source.height);
+
+    // a small target raster of a large `bbox` still reads every source pixel below it
+    const auto max_source_size = static_cast<size_t>(Configuration::get<int>("ebv.tile.max_size", 4096));
+    if (window.width > max_source_size || window.height > max_source_size) {
+        throw GeoBonCatalogServiceException(concat("GeoBonCatalogServiceException: `bbox` covers ", window.width, "x",
+                                                   window.height, " pixels of the file, at most ", max_source_size,
+                                                   " are read per side"));
+    }
+
+    Json::Value result(Json::objectValue);
+    result["crs"] = request_params.get("crs");
+    result["width"] = width;
+    result["height"] = height;
+
+    EbvRasterReader::Tile tile{window, true, {}, std::nanf("")};
+    if (window.width > 0) {
+        tile = readEntityTile(ebv_file, ebv_entity_path, time_index,
+                              static_cast<int>(window.x_offset), static_cast<int>(window.y_offset),
+                              static_cast<int>(window.width), static_cast<int>(window.height),
+                              file_handles);
+    }
+    result["empty"] = tile.is_empty;
+
+    if (!tile.is_empty) {
+        Json::Value values(Json::arrayValue);
+        for (const auto value : EbvReprojector::resample(*grid, tile)) {
+            values.append(std::isnan(value) ? Json::Value(Json::nullValue) : Json::Value(value));
+        }
+        result["values"] = values;
+    }
+
+    return result;
+}
+
+auto GeoBonCatalogService::readEntityTile(const std::string &ebv_file,
+                                          const std::vector<std::string> &ebv_entity_path,
+                                          size_t time_index,
+                                          int x, int y, int width, int height,
+                                          FileHandles &file_handles) -> EbvRasterReader::Tile {
+    const EbvPrefetcher::TileKey key{ebv_file, ebv_entity_path, time_index, x, y, width, height};
+
+    auto &prefetcher = EbvPrefetcher::instance();
+    EbvRasterReader::Tile tile;
+    if (prefetcher.is_running() && prefetcher.get(key, tile)) {
+        return tile;
+    }
+
+    return readEntityTileUncached(key, file_handles);
+}
+
+auto GeoBonCatalogService::readEntityTileUncached(const EbvPrefetcher::TileKey &key,
+                                                  FileHandles &file_handles) -> EbvRasterReader::Tile {
+    auto &reader_pool = EbvReaderPool::instance();
+    if (reader_pool.is_running()) {
+        try {
+            return tileFromResponse(reader_pool.call(key.file, tileRequest(key)));
+        } catch (const EbvReaderPool::WorkerUnavailableException &e) {
+            Log::warn(concat("GeoBonCatalogService: reading `", key.file, "` in-process (", e.what(), ")"));
+        }
+    }
+
+    return readTile(*file_handles.raster_reader(key.file), key.entity_path, key.time_index,
+                    key.x, key.y, key.width, key.height);
+}
+
+auto GeoBonCatalogService::prefetchTile(const EbvPrefetcher::TileKey &key) -> EbvRasterReader::Tile {
+    auto &reader_pool = EbvReaderPool::instance();
+    if (!reader_pool.is_running()) {
+        throw GeoBonCatalogServiceException("GeoBonCatalogService: Reading ahead requires the reader pool");
+    }
+
+    EbvReaderPool::Message response;
+    if (!reader_pool.try_call(key.file, tileRequest(key), response)) {
+        throw GeoBonCatalogServiceException("GeoBonCatalogService: The reader of the file is busy");
+    }
+
+    return tileFromResponse(response);
+}
+
+auto GeoBonCatalogService::tileRequest(const EbvPrefetcher::TileKey &key) -> EbvReaderPool::Message {
+    EbvReaderPool::Message request;
+    request.header["request"] = "entity_tile";
+    request.header["path"] = key.file;
+    request.header["ebv_entity_path"] = boost::algorithm::join(key.entity_path, "/");
+    request.header["time_index"] = static_cast<Json::UInt64>(key.time_index);
+    request.header["x"] = key.x;
+    request.header["y"] = key.y;
+    request.header["width"] = key.width;
+    request.header["height"] = key.height;
+    return request;
+}
+
+auto GeoBonCatalogService::tileFromResponse(const EbvReaderPool::Message &response) -> EbvRasterReader::Tile {
+    EbvRasterReader::Tile tile;
+    tile.window = EbvRasterReader::Window{
+            .x_offset = response.header["x"].asUInt64(),
+            .y_offset = response.header["y"].asUInt64(),
+            .width = response.header["width"].asUInt64(),
+            .height = response.header["height"].asUInt64(),
+    };
+    tile.is_empty = response.header["empty"].asBool();
+    tile.no_data = std::nanf("");
+    tile.values.resize(response.payload.size() / sizeof(float));
+    std::memcpy(tile.values.data(), response.payload.data(), tile.values.size() * sizeof(float));
+    return tile;
+}
+
+auto GeoBonCatalogService::readTile(const EbvRasterReader &reader,
+                                    const std::vector<std::string> &ebv_entity_path,
+                                    size_t time_index,
+                                    int x, int y, int width, int height) -> EbvRasterReader::Tile {
+    const auto grid_size = reader.grid_size(ebv_entity_path);
+
+    if (width < 0) {
+        width = static_cast<int>(grid_size.width) - x;
+    }
+    if (height < 0) {
+        height = static_cast<int>(grid_size.height) - y;
+    }
+    if (x < 0 || y < 0 || width < 0 || height < 0) {
+        throw GeoBonCatalogServiceException("GeoBonCatalogServiceException: Invalid tile window");
+    }
+
+    return reader.read(ebv_entity_path, time_index, EbvRasterReader::Window{
+            .x_offset = static_cast<size_t>(x),
+            .y_offset = static_cast<size_t>(y),
+            .width = static_cast<size_t>(width),
+            .height = static_cast<size_t>(height),
+    });
+}
+
+auto GeoBonCatalogService::serve_reader_request(const EbvReaderPool::Message &request) -> EbvReaderPool::Message {
+    // readers stay open for the lifetime of the worker, so that their chunk caches are reused, until their file changes
+    static FileHandles file_handles;
+
+    const auto request_type = request.header["request"].asString();
+    const auto ebv_file = request.header["path"].asString();
+
+    EbvReaderPool::Message response;
+
+    try {
+        if (request_type == "metadata") {
+            response.header = EbvMetadataCache::parse(ebv_file)->to_json();
+        } else if (request_type == "entity_tile") {
+            const auto tile = readTile(*file_handles.raster_reader(ebv_file),
+                                       split(request.header["ebv_entity_path"].asString(), '/'),
+                                       request.header["time_index"].asUInt64(),
+                                       request.header["x"].asInt(),
+                                       request.header["y"].asInt(),
+                                       request.header["width"].asInt(),
+                                       request.header["height"].asInt());
+
+            response.header["x"] = static_cast<Json::UInt64>(tile.window.x_offset);
+            response.header["y"] = static_cast<Json::UInt64>(tile.window.y_offset);
+            response.header["width"] = static_cast<Json::UInt64>(tile.window.width);
+            response.header["height"] = static_cast<Json::UInt64>(tile.window.height);
+            response.header["empty"] = tile.is_empty;
+
+            response.payload.resize(tile.values.size() * sizeof(float));
+            std::memcpy(response.payload.data(), tile.values.data(), response.payload.size());
+        } else {
+            throw GeoBonCatalogServiceException("GeoBonCatalogService: Invalid reader request");
+        }
+    } catch (const H5::Exception &e) {
+        throw GeoBonCatalogServiceException(concat("GeoBonCatalogService: ", e.getDetailMsg()));
+    }
+
+    return response;
+}
+
+void GeoBonCatalogService::checkUserPermissions(UserDB::User &user, const std::string &ebv_file) {
+    if (!hasUserPermissions(user, ebv_file)) {
+        throw GeoBonCatalogServiceException(concat("GeoBonCatalogServiceException: Missing access rights for ", ebv_file));
+    }
 }
 
 void GeoBonCatalogService::addUserPermissions(UserDB::User &user, const std::string &ebv_file) {
@@ -293,6 +1076,61 @@ auto GeoBonCatalogService::requestJsonFromUrl(const std::string &url) -> Json::V
     return result;
 }
 
+auto GeoBonCatalogService::responseEncoding() const -> HttpCompression::Encoding {
+    if (!Configuration::get<bool>("ebv.compression.enabled", true)) {
+        return HttpCompression::Encoding::Identity;
+    }
+
+    return HttpCompression::negotiate_environment(requestEnvironment());
+}
+
+auto GeoBonCatalogService::isCacheableRequest(const std::string &request) -> bool {
+    return request == "subgroups" || request == "subgroup_values" || request == "data_loading_info";
+}
+
+auto GeoBonCatalogService::responseCacheKey(const Parameters &request_params) -> std::string {
+    std::string key;
+    for (const auto &name : {"request", "ebv_path", "ebv_subgroup", "ebv_group_path", "ebv_entity_path"}) {
+        key += request_params.get(name, "");
+        key += '\n';
+    }
+    return key;
+}
+
+void GeoBonCatalogService::sendSuccessJSON(Json::Value &result, HttpCompression::Encoding encoding) const {
+    result["result"] = true;
+
+    HttpCompression::StreamBuffer buffer(
+            response,
+            encoding,
+            static_cast<size_t>(Configuration::get<int>("ebv.compression.min_bytes", 1024)),
+            Configuration::get<int>("ebv.compression.level", 6),
+            [this](HttpCompression::Encoding chosen_encoding) { sendJSONHeaders(chosen_encoding); }
+    );
+    std::ostream stream(&buffer);
+
+    Json::StreamWriterBuilder builder;
+    builder["indentation"] = "";
+    std::unique_ptr<Json::StreamWriter> writer(builder.newStreamWriter());
+    writer->write(result, &stream);
+
+    buffer.finish();
+}
+
+void GeoBonCatalogService::sendBody(const EbvResponseCache::Body &body) const {
+    sendJSONHeaders(body.encoding);
+    response.write(body.data->data(), static_cast<std::streamsize>(body.data->size()));
+}
+
+void GeoBonCatalogService::sendJSONHeaders(HttpCompression::Encoding encoding) const {
+    response.sendContentType("application/json; charset=utf-8");
+    if (encoding != HttpCompression::Encoding::Identity) {
+        response.sendHeader("Content-Encoding", HttpCompression::name(encoding));
+    }
+    response.sendHeader("Vary", "Accept-Encoding");
+    response.finishHeaders();
+}
+
 auto GeoBonCatalogService::combinePaths(const std::string &first, const std::string &second) -> std::string {
     const bool firstEndsWithSlash = first.back() == '/';
     const bool secondStartsWithSlash = second.front() == '/';
@@ -0,0 +1,52 @@
+/// Builds the data presence index sidecars of EBV NetCDF files.
+///
+/// Usage: mapping_ebv_presence_index <file.nc> [<file.nc> ...]
+
+#include <util/ebv_data_presence_index.h>
+
+#include <iostream>
+
+int main(int argc, char *argv[]) {
+    if (argc < 2) {
+        std::cerr << "Usage: " << argv[0] << " <file.nc> [<file.nc> ...]" << std::endl;
+        return 1;
+    }
+
+    int result = 0;
+
+    for (int i = 1; i < argc; ++i) {
+        const std::string file(argv[i]);
+
+        try {
+            const auto index = EbvDataPresenceIndex::build(file);
+            index.write_sidecar(file);
+
+            for (const auto &entity : index.entity_names()) {
+                const auto entity_index = index.entity(entity);
+
+                size_t blocks_with_data = 0;
+                for (size_t t = 0; t < entity_index->time_steps.size(); ++t) {
+                    for (size_t y = 0; y < entity_index->blocks_y; ++y) {
+                        for (size_t x = 0; x < entity_index->blocks_x; ++x) {
+                            blocks_with_data += entity_index->has_data(t, y, x) ? 1 : 0;
+                        }
+                    }
+                }
+
+                const auto blocks = entity_index->time_steps.size() * entity_index->blocks_y * entity_index->blocks_x;
+                std::cout << file << ": " << entity << " has data in " << blocks_with_data << " of " << blocks << " blocks"
+                          << std::endl;
+            }
+
+            std::cout << "wrote " << EbvDataPresenceIndex::sidecar_path(file) << std::endl;
+        } catch (const std::exception &e) {
+            std::cerr << file << ": " << e.what() << std::endl;
+            result = 1;
+        } catch (const H5::Exception &e) {
+            std::cerr << file << ": " << e.getDetailMsg() << std::endl;
+            result = 1;
+        }
+    }
+
+    return result;
+}
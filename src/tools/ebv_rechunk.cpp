@@ -0,0 +1,161 @@
+/// Rewrites EBV NetCDF files with a chunk shape and compression that suit their access pattern.
+///
+/// Usage: mapping_ebv_rechunk [--layout=1x256x256/deflate:4] [--threads=4] [--memory=256] <source.nc> <target.nc>
+///        mapping_ebv_rechunk --benchmark [--layout=<layout> ...] [--tile=256] [--reads=100] [--seed=42]
+///                            [--threads=4] [--memory=256] [--keep] <source.nc> [<work directory>]
+///
+/// Layouts are given as `<time>x<lat>x<lon>[/none|/deflate[:<level>]|/zstd[:<level>]|/lz4][/shuffle]`, a chunk extent
+/// of `0` stands for the whole dimension. zstd and LZ4 require the HDF5 filter plugins in `HDF5_PLUGIN_PATH`.
+/// The benchmark writes one file per layout and reports the read throughput of random tiles and full time series,
+/// next to the one of the original file.
+
+#include <util/ebv_rechunker.h>
+
+#include <cstdio>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+struct RechunkOptions {
+    bool benchmark = false;
+    std::vector<EbvRechunker::Layout> layouts;
+    size_t tile_size = 256;
+    size_t reads = 100;
+    unsigned int seed = 42;
+    size_t threads = 4;
+    size_t memory_megabytes = 256;
+    bool keep = false;
+    std::vector<std::string> files;
+};
+
+auto parse_options(int argc, char *argv[]) -> RechunkOptions {
+    RechunkOptions options;
+
+    for (int i = 1; i < argc; ++i) {
+        const std::string argument(argv[i]);
+        const auto separator = argument.find('=');
+        const auto key = argument.substr(0, separator);
+        const auto value = separator == std::string::npos ? "" : argument.substr(separator + 1);
+
+        if (key == "--benchmark") {
+            options.benchmark = true;
+        } else if (key == "--layout") {
+            options.layouts.push_back(EbvRechunker::Layout::parse(value));
+        } else if (key == "--tile") {
+            options.tile_size = std::max(1ul, std::stoul(value));
+        } else if (key == "--reads") {
+            options.reads = std::stoul(value);
+        } else if (key == "--seed") {
+            options.seed = static_cast<unsigned int>(std::stoul(value));
+        } else if (key == "--threads") {
+            options.threads = std::max(1ul, std::stoul(value));
+        } else if (key == "--memory") {
+            options.memory_megabytes = std::max(1ul, std::stoul(value));
+        } else if (key == "--keep") {
+            options.keep = true;
+        } else if (key.compare(0, 2, "--") == 0) {
+            throw std::invalid_argument("Unknown argument `" + argument + "`");
+        } else {
+            options.files.push_back(argument);
+        }
+    }
+
+    if (options.layouts.empty()) {
+        options.layouts.emplace_back();
+    }
+
+    if (options.benchmark ? options.files.empty() || options.files.size() > 2 : options.files.size() != 2) {
+        throw std::invalid_argument("Expected `<source.nc> <target.nc>`, or `<source.nc> [<work directory>]` with `--benchmark`");
+    }
+    if (!options.benchmark && options.layouts.size() > 1) {
+        throw std::invalid_argument("Only the benchmark accepts more than one `--layout`");
+    }
+    for (const auto &layout : options.layouts) {
+        if (!EbvRechunker::is_available(layout.codec)) {
+            throw std::invalid_argument("The codec of `" + layout.to_string() + "` is not available, check HDF5_PLUGIN_PATH");
+        }
+    }
+
+    return options;
+}
+
+auto rechunker_options(const RechunkOptions &options, const EbvRechunker::Layout &layout) -> EbvRechunker::Options {
+    EbvRechunker::Options rechunker_options;
+    rechunker_options.layout = layout;
+    rechunker_options.threads = options.threads;
+    rechunker_options.memory_limit = options.memory_megabytes << 20u;
+    return rechunker_options;
+}
+
+void print_summary(const std::string &target, const EbvRechunker::Summary &summary) {
+    std::cout << target << ": " << summary.entities << " entities, " << summary.chunks << " chunks ("
+              << summary.empty_chunks << " without data), " << std::fixed << std::setprecision(1)
+              << summary.raw_bytes / 1048576. << " MiB -> " << summary.stored_bytes / 1048576. << " MiB in "
+              << std::setprecision(2) << summary.seconds << " s" << std::endl;
+
+    for (const auto &warning : summary.warnings) {
+        std::cerr << "Warning: " << warning << std::endl;
+    }
+}
+
+void print_benchmark(const std::string &name, const EbvRechunker::BenchmarkResult &result) {
+    const auto per_second = [](double count, double seconds) -> double {
+        return seconds > 0 ? count / seconds : 0.;
+    };
+
+    std::cout << std::left << std::setw(32) << name << std::right << std::fixed
+              << std::setprecision(1) << std::setw(12) << result.file_size / 1048576.
+              << std::setw(12) << per_second(result.tile_reads, result.tile_seconds)
+              << std::setw(12) << per_second(result.tile_values * sizeof(float) / 1048576., result.tile_seconds)
+              << std::setw(12) << per_second(result.time_series_reads, result.time_series_seconds)
+              << std::setw(12) << per_second(result.time_series_values * sizeof(float) / 1048576., result.time_series_seconds)
+              << std::endl;
+}
+
+int main(int argc, char *argv[]) {
+    try {
+        const auto options = parse_options(argc, argv);
+        const auto &source = options.files[0];
+
+        if (!options.benchmark) {
+            print_summary(options.files[1], EbvRechunker::rechunk(source, options.files[1], rechunker_options(options, options.layouts[0])));
+            return 0;
+        }
+
+        const auto directory = options.files.size() > 1 ? options.files[1] : std::string(P_tmpdir);
+        const auto base_name = source.substr(source.find_last_of('/') + 1);
+
+        std::vector<std::pair<std::string, EbvRechunker::BenchmarkResult>> results;
+        results.emplace_back("original", EbvRechunker::benchmark(source, options.tile_size, options.reads, options.seed));
+
+        for (size_t i = 0; i < options.layouts.size(); ++i) {
+            const auto &layout = options.layouts[i];
+            const auto candidate = directory + "/" + base_name + ".candidate" + std::to_string(i) + ".nc";
+
+            print_summary(candidate, EbvRechunker::rechunk(source, candidate, rechunker_options(options, layout)));
+            results.emplace_back(layout.to_string(), EbvRechunker::benchmark(candidate, options.tile_size, options.reads, options.seed));
+
+            if (!options.keep) {
+                std::remove(candidate.c_str());
+            }
+        }
+
+        std::cout << std::endl << options.reads << " random reads each of " << options.tile_size << "x" << options.tile_size
+                  << " tiles and of full time series" << std::endl
+                  << std::left << std::setw(32) << "layout" << std::right << std::setw(12) << "MiB"
+                  << std::setw(12) << "tiles/s" << std::setw(12) << "MiB/s" << std::setw(12) << "series/s"
+                  << std::setw(12) << "MiB/s" << std::endl;
+        for (const auto &result : results) {
+            print_benchmark(result.first, result.second);
+        }
+    } catch (const std::exception &e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    } catch (const H5::Exception &e) {
+        std::cerr << e.getDetailMsg() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
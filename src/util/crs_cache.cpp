@@ -0,0 +1,156 @@
+#include "crs_cache.h"
+
+#include <util/concat.h>
+#include <util/log.h>
+
+#include <gdal/gdal_version.h>
+#include <gdal/ogr_spatialref.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <limits>
+
+constexpr size_t CrsCache::max_entries;
+
+/// Creates a spatial reference of an `EPSG:<code>` with x/longitude before y/latitude.
+/// `SetFromUserInput` would also accept file names and URLs, which must not be opened on behalf of a request.
+static auto create_spatial_reference(const std::string &crs) -> std::unique_ptr<OGRSpatialReference> {
+    const std::string prefix = "EPSG:";
+    const auto code = crs.substr(std::min(prefix.size(), crs.size()));
+
+    const bool is_epsg_code = crs.size() > prefix.size() && crs.size() <= prefix.size() + 9
+                              && std::equal(prefix.begin(), prefix.end(), crs.begin(), [](char a, char b) {
+                                  return a == std::toupper(static_cast<unsigned char>(b));
+                              })
+                              && std::all_of(code.begin(), code.end(), [](char c) {
+                                  return std::isdigit(static_cast<unsigned char>(c));
+                              });
+    if (!is_epsg_code) {
+        throw CrsCache::CrsCacheException(concat("CrsCache: `", crs, "` is no EPSG code like `EPSG:4326`"));
+    }
+
+    std::unique_ptr<OGRSpatialReference> spatial_reference(new OGRSpatialReference());
+    if (spatial_reference->importFromEPSG(std::stoi(code)) != OGRERR_NONE) {
+        throw CrsCache::CrsCacheException(concat("CrsCache: Unknown coordinate reference system `", crs, "`"));
+    }
+#if GDAL_VERSION_MAJOR >= 3
+    spatial_reference->SetAxisMappingStrategy(OAMS_TRADITIONAL_GIS_ORDER);
+#endif
+    return spatial_reference;
+}
+
+CrsCache::Transformation::Transformation(const std::string &source_crs, const std::string &target_crs)
+        : source(create_spatial_reference(source_crs)), target(create_spatial_reference(target_crs)) {
+    release(acquire()); // fails early if there is no transformation between the two
+}
+
+CrsCache::Transformation::~Transformation() = default;
+
+void CrsCache::Transformation::transform(size_t count, double *x, double *y) const {
+    auto transformer = acquire();
+
+    // failed coordinates are set to `HUGE_VAL`
+    transformer->Transform(static_cast<int>(count), x, y);
+
+    for (size_t i = 0; i < count; ++i) {
+        if (!std::isfinite(x[i]) || !std::isfinite(y[i]) || x[i] == HUGE_VAL || y[i] == HUGE_VAL) {
+            x[i] = std::numeric_limits<double>::quiet_NaN();
+            y[i] = std::numeric_limits<double>::quiet_NaN();
+        }
+    }
+
+    release(std::move(transformer));
+}
+
+auto CrsCache::Transformation::acquire() const -> std::unique_ptr<OGRCoordinateTransformation> {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!idle_transformers.empty()) {
+            auto transformer = std::move(idle_transformers.back());
+            idle_transformers.pop_back();
+            return transformer;
+        }
+    }
+
+    std::unique_ptr<OGRCoordinateTransformation> transformer(OGRCreateCoordinateTransformation(source.get(), target.get()));
+    if (!transformer) {
+        throw CrsCacheException("CrsCache: Unable to create a coordinate transformation");
+    }
+    return transformer;
+}
+
+void CrsCache::Transformation::release(std::unique_ptr<OGRCoordinateTransformation> transformer) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    idle_transformers.push_back(std::move(transformer));
+}
+
+auto CrsCache::instance() -> CrsCache & {
+    static CrsCache cache;
+    return cache;
+}
+
+auto CrsCache::code(const std::string &wkt) -> std::string {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        std::string code;
+        if (codes.find(wkt, code)) {
+            return code;
+        }
+    }
+
+    const auto code = resolve_code(wkt);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    return codes.insert(wkt, code);
+}
+
+auto CrsCache::transformation(const std::string &source_crs,
+                              const std::string &target_crs) -> std::shared_ptr<const Transformation> {
+    const auto key = std::make_pair(source_crs, target_crs);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        std::shared_ptr<const Transformation> transformation;
+        if (transformations.find(key, transformation)) {
+            return transformation;
+        }
+    }
+
+    // built without the lock, a concurrent caller may build the same and only the first one is kept
+    auto transformation = std::make_shared<const Transformation>(source_crs, target_crs);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    return transformations.insert(key, std::move(transformation));
+}
+
+void CrsCache::clear() {
+    std::lock_guard<std::mutex> lock(mutex);
+    codes.clear();
+    transformations.clear();
+}
+
+auto CrsCache::resolve_code(const std::string &wkt) -> std::string {
+    Log::debug(concat("CrsCache: CRS wkt string: ", wkt));
+
+    const auto authority_code = [](const OGRSpatialReference &sref, const char *node) -> std::string {
+        const char *authority = sref.GetAuthorityName(node);
+        const char *code = sref.GetAuthorityCode(node);
+        if (!authority || !code) {
+            return "";
+        }
+        return concat(authority, ":", code);
+    };
+
+    std::string crs_code;
+    OGRSpatialReference sref = OGRSpatialReference(wkt.c_str());
+    if (sref.IsGeographic()) {
+        crs_code = authority_code(sref, "GEOGCS");
+    }
+    if (sref.IsProjected()) {
+        crs_code = authority_code(sref, "PROJCS");
+    }
+
+    Log::debug(concat("CrsCache: CRS code: ", crs_code));
+
+    return crs_code;
+}
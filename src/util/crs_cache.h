@@ -0,0 +1,137 @@
+#ifndef MAPPING_EBV_CRS_CACHE_H
+#define MAPPING_EBV_CRS_CACHE_H
+
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+class OGRSpatialReference;
+
+class OGRCoordinateTransformation;
+
+/// Process-wide cache of resolved coordinate reference systems and of transformations between them.
+///
+/// Many EBV files share the same WKT, and creating spatial references and transformers is expensive,
+/// so each is only built once per process. Both caches keep the `max_entries` most recently used entries.
+class CrsCache {
+    public:
+        struct CrsCacheException : public std::runtime_error {
+            using std::runtime_error::runtime_error;
+        };
+
+        /// Transforms coordinates between two reference systems, in the order x/longitude and y/latitude.
+        /// It keeps a transformer per concurrent caller, so `transform` may be called from any thread.
+        class Transformation {
+            public:
+                /// `source_crs` and `target_crs` are EPSG codes like `EPSG:4326`, other definitions are rejected, since they
+                /// may come from requests and GDAL would resolve them from files or the network
+                Transformation(const std::string &source_crs, const std::string &target_crs);
+
+                ~Transformation();
+
+                Transformation(const Transformation &) = delete;
+
+                Transformation &operator=(const Transformation &) = delete;
+
+                /// Transforms `count` coordinates in place, coordinates that can not be transformed are set to NaN
+                void transform(size_t count, double *x, double *y) const;
+
+            private:
+                auto acquire() const -> std::unique_ptr<OGRCoordinateTransformation>;
+
+                void release(std::unique_ptr<OGRCoordinateTransformation> transformer) const;
+
+                std::unique_ptr<OGRSpatialReference> source;
+                std::unique_ptr<OGRSpatialReference> target;
+
+                mutable std::mutex mutex;
+                /// transformers that are not in use, since a single one must not be used concurrently
+                mutable std::vector<std::unique_ptr<OGRCoordinateTransformation>> idle_transformers;
+        };
+
+        static auto instance() -> CrsCache &;
+
+        /// The authority code, e.g. `EPSG:4326`, of a WKT definition
+        auto code(const std::string &wkt) -> std::string;
+
+        auto transformation(const std::string &source_crs, const std::string &target_crs) -> std::shared_ptr<const Transformation>;
+
+        void clear();
+
+        /// Resolves the authority code of a WKT definition without the cache
+        static auto resolve_code(const std::string &wkt) -> std::string;
+
+        static constexpr size_t max_entries = 256;
+
+    private:
+        /// Map that drops its least recently used entries beyond `max_entries`
+        template<class Key, class Value>
+        class LruMap {
+            public:
+                auto find(const Key &key, Value &value) -> bool;
+
+                /// Keeps an existing value, which is returned
+                auto insert(const Key &key, Value value) -> Value;
+
+                void clear();
+
+            private:
+                struct Entry {
+                    Value value;
+                    typename std::list<Key>::iterator lru_position;
+                };
+
+                std::map<Key, Entry> entries;
+                /// most recently used first
+                std::list<Key> lru;
+        };
+
+        CrsCache() = default;
+
+        std::mutex mutex;
+        LruMap<std::string, std::string> codes;
+        LruMap<std::pair<std::string, std::string>, std::shared_ptr<const Transformation>> transformations;
+};
+
+template<class Key, class Value>
+auto CrsCache::LruMap<Key, Value>::find(const Key &key, Value &value) -> bool {
+    const auto entry = entries.find(key);
+    if (entry == entries.end()) {
+        return false;
+    }
+
+    lru.splice(lru.begin(), lru, entry->second.lru_position);
+    value = entry->second.value;
+    return true;
+}
+
+template<class Key, class Value>
+auto CrsCache::LruMap<Key, Value>::insert(const Key &key, Value value) -> Value {
+    Value existing;
+    if (find(key, existing)) {
+        return existing;
+    }
+
+    lru.push_front(key);
+    entries.emplace(key, Entry{value, lru.begin()});
+
+    while (entries.size() > max_entries) {
+        entries.erase(lru.back());
+        lru.pop_back();
+    }
+
+    return value;
+}
+
+template<class Key, class Value>
+void CrsCache::LruMap<Key, Value>::clear() {
+    entries.clear();
+    lru.clear();
+}
+
+#endif //MAPPING_EBV_CRS_CACHE_H
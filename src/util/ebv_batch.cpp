@@ -0,0 +1,34 @@
+#include "ebv_batch.h"
+
+auto EbvBatch::parse(const std::string &requests_json, size_t max_requests) -> std::vector<Request> {
+    Json::Reader reader(Json::Features::strictMode());
+    Json::Value requests_value;
+    if (!reader.parse(requests_json, requests_value) || !requests_value.isArray()) {
+        throw EbvBatchException("`requests` must be a JSON array");
+    }
+    if (requests_value.size() > max_requests) {
+        throw EbvBatchException("More than " + std::to_string(max_requests) + " requests");
+    }
+
+    std::vector<Request> requests(requests_value.size());
+    for (Json::ArrayIndex i = 0; i < requests_value.size(); ++i) {
+        const auto &request_value = requests_value[i];
+        auto &request = requests[i];
+
+        if (!request_value.isObject()) {
+            request.error = "The request must be a JSON object";
+            continue;
+        }
+
+        for (const auto &name : request_value.getMemberNames()) {
+            const auto &value = request_value[name];
+            if (value.isObject() || value.isArray()) { // would throw on conversion
+                request.error = "The parameter `" + name + "` must be a string, number or boolean";
+                break;
+            }
+            request.parameters[name] = value.asString();
+        }
+    }
+
+    return requests;
+}
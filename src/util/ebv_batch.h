@@ -0,0 +1,30 @@
+#ifndef MAPPING_EBV_EBV_BATCH_H
+#define MAPPING_EBV_EBV_BATCH_H
+
+#include <json/json.h>
+
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+/// The requests of `request=batch`, a JSON array of objects whose members are the parameters of each request.
+///
+/// A malformed request only fails itself, the batch as a whole only fails if it is no array or too large.
+class EbvBatch {
+    public:
+        struct EbvBatchException : public std::runtime_error {
+            using std::runtime_error::runtime_error;
+        };
+
+        struct Request {
+            std::map<std::string, std::string> parameters;
+            /// not empty if the request is malformed, its `parameters` are then incomplete
+            std::string error;
+        };
+
+        /// Throws if `requests_json` is no JSON array or holds more than `max_requests` requests
+        static auto parse(const std::string &requests_json, size_t max_requests) -> std::vector<Request>;
+};
+
+#endif //MAPPING_EBV_EBV_BATCH_H
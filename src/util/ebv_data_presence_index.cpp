@@ -0,0 +1,401 @@
+#include "ebv_data_presence_index.h"
+#include "hdf5_typed_reader.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <mutex>
+#include <unistd.h>
+
+constexpr size_t EbvDataPresenceIndex::default_block_size;
+constexpr int EbvDataPresenceIndex::version;
+
+auto EbvDataPresenceIndex::EntityIndex::has_data(size_t time_index, size_t block_y, size_t block_x) const -> bool {
+    const auto bit = block_y * blocks_x + block_x;
+    return (time_steps[time_index][bit / 8] >> (bit % 8)) & 1u;
+}
+
+auto EbvDataPresenceIndex::EntityIndex::bounding_box(size_t time_index) const -> Window {
+    size_t min_x = blocks_x, min_y = blocks_y, max_x = 0, max_y = 0;
+
+    for (size_t y = 0; y < blocks_y; ++y) {
+        for (size_t x = 0; x < blocks_x; ++x) {
+            if (has_data(time_index, y, x)) {
+                min_x = std::min(min_x, x);
+                min_y = std::min(min_y, y);
+                max_x = std::max(max_x, x);
+                max_y = std::max(max_y, y);
+            }
+        }
+    }
+
+    if (min_x > max_x) {
+        return {0, 0, 0, 0};
+    }
+
+    return {min_x, min_y, max_x - min_x + 1, max_y - min_y + 1};
+}
+
+/// Collects the paths of all datasets of rank three with a numeric type
+static auto find_grid_datasets(const H5::H5File &file) -> std::vector<std::string> {
+    std::vector<std::string> datasets;
+
+    const auto visit = [](hid_t location, const char *name, const H5O_info_t *info, void *data) -> herr_t {
+        if (info->type != H5O_TYPE_DATASET) {
+            return 0;
+        }
+
+        const hid_t dataset = H5Dopen2(location, name, H5P_DEFAULT);
+        const hid_t space = H5Dget_space(dataset);
+        const hid_t type = H5Dget_type(dataset);
+        const auto type_class = H5Tget_class(type);
+
+        if (H5Sget_simple_extent_ndims(space) == 3 && (type_class == H5T_INTEGER || type_class == H5T_FLOAT)) {
+            static_cast<std::vector<std::string> *>(data)->emplace_back(name);
+        }
+
+        H5Tclose(type);
+        H5Sclose(space);
+        H5Dclose(dataset);
+        return 0;
+    };
+
+    H5Ovisit(file.getId(), H5_INDEX_NAME, H5_ITER_INC, visit, &datasets);
+
+    return datasets;
+}
+
+auto EbvDataPresenceIndex::build(const std::string &file) -> EbvDataPresenceIndex {
+    EbvDataPresenceIndex index;
+    index.source = FileStatus::of(file);
+
+    const H5::H5File h5_file(file, H5F_ACC_RDONLY);
+
+    for (const auto &dataset_path : find_grid_datasets(h5_file)) {
+        index.entities[dataset_path] = build_entity(h5_file.openDataSet(dataset_path));
+    }
+
+    return index;
+}
+
+auto EbvDataPresenceIndex::build_entity(const H5::DataSet &dataset) -> EntityIndex {
+    hsize_t dimensions[3];
+    dataset.getSpace().getSimpleExtentDims(dimensions);
+
+    const auto creation_properties = dataset.getCreatePlist();
+    const bool is_chunked = creation_properties.getLayout() == H5D_CHUNKED;
+
+    hsize_t chunk_dimensions[3] = {1, default_block_size, default_block_size};
+    if (is_chunked) {
+        creation_properties.getChunk(3, chunk_dimensions);
+    }
+
+    EntityIndex entity_index{};
+    entity_index.height = dimensions[1];
+    entity_index.width = dimensions[2];
+    entity_index.block_height = chunk_dimensions[1];
+    entity_index.block_width = chunk_dimensions[2];
+    entity_index.blocks_y = (dimensions[1] + entity_index.block_height - 1) / entity_index.block_height;
+    entity_index.blocks_x = (dimensions[2] + entity_index.block_width - 1) / entity_index.block_width;
+
+    const auto bitmap_bytes = (entity_index.blocks_y * entity_index.blocks_x + 7) / 8;
+    entity_index.time_steps.assign(dimensions[0], std::vector<uint8_t>(bitmap_bytes, 0));
+
+    const auto packing = Hdf5TypedReader::packing(dataset);
+    std::vector<float> block(entity_index.block_height * entity_index.block_width);
+
+    for (hsize_t t = 0; t < dimensions[0]; ++t) {
+        for (size_t block_y = 0; block_y < entity_index.blocks_y; ++block_y) {
+            for (size_t block_x = 0; block_x < entity_index.blocks_x; ++block_x) {
+                const hsize_t offset[3] = {t, block_y * entity_index.block_height, block_x * entity_index.block_width};
+                const hsize_t count[3] = {
+                        1,
+                        std::min<hsize_t>(entity_index.block_height, dimensions[1] - offset[1]),
+                        std::min<hsize_t>(entity_index.block_width, dimensions[2] - offset[2]),
+                };
+
+                if (is_chunked) { // chunks that were never written contain only fill values
+                    haddr_t address = HADDR_UNDEF;
+                    hsize_t chunk_offset[3] = {offset[0], offset[1], offset[2]};
+                    hsize_t chunk_size = 0;
+                    unsigned filter_mask = 0;
+
+                    // chunk offsets must be aligned to the chunk grid in the time dimension as well
+                    chunk_offset[0] -= chunk_offset[0] % chunk_dimensions[0];
+
+                    if (H5Dget_chunk_info_by_coord(dataset.getId(), chunk_offset, &filter_mask, &address, &chunk_size) >= 0
+                        && address == HADDR_UNDEF) {
+                        continue;
+                    }
+                }
+
+                H5::DataSpace file_space = dataset.getSpace();
+                file_space.selectHyperslab(H5S_SELECT_SET, count, offset);
+
+                const auto size = count[1] * count[2];
+                Hdf5TypedReader::read_dataset_unpacked(dataset, packing, block.data(), std::nanf(""), file_space);
+
+                const bool has_data = std::any_of(block.cbegin(), block.cbegin() + size, [](float value) {
+                    return !std::isnan(value);
+                });
+
+                if (has_data) {
+                    const auto bit = block_y * entity_index.blocks_x + block_x;
+                    entity_index.time_steps[t][bit / 8] |= static_cast<uint8_t>(1u << (bit % 8));
+                }
+            }
+        }
+    }
+
+    return entity_index;
+}
+
+auto EbvDataPresenceIndex::has_data(const std::string &entity, size_t time_index, const Window &window) const -> bool {
+    const auto entity_index = this->entity(entity);
+    if (!entity_index || time_index >= entity_index->time_steps.size()) {
+        return true; // not indexed
+    }
+    if (window.width == 0 || window.height == 0) {
+        return false;
+    }
+
+    const auto first_block_y = window.y_offset / entity_index->block_height;
+    const auto first_block_x = window.x_offset / entity_index->block_width;
+    const auto last_block_y = std::min(entity_index->blocks_y - 1, (window.y_offset + window.height - 1) / entity_index->block_height);
+    const auto last_block_x = std::min(entity_index->blocks_x - 1, (window.x_offset + window.width - 1) / entity_index->block_width);
+
+    for (auto block_y = first_block_y; block_y <= last_block_y; ++block_y) {
+        for (auto block_x = first_block_x; block_x <= last_block_x; ++block_x) {
+            if (entity_index->has_data(time_index, block_y, block_x)) {
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+auto EbvDataPresenceIndex::entity(const std::string &entity) const -> const EntityIndex * {
+    const auto entity_index = entities.find(!entity.empty() && entity.front() == '/' ? entity.substr(1) : entity);
+    return entity_index == entities.end() ? nullptr : &entity_index->second;
+}
+
+auto EbvDataPresenceIndex::entity_names() const -> std::vector<std::string> {
+    std::vector<std::string> names;
+    names.reserve(entities.size());
+    for (const auto &entry : entities) {
+        names.push_back(entry.first);
+    }
+    return names;
+}
+
+auto EbvDataPresenceIndex::sidecar_path(const std::string &file) -> std::string {
+    return file + ".presence.json";
+}
+
+void EbvDataPresenceIndex::write_sidecar(const std::string &file) const {
+    const auto path = sidecar_path(file);
+    const auto temporary_path = path + ".tmp" + std::to_string(getpid());
+
+    {
+        std::ofstream sidecar(temporary_path);
+        sidecar << Json::FastWriter().write(to_json());
+        sidecar.close();
+
+        if (!sidecar) {
+            std::remove(temporary_path.c_str());
+            throw EbvDataPresenceIndexException("Unable to write `" + temporary_path + "`");
+        }
+    }
+
+    // readers see either the old or the new sidecar, never a partially written one
+    if (std::rename(temporary_path.c_str(), path.c_str()) != 0) {
+        std::remove(temporary_path.c_str());
+        throw EbvDataPresenceIndexException("Unable to write `" + path + "`");
+    }
+}
+
+auto EbvDataPresenceIndex::load(const std::string &file, std::string *error) -> std::shared_ptr<const EbvDataPresenceIndex> {
+    struct CacheEntry {
+        FileStatus sidecar;
+        /// `nullptr` if the sidecar is malformed
+        std::shared_ptr<const EbvDataPresenceIndex> index;
+    };
+
+    static std::mutex mutex;
+    static std::map<std::string, CacheEntry> cache;
+
+    const auto sidecar_file = sidecar_path(file);
+    const auto sidecar_status = FileStatus::of(sidecar_file);
+    if (!sidecar_status.exists()) {
+        return nullptr;
+    }
+
+    const auto source_status = FileStatus::of(file);
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        const auto entry = cache.find(file);
+        if (entry != cache.end() && entry->second.sidecar == sidecar_status) {
+            const auto &index = entry->second.index;
+            return index && index->source == source_status ? index : nullptr;
+        }
+    }
+
+    std::shared_ptr<const EbvDataPresenceIndex> index;
+    try {
+        std::ifstream sidecar(sidecar_file);
+        Json::Value json;
+        if (!sidecar || !Json::Reader().parse(sidecar, json)) {
+            throw EbvDataPresenceIndexException("Invalid JSON");
+        }
+
+        index = std::make_shared<const EbvDataPresenceIndex>(from_json(json));
+    } catch (const std::exception &e) { // a broken sidecar must not break reads of its file
+        if (error) {
+            *error = "Ignoring `" + sidecar_file + "`: " + e.what();
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        cache[file] = CacheEntry{sidecar_status, index};
+    }
+
+    // an outdated index must not hide data
+    return index && index->source == source_status ? index : nullptr;
+}
+
+static auto bitmap_to_hex(const std::vector<uint8_t> &bitmap) -> std::string {
+    static const char digits[] = "0123456789abcdef";
+
+    std::string hex;
+    hex.reserve(bitmap.size() * 2);
+    for (const auto byte : bitmap) {
+        hex += digits[byte >> 4];
+        hex += digits[byte & 0xf];
+    }
+    return hex;
+}
+
+static auto hex_digit(char digit) -> int {
+    if (digit >= '0' && digit <= '9') {
+        return digit - '0';
+    } else if (digit >= 'a' && digit <= 'f') {
+        return digit - 'a' + 10;
+    } else if (digit >= 'A' && digit <= 'F') {
+        return digit - 'A' + 10;
+    }
+    return -1;
+}
+
+static auto hex_to_bitmap(const std::string &hex) -> std::vector<uint8_t> {
+    if (hex.size() % 2 != 0) {
+        throw EbvDataPresenceIndex::EbvDataPresenceIndexException("Bitmap of odd length");
+    }
+
+    std::vector<uint8_t> bitmap(hex.size() / 2);
+    for (size_t i = 0; i < bitmap.size(); ++i) {
+        const auto high = hex_digit(hex[2 * i]);
+        const auto low = hex_digit(hex[2 * i + 1]);
+        if (high < 0 || low < 0) {
+            throw EbvDataPresenceIndex::EbvDataPresenceIndexException("Bitmap is no hex string");
+        }
+        bitmap[i] = static_cast<uint8_t>(high << 4 | low);
+    }
+    return bitmap;
+}
+
+/// A non-negative integer member of an entity of the sidecar
+static auto size_member(const Json::Value &json, const std::string &name) -> size_t {
+    const auto &value = json[name];
+    if (!value.isUInt64()) {
+        throw EbvDataPresenceIndex::EbvDataPresenceIndexException("Missing or invalid `" + name + "`");
+    }
+    return value.asUInt64();
+}
+
+auto EbvDataPresenceIndex::to_json() const -> Json::Value {
+    Json::Value json(Json::objectValue);
+    json["version"] = version;
+    json["source"] = source.to_json();
+
+    Json::Value entities_json(Json::objectValue);
+    for (const auto &entry : entities) {
+        const auto &entity_index = entry.second;
+
+        Json::Value entity_json(Json::objectValue);
+        entity_json["height"] = static_cast<Json::UInt64>(entity_index.height);
+        entity_json["width"] = static_cast<Json::UInt64>(entity_index.width);
+        entity_json["block_height"] = static_cast<Json::UInt64>(entity_index.block_height);
+        entity_json["block_width"] = static_cast<Json::UInt64>(entity_index.block_width);
+        entity_json["blocks_y"] = static_cast<Json::UInt64>(entity_index.blocks_y);
+        entity_json["blocks_x"] = static_cast<Json::UInt64>(entity_index.blocks_x);
+
+        Json::Value time_steps_json(Json::arrayValue);
+        for (const auto &bitmap : entity_index.time_steps) {
+            time_steps_json.append(bitmap_to_hex(bitmap));
+        }
+        entity_json["time_steps"] = time_steps_json;
+
+        entities_json[entry.first] = entity_json;
+    }
+    json["entities"] = entities_json;
+
+    return json;
+}
+
+auto EbvDataPresenceIndex::from_json(const Json::Value &json) -> EbvDataPresenceIndex {
+    if (!json.isObject() || !json["version"].isInt() || json["version"].asInt() != version) {
+        throw EbvDataPresenceIndexException("Unsupported presence index version");
+    }
+    if (!json["entities"].isObject()) {
+        throw EbvDataPresenceIndexException("Missing or invalid entities of the presence index");
+    }
+
+    EbvDataPresenceIndex index;
+    try {
+        index.source = FileStatus::from_json(json["source"]);
+    } catch (const FileStatus::FileStatusException &e) {
+        throw EbvDataPresenceIndexException(std::string("Invalid source of the presence index: ") + e.what());
+    }
+
+    const auto &entities_json = json["entities"];
+    for (const auto &name : entities_json.getMemberNames()) {
+        const auto &entity_json = entities_json[name];
+        if (!entity_json.isObject() || !entity_json["time_steps"].isArray()) {
+            throw EbvDataPresenceIndexException("Invalid entity `" + name + "`");
+        }
+
+        EntityIndex entity_index{};
+        entity_index.height = size_member(entity_json, "height");
+        entity_index.width = size_member(entity_json, "width");
+        entity_index.block_height = size_member(entity_json, "block_height");
+        entity_index.block_width = size_member(entity_json, "block_width");
+        entity_index.blocks_y = size_member(entity_json, "blocks_y");
+        entity_index.blocks_x = size_member(entity_json, "blocks_x");
+
+        // `has_data` relies on the blocks covering the grid exactly
+        if (entity_index.block_height == 0 || entity_index.block_width == 0
+            || entity_index.blocks_y != (entity_index.height + entity_index.block_height - 1) / entity_index.block_height
+            || entity_index.blocks_x != (entity_index.width + entity_index.block_width - 1) / entity_index.block_width) {
+            throw EbvDataPresenceIndexException("Blocks of entity `" + name + "` do not match its grid");
+        }
+
+        const auto bitmap_bytes = (entity_index.blocks_y * entity_index.blocks_x + 7) / 8;
+        for (const auto &bitmap : entity_json["time_steps"]) {
+            if (!bitmap.isString()) {
+                throw EbvDataPresenceIndexException("Invalid bitmap of entity `" + name + "`");
+            }
+            entity_index.time_steps.push_back(hex_to_bitmap(bitmap.asString()));
+            if (entity_index.time_steps.back().size() != bitmap_bytes) {
+                throw EbvDataPresenceIndexException("Bitmap of entity `" + name + "` does not match its blocks");
+            }
+        }
+
+        index.entities[name] = std::move(entity_index);
+    }
+
+    return index;
+}
@@ -0,0 +1,92 @@
+#ifndef MAPPING_EBV_EBV_DATA_PRESENCE_INDEX_H
+#define MAPPING_EBV_EBV_DATA_PRESENCE_INDEX_H
+
+#include "file_status.h"
+
+#include <H5Cpp.h>
+#include <json/json.h>
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+/// Index of the blocks of each entity and time step that contain at least one valid (non-fill) value.
+///
+/// Blocks follow the chunk grid of the entity datasets, so that reads of empty blocks can be skipped without any I/O.
+/// The index is stored in a JSON sidecar next to the NetCDF file, see `sidecar_path`.
+class EbvDataPresenceIndex {
+    public:
+        struct EbvDataPresenceIndexException : public std::runtime_error {
+            using std::runtime_error::runtime_error;
+        };
+
+        /// A pixel window of the spatial grid
+        struct Window {
+            size_t x_offset;
+            size_t y_offset;
+            size_t width;
+            size_t height;
+        };
+
+        /// Presence bitmaps of one entity dataset of shape (time, y, x)
+        struct EntityIndex {
+            /// of the grid, in pixels
+            size_t height;
+            size_t width;
+
+            size_t block_height;
+            size_t block_width;
+            size_t blocks_y;
+            size_t blocks_x;
+
+            /// one bitmap per time step, bit `y * blocks_x + x` is set if the block contains data
+            std::vector<std::vector<uint8_t>> time_steps;
+
+            auto has_data(size_t time_index, size_t block_y, size_t block_x) const -> bool;
+
+            /// Bounding box (in blocks) of all blocks with data, `width == 0` if there are none
+            auto bounding_box(size_t time_index) const -> Window;
+        };
+
+        /// Scans all three-dimensional numeric datasets of `file`
+        static auto build(const std::string &file) -> EbvDataPresenceIndex;
+
+        /// Loads the sidecar of `file` if it exists and matches the current file, using a process-wide cache.
+        /// Malformed sidecars are ignored as well, `error` then tells why, once per version of the sidecar.
+        static auto load(const std::string &file, std::string *error = nullptr) -> std::shared_ptr<const EbvDataPresenceIndex>;
+
+        static auto sidecar_path(const std::string &file) -> std::string;
+
+        /// Writes the sidecar to a temporary file first, so that it is replaced at once
+        void write_sidecar(const std::string &file) const;
+
+        /// Returns `false` only if the index proves that the window contains no data
+        auto has_data(const std::string &entity, size_t time_index, const Window &window) const -> bool;
+
+        auto entity(const std::string &entity) const -> const EntityIndex *;
+
+        auto entity_names() const -> std::vector<std::string>;
+
+        auto to_json() const -> Json::Value;
+
+        /// Throws if `json` is no consistent index of the current version
+        static auto from_json(const Json::Value &json) -> EbvDataPresenceIndex;
+
+        static constexpr int version = 3;
+
+        /// Blocks of contiguous datasets, which have no chunk grid
+        static constexpr size_t default_block_size = 256;
+
+    private:
+        static auto build_entity(const H5::DataSet &dataset) -> EntityIndex;
+
+        FileStatus source;
+
+        /// key: dataset path without leading slash, e.g. `past/mean/A`
+        std::map<std::string, EntityIndex> entities;
+};
+
+#endif //MAPPING_EBV_EBV_DATA_PRESENCE_INDEX_H
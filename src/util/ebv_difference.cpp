@@ -0,0 +1,121 @@
+#include "ebv_difference.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+auto EbvDifference::parse_operation(const std::string &operation) -> Operation {
+    if (operation == "difference") {
+        return Operation::Difference;
+    } else if (operation == "ratio") {
+        return Operation::Ratio;
+    } else if (operation == "percent_change") {
+        return Operation::PercentChange;
+    }
+    throw EbvDifferenceException("EbvDifference: Unknown operation `" + operation + "`");
+}
+
+auto EbvDifference::blocks(const EbvRasterReader::Window &window,
+                           size_t block_height,
+                           size_t block_width) -> std::vector<EbvRasterReader::Window> {
+    if (block_height == 0 || block_width == 0) {
+        throw EbvDifferenceException("EbvDifference: Blocks must not be empty");
+    }
+
+    std::vector<EbvRasterReader::Window> windows;
+
+    const size_t x_end = window.x_offset + window.width;
+    const size_t y_end = window.y_offset + window.height;
+
+    for (size_t y = window.y_offset; y < y_end; y = (y / block_height + 1) * block_height) {
+        const size_t height = std::min((y / block_height + 1) * block_height, y_end) - y;
+
+        for (size_t x = window.x_offset; x < x_end; x = (x / block_width + 1) * block_width) {
+            const size_t width = std::min((x / block_width + 1) * block_width, x_end) - x;
+
+            windows.push_back(EbvRasterReader::Window{.x_offset = x, .y_offset = y, .width = width, .height = height});
+        }
+    }
+
+    return windows;
+}
+
+auto EbvDifference::block_size(size_t chunk_size, size_t min_block_size) -> size_t {
+    chunk_size = std::max<size_t>(chunk_size, 1);
+    return ((min_block_size + chunk_size - 1) / chunk_size) * chunk_size;
+}
+
+void EbvDifference::apply(Operation operation, const float *first, const float *second, float *result, size_t count) {
+    const float nan = std::numeric_limits<float>::quiet_NaN();
+
+    // one branch-free loop per operation, so that the compiler can vectorize them
+    switch (operation) {
+        case Operation::Difference:
+            for (size_t i = 0; i < count; ++i) {
+                result[i] = first[i] - second[i];
+            }
+            break;
+        case Operation::Ratio:
+            for (size_t i = 0; i < count; ++i) {
+                result[i] = first[i] / second[i];
+            }
+            break;
+        case Operation::PercentChange:
+            for (size_t i = 0; i < count; ++i) {
+                result[i] = (first[i] - second[i]) / second[i] * 100.0f;
+            }
+            break;
+    }
+
+    // divisions by zero, and infinite inputs
+    for (size_t i = 0; i < count; ++i) {
+        result[i] = std::abs(result[i]) <= std::numeric_limits<float>::max() ? result[i] : nan;
+    }
+}
+
+auto EbvDifference::stream(const EbvRasterReader::Window &window,
+                           size_t block_height,
+                           size_t block_width,
+                           Operation operation,
+                           const Read &first,
+                           const Read &second,
+                           const Consume &consume) -> Summary {
+    Summary summary{0, 0};
+
+    EbvRasterReader::Tile result;
+    result.no_data = std::numeric_limits<float>::quiet_NaN();
+
+    for (const auto &block : blocks(window, block_height, block_width)) {
+        ++summary.blocks;
+
+        result.window = block;
+        result.values.clear();
+
+        // the second operand is not read if the first one is already empty
+        const auto first_tile = first(block);
+        result.is_empty = first_tile.is_empty;
+
+        if (!result.is_empty) {
+            const auto second_tile = second(block);
+            result.is_empty = second_tile.is_empty;
+
+            if (!result.is_empty) {
+                const size_t count = block.width * block.height;
+                if (first_tile.values.size() != count || second_tile.values.size() != count) {
+                    throw EbvDifferenceException("EbvDifference: An operand returned a block of the wrong size");
+                }
+
+                result.values.resize(count);
+                apply(operation, first_tile.values.data(), second_tile.values.data(), result.values.data(), count);
+            }
+        }
+
+        if (result.is_empty) {
+            ++summary.empty_blocks;
+        }
+
+        consume(result);
+    }
+
+    return summary;
+}
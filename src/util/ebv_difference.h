@@ -0,0 +1,64 @@
+#ifndef MAPPING_EBV_EBV_DIFFERENCE_H
+#define MAPPING_EBV_EBV_DIFFERENCE_H
+
+#include "ebv_raster_reader.h"
+
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+/// Compares two entity grids of the same size, e.g. two scenarios or two time steps of one entity, block by block.
+///
+/// Blocks are aligned to the chunks of the entities, so each chunk is read once, and only one block of each operand
+/// is held at a time, independent of the size of the grid.
+class EbvDifference {
+    public:
+        struct EbvDifferenceException : public std::runtime_error {
+            using std::runtime_error::runtime_error;
+        };
+
+        enum class Operation {
+            /// `first - second`
+            Difference,
+            /// `first / second`
+            Ratio,
+            /// `(first - second) / second * 100`, the change from `second` to `first` in percent
+            PercentChange,
+        };
+
+        /// Reads a window of an operand
+        using Read = std::function<EbvRasterReader::Tile(const EbvRasterReader::Window &window)>;
+
+        /// Receives the result of each block, in row-major order of the blocks
+        using Consume = std::function<void(const EbvRasterReader::Tile &block)>;
+
+        struct Summary {
+            size_t blocks;
+            size_t empty_blocks;
+        };
+
+        /// Parses `difference`, `ratio` or `percent_change`
+        static auto parse_operation(const std::string &operation) -> Operation;
+
+        /// Splits `window` along a grid of `block_height` x `block_width` blocks that starts at the pixel (0, 0)
+        static auto blocks(const EbvRasterReader::Window &window, size_t block_height, size_t block_width) -> std::vector<EbvRasterReader::Window>;
+
+        /// Block size that is a multiple of the chunk size and has at least `min_block_size` pixels per side
+        static auto block_size(size_t chunk_size, size_t min_block_size = 256) -> size_t;
+
+        /// Applies `operation` to `count` values, results that are no finite number are NaN
+        static void apply(Operation operation, const float *first, const float *second, float *result, size_t count);
+
+        /// Reads both operands block by block and passes the results to `consume`.
+        /// A block is empty, without values, if either operand is empty there.
+        static auto stream(const EbvRasterReader::Window &window,
+                           size_t block_height,
+                           size_t block_width,
+                           Operation operation,
+                           const Read &first,
+                           const Read &second,
+                           const Consume &consume) -> Summary;
+};
+
+#endif //MAPPING_EBV_EBV_DIFFERENCE_H
@@ -0,0 +1,713 @@
+#include "ebv_metadata_cache.h"
+#include "ebv_reader_pool.h"
+
+#include <util/concat.h>
+#include <util/log.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <ftw.h>
+#include <sys/stat.h>
+
+auto EbvMetadataCache::FileMetadata::Axis::compress(const std::vector<double> &values) -> Axis {
+    Axis axis{false, 0, 0, values.size(), {}};
+
+    if (values.size() >= 2) {
+        axis.first = values[0];
+        axis.step = values[1] - values[0];
+        axis.is_regular = true;
+        for (size_t i = 0; i < values.size() && axis.is_regular; ++i) {
+            axis.is_regular = axis.first + static_cast<double>(i) * axis.step == values[i];
+        }
+    }
+
+    if (!axis.is_regular) {
+        axis.first = 0;
+        axis.step = 0;
+        axis.values = values;
+    }
+
+    return axis;
+}
+
+auto EbvMetadataCache::FileMetadata::Axis::expand() const -> std::vector<double> {
+    if (!is_regular) {
+        return values;
+    }
+
+    std::vector<double> expanded(count);
+    for (size_t i = 0; i < count; ++i) {
+        expanded[i] = first + static_cast<double>(i) * step;
+    }
+    return expanded;
+}
+
+auto EbvMetadataCache::FileMetadata::Axis::to_json() const -> Json::Value {
+    Json::Value json(Json::objectValue);
+    if (is_regular) {
+        json["first"] = first;
+        json["step"] = step;
+        json["count"] = static_cast<Json::UInt64>(count);
+    } else {
+        Json::Value values_json(Json::arrayValue);
+        for (const auto value : values) {
+            values_json.append(value);
+        }
+        json["values"] = values_json;
+    }
+    return json;
+}
+
+auto EbvMetadataCache::FileMetadata::Axis::from_json(const Json::Value &json) -> Axis {
+    Axis axis{!json.isMember("values"), 0, 0, 0, {}};
+    if (axis.is_regular) {
+        axis.first = json["first"].asDouble();
+        axis.step = json["step"].asDouble();
+        axis.count = json["count"].asUInt64();
+    } else {
+        for (const auto &value : json["values"]) {
+            axis.values.push_back(value.asDouble());
+        }
+        axis.count = axis.values.size();
+    }
+    return axis;
+}
+
+auto EbvMetadataCache::FileMetadata::subgroups() const -> std::vector<std::string> {
+    std::vector<std::string> names;
+    for (const auto id : subgroup_names) {
+        names.push_back(strings.get(id));
+    }
+    return names;
+}
+
+auto EbvMetadataCache::FileMetadata::subgroup_descriptions() const -> std::vector<std::string> {
+    std::vector<std::string> descriptions;
+    for (const auto id : subgroup_description_ids) {
+        descriptions.push_back(strings.get(id));
+    }
+    return descriptions;
+}
+
+auto EbvMetadataCache::FileMetadata::subgroup_values(const std::string &subgroup_name,
+                                                     const std::vector<std::string> &path,
+                                                     std::vector<NetCdfParser::NetCdfValue> &values) const -> bool {
+    if (path.size() >= subgroup_names.size() || strings.get(subgroup_names[path.size()]) != subgroup_name) {
+        return false;
+    }
+
+    const auto *node = find_node(path);
+    if (!node || !node->has_children) {
+        return false;
+    }
+
+    values.clear();
+    values.reserve(node->child_count);
+    for (uint32_t i = node->first_child; i < node->first_child + node->child_count; ++i) {
+        values.push_back(NetCdfParser::NetCdfValue{
+                .name = strings.get(nodes[i].name),
+                .label = strings.get(nodes[i].label),
+                .description = strings.get(nodes[i].description),
+        });
+    }
+    return true;
+}
+
+auto EbvMetadataCache::FileMetadata::child_names(const std::vector<std::string> &path,
+                                                 std::vector<std::string> &names) const -> bool {
+    const auto *node = find_node(path);
+    if (!node || !node->has_children) {
+        return false;
+    }
+
+    names.clear();
+    names.reserve(node->child_count);
+    for (uint32_t i = node->first_child; i < node->first_child + node->child_count; ++i) {
+        names.push_back(strings.get(nodes[i].name));
+    }
+    return true;
+}
+
+auto EbvMetadataCache::FileMetadata::unit_range(const std::vector<std::string> &entity_path,
+                                                std::array<double, 2> &range) const -> bool {
+    const auto *node = find_node(entity_path);
+    if (!node || !node->has_unit_range) {
+        return false;
+    }
+
+    range = node->unit_range;
+    return true;
+}
+
+auto EbvMetadataCache::FileMetadata::time_info() const -> NetCdfParser::NetCdfTimeInfo {
+    return {
+            .time_start = time_start,
+            .time_unit = strings.get(time_unit),
+            .delta = delta,
+            .delta_unit = strings.get(delta_unit),
+            .time_points_unix = time_points_unix.expand(),
+            .time_points = time_points.expand(),
+    };
+}
+
+void EbvMetadataCache::FileMetadata::set_time_info(const NetCdfParser::NetCdfTimeInfo &info) {
+    has_time_info = true;
+    time_start = info.time_start;
+    time_unit = strings.intern(info.time_unit);
+    delta = info.delta;
+    delta_unit = strings.intern(info.delta_unit);
+    time_points = Axis::compress(info.time_points);
+    time_points_unix = Axis::compress(info.time_points_unix);
+}
+
+auto EbvMetadataCache::FileMetadata::add_children(size_t parent,
+                                                  const std::vector<NetCdfParser::NetCdfValue> &values) -> size_t {
+    const auto first_child = nodes.size();
+
+    nodes[parent].first_child = static_cast<uint32_t>(first_child);
+    nodes[parent].child_count = static_cast<uint32_t>(values.size());
+    nodes[parent].has_children = true;
+
+    for (const auto &value : values) {
+        nodes.push_back(Node{
+                .name = strings.intern(value.name),
+                .label = strings.intern(value.label),
+                .description = strings.intern(value.description),
+                .first_child = 0,
+                .child_count = 0,
+                .has_children = false,
+                .has_unit_range = false,
+                .unit_range = {0, 0},
+        });
+    }
+
+    return first_child;
+}
+
+auto EbvMetadataCache::FileMetadata::memory_usage() const -> size_t {
+    return sizeof(FileMetadata)
+           + strings.memory_usage()
+           + (subgroup_names.capacity() + subgroup_description_ids.capacity()) * sizeof(StringArena::Id)
+           + nodes.capacity() * sizeof(Node)
+           + (time_points.values.capacity() + time_points_unix.values.capacity()) * sizeof(double)
+           + crs_code.capacity();
+}
+
+auto EbvMetadataCache::FileMetadata::find_node(const std::vector<std::string> &path) const -> const Node * {
+    if (nodes.empty()) {
+        return nullptr;
+    }
+
+    const Node *node = &nodes[0];
+    for (const auto &name : path) {
+        const Node *child = nullptr;
+        for (uint32_t i = node->first_child; i < node->first_child + node->child_count; ++i) {
+            if (strings.view(nodes[i].name) == name) {
+                child = &nodes[i];
+                break;
+            }
+        }
+        if (!child) {
+            return nullptr;
+        }
+        node = child;
+    }
+    return node;
+}
+
+auto EbvMetadataCache::FileMetadata::to_json() const -> Json::Value {
+    const auto id_array = [](const std::vector<StringArena::Id> &ids) -> Json::Value {
+        Json::Value array(Json::arrayValue);
+        for (const auto id : ids) {
+            array.append(id);
+        }
+        return array;
+    };
+
+    Json::Value json(Json::objectValue);
+    json["file_status"] = file_status.to_json();
+
+    Json::Value strings_json(Json::arrayValue);
+    for (StringArena::Id id = 0; id < strings.size(); ++id) {
+        strings_json.append(strings.get(id));
+    }
+    json["strings"] = strings_json;
+
+    json["subgroups"] = id_array(subgroup_names);
+    json["subgroup_descriptions"] = id_array(subgroup_description_ids);
+
+    // one array per node: name, label, description, first child, child count, has children, and the unit range
+    Json::Value nodes_json(Json::arrayValue);
+    for (const auto &node : nodes) {
+        Json::Value node_json(Json::arrayValue);
+        node_json.append(node.name);
+        node_json.append(node.label);
+        node_json.append(node.description);
+        node_json.append(node.first_child);
+        node_json.append(node.child_count);
+        node_json.append(node.has_children);
+        if (node.has_unit_range) {
+            node_json.append(node.unit_range[0]);
+            node_json.append(node.unit_range[1]);
+        }
+        nodes_json.append(node_json);
+    }
+    json["nodes"] = nodes_json;
+
+    if (has_time_info) {
+        Json::Value time_json(Json::objectValue);
+        time_json["time_start"] = time_start;
+        time_json["time_unit"] = time_unit;
+        time_json["delta"] = delta;
+        time_json["delta_unit"] = delta_unit;
+        time_json["time_points"] = time_points.to_json();
+        time_json["time_points_unix"] = time_points_unix.to_json();
+        json["time_info"] = time_json;
+    }
+
+    if (has_crs_code) {
+        json["crs_code"] = crs_code;
+    }
+
+    if (has_geo_reference) {
+        Json::Value geo_json(Json::objectValue);
+        geo_json["origin_x"] = geo_reference.origin_x;
+        geo_json["origin_y"] = geo_reference.origin_y;
+        geo_json["pixel_width"] = geo_reference.pixel_width;
+        geo_json["pixel_height"] = geo_reference.pixel_height;
+        geo_json["width"] = static_cast<Json::UInt64>(geo_reference.width);
+        geo_json["height"] = static_cast<Json::UInt64>(geo_reference.height);
+        json["geo_reference"] = geo_json;
+    }
+
+    return json;
+}
+
+auto EbvMetadataCache::FileMetadata::from_json(const Json::Value &json) -> FileMetadata {
+    const auto id_vector = [](const Json::Value &array) -> std::vector<StringArena::Id> {
+        std::vector<StringArena::Id> ids;
+        for (const auto &id : array) {
+            ids.push_back(id.asUInt());
+        }
+        return ids;
+    };
+
+    FileMetadata metadata;
+    metadata.file_status = FileStatus::from_json(json["file_status"]);
+
+    for (const auto &string : json["strings"]) {
+        metadata.strings.intern(string.asString());
+    }
+    metadata.strings.shrink();
+
+    metadata.subgroup_names = id_vector(json["subgroups"]);
+    metadata.subgroup_description_ids = id_vector(json["subgroup_descriptions"]);
+
+    const auto &nodes_json = json["nodes"];
+    metadata.nodes.reserve(nodes_json.size());
+    for (const auto &node_json : nodes_json) {
+        metadata.nodes.push_back(Node{
+                .name = node_json[0].asUInt(),
+                .label = node_json[1].asUInt(),
+                .description = node_json[2].asUInt(),
+                .first_child = node_json[3].asUInt(),
+                .child_count = node_json[4].asUInt(),
+                .has_children = node_json[5].asBool(),
+                .has_unit_range = node_json.size() > 6,
+                .unit_range = {node_json.get(6, 0.0).asDouble(), node_json.get(7, 0.0).asDouble()},
+        });
+    }
+
+    metadata.has_time_info = json.isMember("time_info");
+    if (metadata.has_time_info) {
+        const auto &time_json = json["time_info"];
+        metadata.time_start = time_json["time_start"].asDouble();
+        metadata.time_unit = time_json["time_unit"].asUInt();
+        metadata.delta = time_json["delta"].asInt();
+        metadata.delta_unit = time_json["delta_unit"].asUInt();
+        metadata.time_points = Axis::from_json(time_json["time_points"]);
+        metadata.time_points_unix = Axis::from_json(time_json["time_points_unix"]);
+    }
+
+    metadata.has_crs_code = json.isMember("crs_code");
+    if (metadata.has_crs_code) {
+        metadata.crs_code = json["crs_code"].asString();
+    }
+
+    metadata.has_geo_reference = json.isMember("geo_reference");
+    if (metadata.has_geo_reference) {
+        const auto &geo_json = json["geo_reference"];
+        metadata.geo_reference.origin_x = geo_json["origin_x"].asDouble();
+        metadata.geo_reference.origin_y = geo_json["origin_y"].asDouble();
+        metadata.geo_reference.pixel_width = geo_json["pixel_width"].asDouble();
+        metadata.geo_reference.pixel_height = geo_json["pixel_height"].asDouble();
+        metadata.geo_reference.width = geo_json["width"].asUInt64();
+        metadata.geo_reference.height = geo_json["height"].asUInt64();
+    }
+
+    return metadata;
+}
+
+auto EbvMetadataCache::instance() -> EbvMetadataCache & {
+    static EbvMetadataCache cache;
+    return cache;
+}
+
+auto EbvMetadataCache::get(const std::string &path) -> std::shared_ptr<const FileMetadata> {
+    const auto file_status = FileStatus::of(path);
+
+    std::shared_future<std::shared_ptr<const FileMetadata>> metadata;
+    std::promise<std::shared_ptr<const FileMetadata>> promise;
+    bool is_loading_thread = false;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        const auto slot = slots.find(path);
+        if (slot != slots.end() && slot->second.file_status == file_status) {
+            metadata = slot->second.metadata;
+        } else {
+            metadata = promise.get_future().share();
+            slots[path] = Slot{file_status, metadata};
+            is_loading_thread = true;
+        }
+    }
+
+    if (is_loading_thread) {
+        try {
+            promise.set_value(load(path));
+        } catch (...) {
+            promise.set_exception(std::current_exception());
+
+            // do not keep failures, the next request retries
+            std::lock_guard<std::mutex> lock(mutex);
+            const auto slot = slots.find(path);
+            if (slot != slots.end() && slot->second.file_status == file_status) {
+                slots.erase(slot);
+            }
+        }
+    }
+
+    return metadata.get();
+}
+
+auto EbvMetadataCache::subgroups(const std::string &path) -> std::vector<std::string> {
+    return get(path)->subgroups();
+}
+
+auto EbvMetadataCache::subgroup_descriptions(const std::string &path) -> std::vector<std::string> {
+    return get(path)->subgroup_descriptions();
+}
+
+auto EbvMetadataCache::subgroup_values(const std::string &path,
+                                       const std::string &subgroup_name,
+                                       const std::vector<std::string> &group_path) -> std::vector<NetCdfParser::NetCdfValue> {
+    std::vector<NetCdfParser::NetCdfValue> values;
+    if (get(path)->subgroup_values(subgroup_name, group_path, values)) {
+        return values;
+    }
+
+    // not part of the subgroup hierarchy, let the parser decide
+    return NetCdfParser(path).ebv_subgroup_values(subgroup_name, group_path);
+}
+
+auto EbvMetadataCache::time_info(const std::string &path) -> NetCdfParser::NetCdfTimeInfo {
+    const auto metadata = get(path);
+
+    if (!metadata->has_time_info) {
+        return NetCdfParser(path).time_info();
+    }
+
+    return metadata->time_info();
+}
+
+auto EbvMetadataCache::crs_as_code(const std::string &path) -> std::string {
+    const auto metadata = get(path);
+
+    if (!metadata->has_crs_code) {
+        return NetCdfParser(path).crs_as_code();
+    }
+
+    return metadata->crs_code;
+}
+
+auto EbvMetadataCache::geo_reference(const std::string &path) -> NetCdfParser::NetCdfGeoReference {
+    const auto metadata = get(path);
+
+    if (!metadata->has_geo_reference) {
+        return NetCdfParser(path).geo_reference();
+    }
+
+    return metadata->geo_reference;
+}
+
+auto EbvMetadataCache::unit_range(const std::string &path, const std::vector<std::string> &entity_path) -> std::array<double, 2> {
+    std::array<double, 2> unit_range{};
+    if (get(path)->unit_range(entity_path, unit_range)) {
+        return unit_range;
+    }
+
+    return NetCdfParser(path).unit_range(entity_path);
+}
+
+auto EbvMetadataCache::memory_usage() -> std::map<std::string, size_t> {
+    std::vector<std::pair<std::string, std::shared_future<std::shared_ptr<const FileMetadata>>>> loaded;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (const auto &slot : slots) {
+            loaded.emplace_back(slot.first, slot.second.metadata);
+        }
+    }
+
+    // files that are still loading or failed are skipped
+    std::map<std::string, size_t> usage;
+    for (const auto &file : loaded) {
+        if (file.second.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+            continue;
+        }
+        try {
+            usage[file.first] = file.second.get()->memory_usage();
+        } catch (...) {
+            continue;
+        }
+    }
+    return usage;
+}
+
+void EbvMetadataCache::clear() {
+    std::lock_guard<std::mutex> lock(mutex);
+    slots.clear();
+}
+
+auto EbvMetadataCache::load(const std::string &path) -> std::shared_ptr<const FileMetadata> {
+    auto &reader_pool = EbvReaderPool::instance();
+    if (reader_pool.is_running()) {
+        EbvReaderPool::Message request;
+        request.header["request"] = "metadata";
+        request.header["path"] = path;
+
+        try {
+            return std::make_shared<const FileMetadata>(FileMetadata::from_json(reader_pool.call(path, request).header));
+        } catch (const EbvReaderPool::WorkerUnavailableException &e) {
+            Log::warn(concat("EbvMetadataCache: parsing `", path, "` in-process (", e.what(), ")"));
+        }
+    }
+
+    return parse(path);
+}
+
+auto EbvMetadataCache::parse(const std::string &path) -> std::shared_ptr<const FileMetadata> {
+    auto metadata = std::make_shared<FileMetadata>();
+    metadata->file_status = FileStatus::of(path);
+
+    NetCdfParser parser(path);
+
+    for (const auto &subgroup : parser.ebv_subgroups()) {
+        metadata->subgroup_names.push_back(metadata->strings.intern(subgroup));
+    }
+    for (const auto &description : parser.ebv_subgroup_descriptions()) {
+        metadata->subgroup_description_ids.push_back(metadata->strings.intern(description));
+    }
+
+    // missing parts are left to the parser on access, so that errors are reported as before
+    try {
+        metadata->set_time_info(parser.time_info());
+    } catch (const std::exception &e) {
+        metadata->has_time_info = false;
+    } catch (const H5::Exception &e) {
+        metadata->has_time_info = false;
+    }
+
+    try {
+        metadata->crs_code = parser.crs_as_code();
+        metadata->has_crs_code = true;
+    } catch (const std::exception &e) {
+        metadata->has_crs_code = false;
+    } catch (const H5::Exception &e) {
+        metadata->has_crs_code = false;
+    }
+
+    try {
+        metadata->geo_reference = parser.geo_reference();
+        metadata->has_geo_reference = true;
+    } catch (const std::exception &e) {
+        metadata->has_geo_reference = false;
+    } catch (const H5::Exception &e) {
+        metadata->has_geo_reference = false;
+    }
+
+    metadata->nodes.push_back(FileMetadata::Node{}); // root
+    if (!metadata->subgroup_names.empty()) {
+        load_subgroup_level(parser, *metadata, 0, {}, 0);
+    }
+
+    metadata->strings.shrink();
+    metadata->nodes.shrink_to_fit();
+
+    return metadata;
+}
+
+/// Loads the values of the subgroup at `level` as the children of `node` and descends into each of them
+void EbvMetadataCache::load_subgroup_level(const NetCdfParser &parser,
+                                           FileMetadata &metadata,
+                                           size_t level,
+                                           const std::vector<std::string> &path,
+                                           size_t node) {
+    const auto subgroup_name = metadata.strings.get(metadata.subgroup_names[level]);
+
+    std::vector<NetCdfParser::NetCdfValue> values;
+    try {
+        values = parser.ebv_subgroup_values(subgroup_name, path);
+    } catch (const std::exception &e) {
+        return;
+    } catch (const H5::Exception &e) {
+        return;
+    }
+
+    const bool is_leaf = level + 1 == metadata.subgroup_names.size();
+    const auto first_child = metadata.add_children(node, values);
+
+    for (size_t i = 0; i < values.size(); ++i) {
+        std::vector<std::string> value_path(path);
+        value_path.push_back(values[i].name);
+
+        if (is_leaf) {
+            try {
+                metadata.nodes[first_child + i].unit_range = parser.unit_range(value_path);
+                metadata.nodes[first_child + i].has_unit_range = true;
+            } catch (const std::exception &e) {
+                // left to the parser on access
+            } catch (const H5::Exception &e) {
+                // left to the parser on access
+            }
+        } else {
+            load_subgroup_level(parser, metadata, level + 1, value_path, first_child + i);
+        }
+    }
+}
+
+auto EbvMetadataCache::warm_up(const std::string &directory, size_t number_of_threads) -> WarmUpSummary {
+    const auto start = std::chrono::steady_clock::now();
+
+    const auto files = list_netcdf_files(directory);
+    number_of_threads = std::max<size_t>(1, std::min(number_of_threads, files.size()));
+
+    hbool_t is_thread_safe = false;
+    H5is_library_threadsafe(&is_thread_safe);
+    if (!is_thread_safe) {
+        number_of_threads = 1; // parallel parsing requires the thread-safe HDF5 build
+    }
+
+    Log::info(concat("EbvMetadataCache: warming up ", files.size(), " files from `", directory,
+                     "` with ", number_of_threads, " threads"));
+
+    std::atomic<size_t> next_file(0);
+    std::atomic<size_t> loaded(0);
+    std::atomic<size_t> failed(0);
+
+    const size_t progress_step = std::max<size_t>(1, files.size() / 10);
+
+    auto worker = [&]() {
+        for (auto i = next_file++; i < files.size(); i = next_file++) {
+            try {
+                get(files[i]);
+                ++loaded;
+            } catch (const std::exception &e) {
+                ++failed;
+                Log::warn(concat("EbvMetadataCache: unable to load `", files[i], "` (", e.what(), ")"));
+            } catch (const H5::Exception &e) {
+                ++failed;
+                Log::warn(concat("EbvMetadataCache: unable to load `", files[i], "` (", e.getDetailMsg(), ")"));
+            }
+
+            const auto done = loaded + failed;
+            if (done % progress_step == 0) {
+                Log::info(concat("EbvMetadataCache: warm-up progress ", done, "/", files.size()));
+            }
+        }
+    };
+
+    std::vector<std::thread> threads;
+    threads.reserve(number_of_threads);
+    for (size_t i = 0; i < number_of_threads; ++i) {
+        threads.emplace_back(worker);
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+
+    size_t memory_bytes = 0;
+    std::pair<std::string, size_t> largest_file;
+    for (const auto &file : memory_usage()) {
+        Log::debug(concat("EbvMetadataCache: metadata of `", file.first, "` uses ", file.second, " bytes"));
+        memory_bytes += file.second;
+        if (file.second > largest_file.second) {
+            largest_file = file;
+        }
+    }
+
+    const WarmUpSummary summary{
+            .files = files.size(),
+            .loaded = loaded,
+            .failed = failed,
+            .seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count(),
+            .memory_bytes = memory_bytes,
+            .largest_file = largest_file.first,
+            .largest_file_bytes = largest_file.second,
+    };
+
+    Log::info(concat("EbvMetadataCache: warm-up finished, loaded ", summary.loaded, " and failed ", summary.failed,
+                     " of ", summary.files, " files in ", summary.seconds, "s, using ", summary.memory_bytes,
+                     " bytes, at most ", summary.largest_file_bytes, " bytes for `", summary.largest_file, "`"));
+
+    return summary;
+}
+
+void EbvMetadataCache::warm_up_in_background(const std::string &directory, size_t number_of_threads) {
+    std::call_once(warm_up_flag, [this, directory, number_of_threads]() {
+        std::thread([this, directory, number_of_threads]() {
+            try {
+                warm_up(directory, number_of_threads);
+            } catch (const std::exception &e) {
+                Log::error(concat("EbvMetadataCache: warm-up failed (", e.what(), ")"));
+            }
+        }).detach();
+    });
+}
+
+/// `nftw` offers no user data pointer, so the listing is collected in a thread-local vector
+static thread_local std::vector<std::string> *netcdf_file_listing = nullptr;
+
+auto EbvMetadataCache::list_netcdf_files(const std::string &directory) -> std::vector<std::string> {
+    std::string root = directory;
+    while (root.size() > 1 && root.back() == '/') {
+        root.pop_back(); // `nftw` would report paths with double slashes otherwise
+    }
+
+    std::vector<std::string> files;
+    netcdf_file_listing = &files;
+
+    const auto visit = [](const char *file_path, const struct stat *, int type, struct FTW *) -> int {
+        const std::string path(file_path);
+        const std::string extension = ".nc";
+        if (type == FTW_F
+            && path.size() > extension.size()
+            && path.compare(path.size() - extension.size(), extension.size(), extension) == 0) {
+            netcdf_file_listing->push_back(path);
+        }
+        return 0;
+    };
+
+    const int result = nftw(root.c_str(), visit, 16, FTW_PHYS);
+    netcdf_file_listing = nullptr;
+
+    if (result != 0) {
+        throw NetCdfParser::NetCdfParserException(concat("Unable to list directory `", directory, "`"));
+    }
+
+    std::sort(files.begin(), files.end());
+
+    return files;
+}
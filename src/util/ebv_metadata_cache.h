@@ -0,0 +1,196 @@
+#ifndef MAPPING_EBV_EBV_METADATA_CACHE_H
+#define MAPPING_EBV_EBV_METADATA_CACHE_H
+
+#include "file_status.h"
+#include "netcdf_parser.h"
+#include "string_arena.h"
+
+#include <json/json.h>
+
+#include <array>
+#include <cstdint>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/// Process-wide cache of parsed EBV file metadata.
+///
+/// Entries are loaded completely on first access and re-loaded if the file was modified.
+/// Concurrent requests for the same file wait for a single load instead of parsing it twice.
+class EbvMetadataCache {
+    public:
+        /// All metadata of one EBV file that is served by the catalog, in a compact form.
+        ///
+        /// Strings are interned in one arena per file, the subgroup values form a flat tree of nodes, and time axes
+        /// with a constant step are only stored as their first value and step.
+        struct FileMetadata {
+            /// One value of a subgroup, whose children are the values of the next subgroup below it
+            struct Node {
+                StringArena::Id name;
+                StringArena::Id label;
+                StringArena::Id description;
+
+                /// children are `nodes[first_child, first_child + child_count)`
+                uint32_t first_child;
+                uint32_t child_count;
+                /// `false` if the values below it could not be read, these are left to the parser
+                bool has_children;
+
+                bool has_unit_range;
+                std::array<double, 2> unit_range;
+            };
+
+            /// Values that are either `first + i * step` or stored one by one
+            struct Axis {
+                bool is_regular;
+                double first;
+                double step;
+                size_t count;
+                std::vector<double> values;
+
+                /// Stores `values` as parameters if they reproduce them exactly
+                static auto compress(const std::vector<double> &values) -> Axis;
+
+                auto expand() const -> std::vector<double>;
+
+                auto to_json() const -> Json::Value;
+
+                static auto from_json(const Json::Value &json) -> Axis;
+            };
+
+            /// Status of the file when it was parsed
+            FileStatus file_status;
+
+            StringArena strings;
+
+            std::vector<StringArena::Id> subgroup_names;
+            std::vector<StringArena::Id> subgroup_description_ids;
+
+            /// `nodes[0]` is the root, whose children are the values of the first subgroup
+            std::vector<Node> nodes;
+
+            bool has_time_info;
+            double time_start;
+            StringArena::Id time_unit;
+            int delta;
+            StringArena::Id delta_unit;
+            Axis time_points;
+            Axis time_points_unix;
+
+            bool has_crs_code;
+            std::string crs_code;
+
+            bool has_geo_reference;
+            NetCdfParser::NetCdfGeoReference geo_reference;
+
+            auto subgroups() const -> std::vector<std::string>;
+
+            auto subgroup_descriptions() const -> std::vector<std::string>;
+
+            /// The values of a subgroup below `path`, returns `false` if they are not part of the subgroup hierarchy
+            auto subgroup_values(const std::string &subgroup_name,
+                                 const std::vector<std::string> &path,
+                                 std::vector<NetCdfParser::NetCdfValue> &values) const -> bool;
+
+            /// Only the names of the values below `path`, returns `false` if they are not known
+            auto child_names(const std::vector<std::string> &path, std::vector<std::string> &names) const -> bool;
+
+            /// Returns `false` if the unit range of the entity is unknown
+            auto unit_range(const std::vector<std::string> &entity_path, std::array<double, 2> &range) const -> bool;
+
+            auto time_info() const -> NetCdfParser::NetCdfTimeInfo;
+
+            void set_time_info(const NetCdfParser::NetCdfTimeInfo &info);
+
+            /// Appends `values` as the children of `parent`, next to each other, and returns the index of the first one
+            auto add_children(size_t parent, const std::vector<NetCdfParser::NetCdfValue> &values) -> size_t;
+
+            /// Bytes that the metadata occupies in memory
+            auto memory_usage() const -> size_t;
+
+            auto to_json() const -> Json::Value;
+
+            static auto from_json(const Json::Value &json) -> FileMetadata;
+
+        private:
+            /// Node of `path` below the root, or `nullptr`
+            auto find_node(const std::vector<std::string> &path) const -> const Node *;
+        };
+
+        struct WarmUpSummary {
+            size_t files;
+            size_t loaded;
+            size_t failed;
+            double seconds;
+            /// of the metadata of all loaded files
+            size_t memory_bytes;
+            /// the file with the largest metadata, the sizes of all files are logged at debug level
+            std::string largest_file;
+            size_t largest_file_bytes;
+        };
+
+        static auto instance() -> EbvMetadataCache &;
+
+        /// Retrieve the metadata of `path`, loading it if it is not cached or outdated
+        auto get(const std::string &path) -> std::shared_ptr<const FileMetadata>;
+
+        auto subgroups(const std::string &path) -> std::vector<std::string>;
+
+        auto subgroup_descriptions(const std::string &path) -> std::vector<std::string>;
+
+        auto subgroup_values(const std::string &path,
+                             const std::string &subgroup_name,
+                             const std::vector<std::string> &group_path) -> std::vector<NetCdfParser::NetCdfValue>;
+
+        auto time_info(const std::string &path) -> NetCdfParser::NetCdfTimeInfo;
+
+        auto crs_as_code(const std::string &path) -> std::string;
+
+        auto geo_reference(const std::string &path) -> NetCdfParser::NetCdfGeoReference;
+
+        auto unit_range(const std::string &path, const std::vector<std::string> &entity_path) -> std::array<double, 2>;
+
+        /// Parse all NetCDF files below `directory` with `number_of_threads` workers and fill the cache
+        auto warm_up(const std::string &directory, size_t number_of_threads) -> WarmUpSummary;
+
+        /// Run `warm_up` once per process in a background thread
+        void warm_up_in_background(const std::string &directory, size_t number_of_threads);
+
+        void clear();
+
+        /// Bytes of the cached metadata per file
+        auto memory_usage() -> std::map<std::string, size_t>;
+
+        /// Recursively list all `*.nc` files below `directory`
+        static auto list_netcdf_files(const std::string &directory) -> std::vector<std::string>;
+
+        /// Parses the metadata of `path` in the reader pool, if it is running, and in this process otherwise
+        static auto load(const std::string &path) -> std::shared_ptr<const FileMetadata>;
+
+        /// Parses the metadata of `path` in this process
+        static auto parse(const std::string &path) -> std::shared_ptr<const FileMetadata>;
+
+    private:
+        EbvMetadataCache() = default;
+
+        struct Slot {
+            FileStatus file_status;
+            std::shared_future<std::shared_ptr<const FileMetadata>> metadata;
+        };
+
+        static void load_subgroup_level(const NetCdfParser &parser,
+                                        FileMetadata &metadata,
+                                        size_t level,
+                                        const std::vector<std::string> &path,
+                                        size_t node);
+
+        std::mutex mutex;
+        std::map<std::string, Slot> slots;
+
+        std::once_flag warm_up_flag;
+};
+
+#endif //MAPPING_EBV_EBV_METADATA_CACHE_H
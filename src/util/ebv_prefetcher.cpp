@@ -0,0 +1,286 @@
+#include "ebv_prefetcher.h"
+
+#include <util/concat.h>
+#include <util/log.h>
+
+#include <algorithm>
+
+auto EbvPrefetcher::TileKey::to_string() const -> std::string {
+    std::string key = file;
+    for (const auto &name : entity_path) {
+        key += '/';
+        key += name;
+    }
+    return concat(key, '\n', time_index, '\n', x, ',', y, ',', width, ',', height);
+}
+
+auto EbvPrefetcher::instance() -> EbvPrefetcher & {
+    static EbvPrefetcher prefetcher;
+    return prefetcher;
+}
+
+EbvPrefetcher::~EbvPrefetcher() {
+    stop();
+}
+
+void EbvPrefetcher::start(size_t threads, size_t max_bytes, size_t time_steps_ahead, Read read) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (!this->threads.empty()) {
+        return;
+    }
+
+    this->max_bytes = max_bytes;
+    this->time_steps_ahead = std::max<size_t>(time_steps_ahead, 1);
+    this->read = std::move(read);
+    is_stopping = false;
+
+    for (size_t i = 0; i < std::max<size_t>(threads, 1); ++i) {
+        this->threads.emplace_back(&EbvPrefetcher::work, this);
+    }
+}
+
+void EbvPrefetcher::stop() {
+    std::vector<std::thread> stopping_threads;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        is_stopping = true;
+        counters.cancelled += jobs.size();
+        jobs.clear();
+        stopping_threads.swap(threads);
+    }
+    jobs_available.notify_all();
+
+    for (auto &thread : stopping_threads) {
+        thread.join();
+    }
+}
+
+auto EbvPrefetcher::is_running() const -> bool {
+    std::lock_guard<std::mutex> lock(mutex);
+    return !threads.empty();
+}
+
+auto EbvPrefetcher::get(const TileKey &key, EbvRasterReader::Tile &tile) -> bool {
+    const auto status = FileStatus::of(key.file);
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    auto entry = tiles.find(key.to_string());
+    if (entry == tiles.end()) {
+        ++counters.misses;
+        return false;
+    }
+
+    if (entry->second.status != status) {
+        bytes -= entry->second.bytes;
+        lru.erase(entry->second.lru_position);
+        tiles.erase(entry);
+        ++counters.misses;
+        return false;
+    }
+
+    lru.splice(lru.begin(), lru, entry->second.lru_position);
+    tile = entry->second.tile;
+    ++counters.hits;
+
+    return true;
+}
+
+void EbvPrefetcher::put(const TileKey &key, const EbvRasterReader::Tile &tile, const FileStatus &status) {
+    const auto string_key = key.to_string();
+    Entry entry{status, tile, tile_bytes(tile) + string_key.size(), {}};
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    auto existing = tiles.find(string_key);
+    if (existing != tiles.end()) {
+        bytes -= existing->second.bytes;
+        lru.erase(existing->second.lru_position);
+        tiles.erase(existing);
+    }
+
+    if (entry.bytes <= max_bytes) {
+        lru.push_front(string_key);
+        entry.lru_position = lru.begin();
+        bytes += entry.bytes;
+        tiles.emplace(string_key, std::move(entry));
+    }
+
+    evict();
+}
+
+void EbvPrefetcher::record(const std::string &session,
+                           const TileKey &key,
+                           size_t time_steps,
+                           const std::vector<std::vector<std::string>> &siblings) {
+    std::unique_lock<std::mutex> lock(mutex);
+
+    if (threads.empty()) {
+        return;
+    }
+
+    auto existing = sessions.find(session);
+    const auto predictions = predict(existing != sessions.end() ? &existing->second.last_access : nullptr,
+                                     key, time_steps, siblings, time_steps_ahead);
+
+    if (existing == sessions.end()) {
+        if (sessions.size() >= max_sessions) {
+            sessions.erase(session_lru.back());
+            session_lru.pop_back();
+        }
+        session_lru.push_front(session);
+        sessions.emplace(session, Session{key, session_lru.begin()});
+    } else {
+        existing->second.last_access = key;
+        session_lru.splice(session_lru.begin(), session_lru, existing->second.lru_position);
+    }
+
+    // the session moved on, so its older predictions are not needed anymore
+    const auto size_before = jobs.size();
+    jobs.erase(std::remove_if(jobs.begin(), jobs.end(), [&session](const Job &job) {
+        return job.session == session;
+    }), jobs.end());
+    counters.cancelled += size_before - jobs.size();
+
+    for (const auto &prediction : predictions) {
+        if (tiles.find(prediction.to_string()) == tiles.end()) {
+            jobs.push_back(Job{prediction, session});
+        }
+    }
+
+    while (jobs.size() > max_queue_length) {
+        jobs.pop_front();
+        ++counters.cancelled;
+    }
+
+    lock.unlock();
+    jobs_available.notify_all();
+}
+
+auto EbvPrefetcher::predict(const TileKey *previous,
+                            const TileKey &current,
+                            size_t time_steps,
+                            const std::vector<std::vector<std::string>> &siblings,
+                            size_t time_steps_ahead) -> std::vector<TileKey> {
+    const bool is_same_window = previous != nullptr
+                                && previous->file == current.file
+                                && previous->x == current.x && previous->y == current.y
+                                && previous->width == current.width && previous->height == current.height;
+    const bool is_same_entity = is_same_window && previous->entity_path == current.entity_path;
+
+    // stepping through time continues in the same direction, otherwise both neighbours are equally likely
+    long direction = 1;
+    if (is_same_entity && previous->time_index > current.time_index) {
+        direction = -1;
+    }
+    const bool is_stepping = is_same_entity && previous->time_index != current.time_index;
+    const bool is_switching_entities = is_same_window && !is_same_entity
+                                       && previous->time_index == current.time_index;
+
+    std::vector<TileKey> time_neighbours;
+    const auto add_time_step = [&](long offset) {
+        const long time_index = static_cast<long>(current.time_index) + offset;
+        if (time_index >= 0 && static_cast<size_t>(time_index) < time_steps) {
+            TileKey key = current;
+            key.time_index = static_cast<size_t>(time_index);
+            time_neighbours.push_back(std::move(key));
+        }
+    };
+    for (size_t step = 1; step <= (is_stepping ? time_steps_ahead : 1); ++step) {
+        add_time_step(direction * static_cast<long>(step));
+    }
+    add_time_step(-direction);
+
+    // siblings next to the current entity, in the order of the file
+    std::vector<TileKey> entity_neighbours;
+    const auto position = std::find(siblings.begin(), siblings.end(), current.entity_path);
+    if (position != siblings.end()) {
+        const auto index = static_cast<long>(position - siblings.begin());
+        for (long distance = 1; distance <= static_cast<long>(time_steps_ahead); ++distance) {
+            for (const long sibling : {index + distance, index - distance}) {
+                if (sibling >= 0 && sibling < static_cast<long>(siblings.size())) {
+                    TileKey key = current;
+                    key.entity_path = siblings[static_cast<size_t>(sibling)];
+                    entity_neighbours.push_back(std::move(key));
+                }
+            }
+        }
+    }
+
+    auto predictions = is_switching_entities ? entity_neighbours : time_neighbours;
+    const auto &others = is_switching_entities ? time_neighbours : entity_neighbours;
+    predictions.insert(predictions.end(), others.begin(), others.end());
+
+    return predictions;
+}
+
+auto EbvPrefetcher::statistics() const -> Statistics {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    auto statistics = counters;
+    statistics.bytes = bytes;
+    return statistics;
+}
+
+void EbvPrefetcher::clear() {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    tiles.clear();
+    lru.clear();
+    bytes = 0;
+    sessions.clear();
+    session_lru.clear();
+    jobs.clear();
+}
+
+void EbvPrefetcher::work() {
+    while (true) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            jobs_available.wait(lock, [this]() { return is_stopping || !jobs.empty(); });
+
+            if (is_stopping) {
+                return;
+            }
+
+            job = std::move(jobs.front());
+            jobs.pop_front();
+
+            if (tiles.find(job.key.to_string()) != tiles.end()) {
+                continue;
+            }
+        }
+
+        // taken before the read, so that a modification during the read outdates the tile
+        const auto status = FileStatus::of(job.key.file);
+
+        // any exception would end the thread and with it the service
+        try {
+            put(job.key, read(job.key), status);
+
+            std::lock_guard<std::mutex> lock(mutex);
+            ++counters.prefetched;
+        } catch (const std::exception &e) {
+            Log::debug(concat("EbvPrefetcher: Skipping `", job.key.file, "` (", e.what(), ")"));
+        } catch (const H5::Exception &e) {
+            Log::debug(concat("EbvPrefetcher: Skipping `", job.key.file, "` (", e.getDetailMsg(), ")"));
+        } catch (...) {
+            Log::debug(concat("EbvPrefetcher: Skipping `", job.key.file, "` (unknown error)"));
+        }
+    }
+}
+
+void EbvPrefetcher::evict() {
+    while (bytes > max_bytes && !lru.empty()) {
+        const auto entry = tiles.find(lru.back());
+        bytes -= entry->second.bytes;
+        tiles.erase(entry);
+        lru.pop_back();
+    }
+}
+
+auto EbvPrefetcher::tile_bytes(const EbvRasterReader::Tile &tile) -> size_t {
+    return sizeof(Entry) + tile.values.capacity() * sizeof(float);
+}
@@ -0,0 +1,150 @@
+#ifndef MAPPING_EBV_EBV_PREFETCHER_H
+#define MAPPING_EBV_EBV_PREFETCHER_H
+
+#include "ebv_raster_reader.h"
+#include "file_status.h"
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <list>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/// Cache of entity tiles that is filled ahead of the requests of each session.
+///
+/// Users step through time or switch between sibling entities once they opened a layer, so after each access the
+/// adjacent time steps and the siblings at the same time step are read on background threads.
+/// A new access of a session cancels the predictions of its previous one that were not read yet.
+///
+/// The threads run at normal priority: a read that holds a lock which requests wait for would otherwise be starved by
+/// them, so `Read` itself must avoid such locks, e.g. by only taking readers that are idle.
+class EbvPrefetcher {
+    public:
+        /// A tile as it was requested, a negative `width` or `height` extends to the edge of the grid
+        struct TileKey {
+            std::string file;
+            std::vector<std::string> entity_path;
+            size_t time_index;
+            int x;
+            int y;
+            int width;
+            int height;
+
+            auto to_string() const -> std::string;
+        };
+
+        /// Reads a tile in the background, exceptions drop the tile
+        using Read = std::function<EbvRasterReader::Tile(const TileKey &key)>;
+
+        struct Statistics {
+            size_t hits;
+            size_t misses;
+            size_t prefetched;
+            size_t cancelled;
+            size_t bytes;
+        };
+
+        static auto instance() -> EbvPrefetcher &;
+
+        EbvPrefetcher() = default;
+
+        ~EbvPrefetcher();
+
+        EbvPrefetcher(const EbvPrefetcher &) = delete;
+
+        EbvPrefetcher &operator=(const EbvPrefetcher &) = delete;
+
+        /// Starts `threads` background threads that read with `read`, and keeps at most `max_bytes` of tiles.
+        /// Does nothing if it is running.
+        void start(size_t threads, size_t max_bytes, size_t time_steps_ahead, Read read);
+
+        /// Cancels all predictions and waits for the threads
+        void stop();
+
+        auto is_running() const -> bool;
+
+        /// Retrieve a cached tile, which is then the most recently used one.
+        /// Tiles of files that were modified since they were read are dropped.
+        auto get(const TileKey &key, EbvRasterReader::Tile &tile) -> bool;
+
+        /// Caches `tile`, read from the file of `key` in `status`, which must be taken before the read so that a tile
+        /// of a file modified during the read is dropped
+        void put(const TileKey &key, const EbvRasterReader::Tile &tile, const FileStatus &status);
+
+
+        /// Records an access of `session` and queues the tiles that it will likely request next.
+        /// `siblings` are the entity paths next to the one of `key`, and `time_steps` the length of the time axis.
+        void record(const std::string &session,
+                    const TileKey &key,
+                    size_t time_steps,
+                    const std::vector<std::vector<std::string>> &siblings);
+
+        /// The tiles that follow `current` most likely, most likely first.
+        /// If `previous` is on the same time series, the time steps in its direction come first.
+        static auto predict(const TileKey *previous,
+                            const TileKey &current,
+                            size_t time_steps,
+                            const std::vector<std::vector<std::string>> &siblings,
+                            size_t time_steps_ahead) -> std::vector<TileKey>;
+
+        auto statistics() const -> Statistics;
+
+        void clear();
+
+        /// Queued predictions of all sessions, older ones are dropped beyond that
+        static constexpr size_t max_queue_length = 256;
+
+        /// Sessions whose last access is tracked, the least recently active ones are forgotten first
+        static constexpr size_t max_sessions = 1024;
+
+    private:
+        struct Entry {
+            FileStatus status;
+            EbvRasterReader::Tile tile;
+            size_t bytes;
+            std::list<std::string>::iterator lru_position;
+        };
+
+        struct Session {
+            TileKey last_access;
+            std::list<std::string>::iterator lru_position;
+        };
+
+        struct Job {
+            TileKey key;
+            std::string session;
+        };
+
+        void work();
+
+        void evict();
+
+        static auto tile_bytes(const EbvRasterReader::Tile &tile) -> size_t;
+
+        mutable std::mutex mutex;
+        std::condition_variable jobs_available;
+
+        std::map<std::string, Entry> tiles;
+        /// most recently used first
+        std::list<std::string> lru;
+        size_t bytes = 0;
+        size_t max_bytes = 0;
+
+        std::map<std::string, Session> sessions;
+        /// most recently active first
+        std::list<std::string> session_lru;
+        std::deque<Job> jobs;
+        size_t time_steps_ahead = 1;
+
+        Read read;
+        std::vector<std::thread> threads;
+        bool is_stopping = false;
+
+        Statistics counters{0, 0, 0, 0, 0};
+};
+
+#endif //MAPPING_EBV_EBV_PREFETCHER_H
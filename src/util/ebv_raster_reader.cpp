@@ -0,0 +1,202 @@
+#include "ebv_raster_reader.h"
+
+#include <util/concat.h>
+#include <util/log.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+static auto load_presence_index(const std::string &path) -> std::shared_ptr<const EbvDataPresenceIndex> {
+    std::string error;
+    auto presence_index = EbvDataPresenceIndex::load(path, &error);
+    if (!error.empty()) {
+        Log::warn(concat("EbvRasterReader: ", error));
+    }
+    return presence_index;
+}
+
+EbvRasterReader::EbvRasterReader(const std::string &path)
+        : path(path),
+          presence_index(load_presence_index(path)) {}
+
+auto EbvRasterReader::h5_file() const -> const H5::H5File & {
+    // a failed open throws and is retried by the next call
+    std::call_once(file_flag, [this]() {
+        file.reset(new H5::H5File(path, H5F_ACC_RDONLY));
+    });
+    return *file;
+}
+
+auto EbvRasterReader::dataset_info(const std::string &dataset_path) const -> std::shared_ptr<const DatasetInfo> {
+    std::lock_guard<std::mutex> lock(datasets_mutex);
+
+    const auto existing = datasets.find(dataset_path);
+    if (existing != datasets.end()) {
+        return existing->second;
+    }
+
+    const auto dataset = h5_file().openDataSet(dataset_path);
+    const auto space = dataset.getSpace();
+
+    if (space.getSimpleExtentNdims() != 3) {
+        throw EbvRasterReaderException("Entity `" + dataset_path + "` is no (time, lat, lon) grid");
+    }
+
+    hsize_t dimensions[3];
+    space.getSimpleExtentDims(dimensions);
+
+    const auto info = std::make_shared<const DatasetInfo>(DatasetInfo{
+            GridSize{dimensions[0], dimensions[1], dimensions[2]},
+            Hdf5TypedReader::packing(dataset),
+            Hdf5MappedDataset::map(path, dataset),
+    });
+    datasets.emplace(dataset_path, info);
+
+    return info;
+}
+
+auto EbvRasterReader::grid_size(const std::vector<std::string> &entity_path) const -> GridSize {
+    return dataset_info(entity_dataset_path(entity_path))->size;
+}
+
+auto EbvRasterReader::chunk_size(const std::vector<std::string> &entity_path) const -> GridSize {
+    const auto dataset = h5_file().openDataSet(entity_dataset_path(entity_path));
+    const auto creation_properties = dataset.getCreatePlist();
+
+    hsize_t chunk_dimensions[3] = {1, EbvDataPresenceIndex::default_block_size, EbvDataPresenceIndex::default_block_size};
+    if (creation_properties.getLayout() == H5D_CHUNKED && creation_properties.getChunk(3, chunk_dimensions) != 3) {
+        throw EbvRasterReaderException("Entity `" + entity_dataset_path(entity_path) + "` is no (time, lat, lon) grid");
+    }
+
+    return {chunk_dimensions[0], chunk_dimensions[1], chunk_dimensions[2]};
+}
+
+auto EbvRasterReader::read(const std::vector<std::string> &entity_path, size_t time_index, const Window &window) const -> Tile {
+    const auto dataset_path = entity_dataset_path(entity_path);
+
+    Tile tile{window, false, {}, std::nanf("")};
+
+    // the index knows the shape of the grid, so empty windows are answered without opening the file
+    const auto entity_index = presence_index ? presence_index->entity(dataset_path) : nullptr;
+    if (entity_index) {
+        check_window(dataset_path, GridSize{entity_index->time_steps.size(), entity_index->height, entity_index->width},
+                     time_index, window);
+
+        if (!presence_index->has_data(dataset_path, time_index, window)) {
+            tile.is_empty = true;
+            return tile;
+        }
+    }
+
+    const auto info = dataset_info(dataset_path);
+    check_window(dataset_path, info->size, time_index, window);
+
+    tile.values.resize(window.width * window.height);
+
+    if (info->mapping) {
+        read_mapped(*info->mapping, info->packing, time_index, window, tile.values.data(), tile.no_data);
+        return tile;
+    }
+
+    const auto dataset = h5_file().openDataSet(dataset_path);
+    H5::DataSpace file_space = dataset.getSpace();
+    const hsize_t offset[3] = {time_index, window.y_offset, window.x_offset};
+    const hsize_t count[3] = {1, window.height, window.width};
+    file_space.selectHyperslab(H5S_SELECT_SET, count, offset);
+    Hdf5TypedReader::read_dataset_unpacked(dataset, info->packing, tile.values.data(), tile.no_data, file_space);
+
+    return tile;
+}
+
+void EbvRasterReader::check_window(const std::string &dataset_path,
+                                   const GridSize &size,
+                                   size_t time_index,
+                                   const Window &window) {
+    if (time_index >= size.time_steps
+        || window.x_offset + window.width > size.width
+        || window.y_offset + window.height > size.height) {
+        throw EbvRasterReaderException("Window exceeds the grid of `" + dataset_path + "`");
+    }
+}
+
+void EbvRasterReader::read_mapped(const Hdf5MappedDataset &mapping,
+                                  const Hdf5TypedReader::Packing &packing,
+                                  size_t time_index,
+                                  const Window &window,
+                                  float *target,
+                                  float no_data) {
+    if (window.width == 0 || window.height == 0) {
+        return;
+    }
+
+    const auto &dimensions = mapping.dimensions();
+    const size_t row_stride = dimensions[2];
+    const size_t first = (time_index * dimensions[1] + window.y_offset) * row_stride + window.x_offset;
+    const size_t span = (window.height - 1) * row_stride + window.width;
+
+    if (span * mapping.element_size() >= will_need_threshold) {
+        mapping.will_need(first, span);
+    }
+
+    const auto *source_bytes = static_cast<const uint8_t *>(mapping.data()) + first * mapping.element_size();
+
+    // floats are stored as they are served, one copy per row suffices regardless of their alignment
+    if (mapping.numeric_type() == Hdf5TypedReader::NumericType::Float
+        && packing.scale_factor == 1. && packing.add_offset == 0.) {
+        for (size_t row = 0; row < window.height; ++row) {
+            std::memcpy(target + row * window.width, source_bytes + row * row_stride * sizeof(float), window.width * sizeof(float));
+        }
+
+        if (packing.has_fill_value) {
+            const auto fill_value = static_cast<float>(packing.fill_value);
+            const bool fill_value_is_nan = std::isnan(fill_value);
+            std::replace_if(target, target + window.width * window.height, [fill_value, fill_value_is_nan](float value) {
+                return value == fill_value || (fill_value_is_nan && std::isnan(value));
+            }, no_data);
+        }
+        return;
+    }
+
+    Hdf5TypedReader::dispatch(mapping.numeric_type(), [&](auto tag) {
+        using Source = typename decltype(tag)::type;
+
+        const size_t row_bytes = row_stride * sizeof(Source);
+
+        if (reinterpret_cast<uintptr_t>(source_bytes) % alignof(Source) == 0) {
+            for (size_t row = 0; row < window.height; ++row) {
+                const auto *values = reinterpret_cast<const Source *>(source_bytes + row * row_bytes);
+                Hdf5TypedReader::unpack(values, target + row * window.width, window.width, packing, no_data);
+            }
+            return;
+        }
+
+        // HDF5 only aligns the storage of datasets to single bytes, so rows are copied to aligned memory first,
+        // which is the target row itself for types that are not larger than the unpacked floats
+        if (sizeof(Source) <= sizeof(float)) {
+            for (size_t row = 0; row < window.height; ++row) {
+                auto *target_row = target + row * window.width;
+                std::memcpy(target_row, source_bytes + row * row_bytes, window.width * sizeof(Source));
+                Hdf5TypedReader::unpack(reinterpret_cast<const Source *>(target_row), target_row, window.width, packing, no_data);
+            }
+            return;
+        }
+
+        std::vector<Source> aligned_row(window.width);
+        for (size_t row = 0; row < window.height; ++row) {
+            std::memcpy(aligned_row.data(), source_bytes + row * row_bytes, window.width * sizeof(Source));
+            Hdf5TypedReader::unpack(aligned_row.data(), target + row * window.width, window.width, packing, no_data);
+        }
+    });
+}
+
+auto EbvRasterReader::entity_dataset_path(const std::vector<std::string> &entity_path) -> std::string {
+    std::string dataset_path;
+    for (const auto &part : entity_path) {
+        if (!dataset_path.empty()) {
+            dataset_path += '/';
+        }
+        dataset_path += part;
+    }
+    return dataset_path;
+}
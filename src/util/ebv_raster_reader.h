@@ -0,0 +1,95 @@
+#ifndef MAPPING_EBV_EBV_RASTER_READER_H
+#define MAPPING_EBV_EBV_RASTER_READER_H
+
+#include "ebv_data_presence_index.h"
+#include "hdf5_mapped_dataset.h"
+#include "hdf5_typed_reader.h"
+
+#include <H5Cpp.h>
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+/// Reads spatial windows of EBV entities, which are datasets of shape (time, lat, lon).
+///
+/// Windows that the data presence index proves to be empty are answered without any I/O, the HDF5 file is only opened
+/// once a window needs to be read.
+/// Entities that are stored contiguously and unfiltered are read from a memory mapping instead of through HDF5.
+/// The shape, packing and mapping of each entity are looked up once per reader, so that repeated reads of a mapped
+/// entity need no HDF5 calls and no syscalls.
+class EbvRasterReader {
+    public:
+        struct EbvRasterReaderException : public std::runtime_error {
+            using std::runtime_error::runtime_error;
+        };
+
+        using Window = EbvDataPresenceIndex::Window;
+
+        struct GridSize {
+            size_t time_steps;
+            size_t height;
+            size_t width;
+        };
+
+        struct Tile {
+            Window window;
+            bool is_empty;
+            /// row-major values of the window, `no_data` for fill values, and no values at all if `is_empty`
+            std::vector<float> values;
+            float no_data;
+        };
+
+        explicit EbvRasterReader(const std::string &path);
+
+        auto grid_size(const std::vector<std::string> &entity_path) const -> GridSize;
+
+        /// Shape of the chunks of an entity, or of the blocks of the data presence index if it is stored contiguously
+        auto chunk_size(const std::vector<std::string> &entity_path) const -> GridSize;
+
+        /// Reads a window. Mapped float entities without scale and offset are copied row by row from the mapping,
+        /// all others are unpacked value by value.
+        auto read(const std::vector<std::string> &entity_path, size_t time_index, const Window &window) const -> Tile;
+
+        /// Joins the entity path to the path of its dataset
+        static auto entity_dataset_path(const std::vector<std::string> &entity_path) -> std::string;
+
+        /// Windows of at least this many bytes are announced to the kernel before they are copied from the mapping
+        static constexpr size_t will_need_threshold = 1 << 20;
+
+    private:
+        /// What reads need to know about an entity, looked up once
+        struct DatasetInfo {
+            GridSize size;
+            Hdf5TypedReader::Packing packing;
+            /// `nullptr` if the entity is read through HDF5
+            std::shared_ptr<const Hdf5MappedDataset> mapping;
+        };
+
+        auto h5_file() const -> const H5::H5File &;
+
+        auto dataset_info(const std::string &dataset_path) const -> std::shared_ptr<const DatasetInfo>;
+
+        static void check_window(const std::string &dataset_path, const GridSize &size, size_t time_index, const Window &window);
+
+        static void read_mapped(const Hdf5MappedDataset &mapping,
+                                const Hdf5TypedReader::Packing &packing,
+                                size_t time_index,
+                                const Window &window,
+                                float *target,
+                                float no_data);
+
+        std::string path;
+        std::shared_ptr<const EbvDataPresenceIndex> presence_index;
+
+        mutable std::once_flag file_flag;
+        mutable std::unique_ptr<const H5::H5File> file;
+
+        mutable std::mutex datasets_mutex;
+        mutable std::map<std::string, std::shared_ptr<const DatasetInfo>> datasets;
+};
+
+#endif //MAPPING_EBV_EBV_RASTER_READER_H
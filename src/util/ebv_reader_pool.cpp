@@ -0,0 +1,560 @@
+#include "ebv_reader_pool.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <limits>
+#include <poll.h>
+#include <thread>
+#include <sys/prctl.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using Deadline = std::chrono::steady_clock::time_point;
+
+/// Waits until `socket` is ready for `events` or throws once `deadline` has passed
+static void wait_for(int socket, short events, Deadline deadline) {
+    while (true) {
+        const auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count();
+        if (remaining <= 0) {
+            throw EbvReaderPool::EbvReaderPoolException("The reader did not respond in time");
+        }
+
+        pollfd descriptor{socket, events, 0};
+        const int ready = poll(&descriptor, 1, static_cast<int>(std::min<decltype(remaining)>(remaining, std::numeric_limits<int>::max())));
+        if (ready > 0) {
+            return;
+        }
+        if (ready < 0 && errno != EINTR) {
+            throw EbvReaderPool::EbvReaderPoolException(std::string("Unable to wait for a reader socket: ") + std::strerror(errno));
+        }
+    }
+}
+
+/// Writes all of `bytes` or throws, a closed socket must not raise `SIGPIPE` in the service
+static void write_all(int socket, const void *data, size_t bytes, Deadline deadline) {
+    const bool has_deadline = deadline != Deadline::max();
+
+    auto position = static_cast<const uint8_t *>(data);
+    while (bytes > 0) {
+        if (has_deadline) {
+            wait_for(socket, POLLOUT, deadline);
+        }
+
+        const auto written = send(socket, position, bytes, MSG_NOSIGNAL | (has_deadline ? MSG_DONTWAIT : 0));
+        if (written < 0 && (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK)) {
+            continue;
+        }
+        if (written <= 0) {
+            throw EbvReaderPool::EbvReaderPoolException(std::string("Unable to write to a reader socket: ") + std::strerror(errno));
+        }
+        position += written;
+        bytes -= static_cast<size_t>(written);
+    }
+}
+
+/// Reads exactly `bytes` and returns their count, which is less only if the socket was closed
+static auto read_all(int socket, void *data, size_t bytes, Deadline deadline) -> size_t {
+    const bool has_deadline = deadline != Deadline::max();
+
+    auto position = static_cast<uint8_t *>(data);
+    size_t total = 0;
+    while (total < bytes) {
+        if (has_deadline) {
+            wait_for(socket, POLLIN, deadline);
+        }
+
+        const auto received = recv(socket, position + total, bytes - total, has_deadline ? MSG_DONTWAIT : 0);
+        if (received < 0 && (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK)) {
+            continue;
+        }
+        if (received < 0) {
+            throw EbvReaderPool::EbvReaderPoolException(std::string("Unable to read from a reader socket: ") + std::strerror(errno));
+        }
+        if (received == 0) {
+            break;
+        }
+        total += static_cast<size_t>(received);
+    }
+    return total;
+}
+
+/// Passes `descriptor` along with a single byte, the receiver gets its own copy
+static void send_descriptor(int socket, int descriptor) {
+    char byte = 0;
+    iovec data{&byte, 1};
+
+    alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int))] = {};
+    msghdr message{};
+    message.msg_iov = &data;
+    message.msg_iovlen = 1;
+    message.msg_control = control;
+    message.msg_controllen = sizeof(control);
+
+    cmsghdr *header = CMSG_FIRSTHDR(&message);
+    header->cmsg_level = SOL_SOCKET;
+    header->cmsg_type = SCM_RIGHTS;
+    header->cmsg_len = CMSG_LEN(sizeof(int));
+    std::memcpy(CMSG_DATA(header), &descriptor, sizeof(int));
+
+    while (sendmsg(socket, &message, MSG_NOSIGNAL) < 0) {
+        if (errno != EINTR) {
+            throw EbvReaderPool::EbvReaderPoolException(std::string("Unable to pass a reader socket: ") + std::strerror(errno));
+        }
+    }
+}
+
+/// Receives a descriptor sent by `send_descriptor` or throws once `deadline` has passed
+static auto receive_descriptor(int socket, Deadline deadline) -> int {
+    char byte;
+    iovec data{&byte, 1};
+
+    alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int))] = {};
+    msghdr message{};
+    message.msg_iov = &data;
+    message.msg_iovlen = 1;
+    message.msg_control = control;
+    message.msg_controllen = sizeof(control);
+
+    ssize_t received;
+    do {
+        wait_for(socket, POLLIN, deadline);
+        received = recvmsg(socket, &message, MSG_DONTWAIT | MSG_CMSG_CLOEXEC);
+    } while (received < 0 && (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK));
+
+    if (received <= 0) {
+        throw EbvReaderPool::EbvReaderPoolException("Unable to receive a reader socket");
+    }
+
+    const cmsghdr *header = CMSG_FIRSTHDR(&message);
+    if (header == nullptr || header->cmsg_level != SOL_SOCKET || header->cmsg_type != SCM_RIGHTS) {
+        throw EbvReaderPool::EbvReaderPoolException("Missing reader socket in a message of the fork server");
+    }
+
+    int descriptor;
+    std::memcpy(&descriptor, CMSG_DATA(header), sizeof(int));
+    return descriptor;
+}
+
+/// Waits at most until `deadline` for the children in `pids` to end, then kills and reaps the rest
+static void end_children(std::vector<pid_t> pids, Deadline deadline) {
+    while (!pids.empty() && std::chrono::steady_clock::now() < deadline) {
+        pids.erase(std::remove_if(pids.begin(), pids.end(), [](pid_t pid) {
+            return waitpid(pid, nullptr, WNOHANG) != 0;
+        }), pids.end());
+
+        if (!pids.empty()) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+    }
+
+    for (const pid_t pid : pids) {
+        kill(pid, SIGKILL);
+        while (waitpid(pid, nullptr, 0) < 0 && errno == EINTR) {}
+    }
+}
+
+constexpr std::chrono::milliseconds EbvReaderPool::stop_timeout;
+constexpr std::chrono::milliseconds EbvReaderPool::fork_server_timeout;
+
+EbvReaderPool::Worker::~Worker() {
+    if (socket >= 0) {
+        close(socket);
+    }
+}
+
+auto EbvReaderPool::instance() -> EbvReaderPool & {
+    static EbvReaderPool pool;
+    return pool;
+}
+
+EbvReaderPool::~EbvReaderPool() {
+    stop();
+}
+
+void EbvReaderPool::start(size_t processes, Handler handler, std::chrono::milliseconds timeout) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (!workers.empty() || processes == 0) {
+        return;
+    }
+
+    this->timeout = timeout;
+
+    int sockets[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, sockets) != 0) {
+        throw EbvReaderPoolException(std::string("Unable to create a fork server socket: ") + std::strerror(errno));
+    }
+
+    const pid_t parent = getpid();
+    const pid_t pid = fork();
+
+    if (pid < 0) {
+        close(sockets[0]);
+        close(sockets[1]);
+        throw EbvReaderPoolException(std::string("Unable to fork the fork server: ") + std::strerror(errno));
+    }
+
+    if (pid == 0) {
+        close(sockets[0]);
+
+        // end with the service, even if it could not stop the pool
+        prctl(PR_SET_PDEATHSIG, SIGTERM);
+        if (getppid() != parent) {
+            _exit(0);
+        }
+
+        serve_fork_server(sockets[1], handler);
+
+        // skip the exit handlers and static destructors, they belong to the service
+        _exit(0);
+    }
+
+    close(sockets[1]);
+    {
+        std::lock_guard<std::mutex> fork_server_lock(fork_server_mutex);
+        fork_server_pid = pid;
+        fork_server_socket = sockets[0];
+    }
+
+    try {
+        for (size_t i = 0; i < processes; ++i) {
+            workers.push_back(spawn());
+        }
+    } catch (const EbvReaderPoolException &) {
+        workers.clear();
+        stop_fork_server();
+        throw;
+    }
+}
+
+auto EbvReaderPool::spawn() -> std::shared_ptr<Worker> {
+    Json::Value command;
+    command["command"] = "spawn";
+
+    auto worker = std::make_shared<Worker>();
+    const auto response = fork_server_request(command, &worker->socket);
+    worker->pid = static_cast<pid_t>(response["pid"].asInt());
+    worker->is_alive = true;
+    return worker;
+}
+
+void EbvReaderPool::end(Worker &worker) {
+    if (!worker.is_alive) {
+        return;
+    }
+    worker.is_alive = false;
+
+    Json::Value command;
+    command["command"] = "end";
+    command["pid"] = static_cast<Json::Int>(worker.pid);
+
+    try {
+        fork_server_request(command, nullptr);
+    } catch (const EbvReaderPoolException &) {
+        // a fork server that has ended took its workers along
+    }
+}
+
+void EbvReaderPool::respawn(const std::shared_ptr<Worker> &worker) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    const auto slot = std::find(workers.begin(), workers.end(), worker);
+    if (slot == workers.end()) {
+        return;
+    }
+
+    try {
+        *slot = spawn();
+    } catch (const EbvReaderPoolException &) {
+        // the next request for the worker tries again
+    }
+}
+
+void EbvReaderPool::stop() {
+    std::vector<std::shared_ptr<Worker>> stopped_workers;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopped_workers.swap(workers);
+    }
+
+    // without the mutex of the worker, which a call may hold while it waits for the worker, the call then fails
+    for (const auto &worker : stopped_workers) {
+        shutdown(worker->socket, SHUT_RDWR);
+    }
+
+    stop_fork_server();
+}
+
+void EbvReaderPool::stop_fork_server() {
+    pid_t pid;
+    {
+        std::lock_guard<std::mutex> lock(fork_server_mutex);
+        if (fork_server_socket >= 0) {
+            close(fork_server_socket);
+            fork_server_socket = -1;
+        }
+        pid = fork_server_pid;
+        fork_server_pid = -1;
+    }
+
+    if (pid < 0) {
+        return;
+    }
+
+    // the fork server gives its workers `stop_timeout` to end, then kills them
+    end_children({pid}, std::chrono::steady_clock::now() + 2 * stop_timeout);
+}
+
+auto EbvReaderPool::fork_server_request(const Json::Value &command, int *descriptor) -> Json::Value {
+    std::lock_guard<std::mutex> lock(fork_server_mutex);
+
+    if (fork_server_socket < 0) {
+        throw EbvReaderPoolException("The fork server is not running");
+    }
+
+    const auto deadline = std::chrono::steady_clock::now() + fork_server_timeout;
+
+    Message request;
+    request.header = command;
+    Message response;
+    try {
+        send_message(fork_server_socket, request, deadline);
+        if (!receive_message(fork_server_socket, response, deadline)) {
+            throw EbvReaderPoolException("The fork server has ended");
+        }
+        if (descriptor != nullptr && !response.header.isMember("error")) {
+            *descriptor = receive_descriptor(fork_server_socket, deadline);
+        }
+    } catch (const EbvReaderPoolException &) {
+        // the stream may be out of step, `stop` still reaps the fork server
+        close(fork_server_socket);
+        fork_server_socket = -1;
+        throw;
+    }
+
+    if (response.header.isMember("error")) {
+        throw EbvReaderPoolException(response.header["error"].asString());
+    }
+
+    return response.header;
+}
+
+void EbvReaderPool::serve_fork_server(int socket, const Handler &handler) {
+    const pid_t parent = getpid();
+    std::vector<pid_t> workers;
+
+    try {
+        Message request;
+        while (receive_message(socket, request)) {
+            const auto command = request.header["command"].asString();
+            Message response;
+
+            if (command == "spawn") {
+                int sockets[2];
+                if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, sockets) != 0) {
+                    response.header["error"] = std::string("Unable to create a reader socket: ") + std::strerror(errno);
+                    send_message(socket, response);
+                    continue;
+                }
+
+                const pid_t pid = fork();
+
+                if (pid == 0) {
+                    close(socket);
+                    close(sockets[0]);
+
+                    prctl(PR_SET_PDEATHSIG, SIGTERM);
+                    if (getppid() != parent) {
+                        _exit(0);
+                    }
+
+                    int status = 0;
+                    try {
+                        serve(sockets[1], handler);
+                    } catch (...) {
+                        status = 1;
+                    }
+                    _exit(status);
+                }
+
+                close(sockets[1]);
+
+                if (pid < 0) {
+                    response.header["error"] = std::string("Unable to fork a reader: ") + std::strerror(errno);
+                    close(sockets[0]);
+                    send_message(socket, response);
+                    continue;
+                }
+
+                workers.push_back(pid);
+                response.header["pid"] = static_cast<Json::Int>(pid);
+                try {
+                    send_message(socket, response);
+                    send_descriptor(socket, sockets[0]);
+                } catch (...) {
+                    close(sockets[0]);
+                    throw;
+                }
+                close(sockets[0]);
+            } else if (command == "end") {
+                const auto pid = static_cast<pid_t>(request.header["pid"].asInt());
+                const auto worker = std::find(workers.begin(), workers.end(), pid);
+                if (worker != workers.end()) {
+                    // the fork server is the parent, so the pid was not reused
+                    kill(pid, SIGKILL);
+                    while (waitpid(pid, nullptr, 0) < 0 && errno == EINTR) {}
+                    workers.erase(worker);
+                }
+                send_message(socket, response);
+            } else {
+                response.header["error"] = "Unknown fork server command: " + command;
+                send_message(socket, response);
+            }
+        }
+    } catch (...) {
+        // the service has gone, end the workers as after a regular stop
+    }
+
+    close(socket);
+    end_children(workers, std::chrono::steady_clock::now() + stop_timeout);
+}
+
+auto EbvReaderPool::is_running() const -> bool {
+    std::lock_guard<std::mutex> lock(mutex);
+    return !workers.empty();
+}
+
+auto EbvReaderPool::size() const -> size_t {
+    std::lock_guard<std::mutex> lock(mutex);
+    return workers.size();
+}
+
+auto EbvReaderPool::worker_index(const std::string &file) const -> size_t {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (workers.empty()) {
+        throw WorkerUnavailableException("The reader pool is not running");
+    }
+    return std::hash<std::string>()(file) % workers.size();
+}
+
+auto EbvReaderPool::worker_pid(size_t index) const -> pid_t {
+    std::lock_guard<std::mutex> lock(mutex);
+    return workers.at(index)->pid;
+}
+
+auto EbvReaderPool::call(const std::string &file, const Message &request) -> Message {
+    Message response;
+    exchange(file, request, true, response);
+    return response;
+}
+
+auto EbvReaderPool::try_call(const std::string &file, const Message &request, Message &response) -> bool {
+    return exchange(file, request, false, response);
+}
+
+auto EbvReaderPool::exchange(const std::string &file, const Message &request, bool may_wait, Message &response) -> bool {
+    std::shared_ptr<Worker> worker;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (workers.empty()) {
+            throw WorkerUnavailableException("The reader pool is not running");
+        }
+        worker = workers[std::hash<std::string>()(file) % workers.size()];
+    }
+
+    std::string failure;
+    {
+        std::unique_lock<std::mutex> lock(worker->mutex, std::defer_lock);
+        if (may_wait) {
+            lock.lock();
+        } else if (!lock.try_lock()) {
+            return false;
+        }
+
+        if (!worker->is_alive) {
+            failure = "it has ended";
+        } else {
+            const auto deadline = timeout.count() > 0 ? std::chrono::steady_clock::now() + timeout : Deadline::max();
+            try {
+                send_message(worker->socket, request, deadline);
+                if (!receive_message(worker->socket, response, deadline)) {
+                    throw EbvReaderPoolException("the socket was closed");
+                }
+            } catch (const EbvReaderPoolException &e) {
+                failure = e.what();
+                end(*worker);
+            }
+        }
+    }
+
+    if (!failure.empty()) {
+        respawn(worker);
+        throw WorkerUnavailableException("Reader " + std::to_string(worker->pid) + " is not available (" + failure + ")");
+    }
+
+    if (response.header.isMember("error")) {
+        throw EbvReaderPoolException(response.header["error"].asString());
+    }
+
+    return true;
+}
+
+void EbvReaderPool::serve(int socket, const Handler &handler) {
+    Message request;
+    while (receive_message(socket, request)) {
+        Message response;
+        try {
+            response = handler(request);
+        } catch (const std::exception &e) {
+            response = Message{};
+            response.header["error"] = e.what();
+        } catch (...) {
+            response = Message{};
+            response.header["error"] = "Unknown error in reader " + std::to_string(getpid());
+        }
+
+        send_message(socket, response);
+    }
+}
+
+/// Messages are framed as header size (32 bit), payload size (64 bit), JSON header and payload
+void EbvReaderPool::send_message(int socket, const Message &message, Deadline deadline) {
+    const auto header = Json::FastWriter().write(message.header);
+    const auto header_size = static_cast<uint32_t>(header.size());
+    const auto payload_size = static_cast<uint64_t>(message.payload.size());
+
+    write_all(socket, &header_size, sizeof(header_size), deadline);
+    write_all(socket, &payload_size, sizeof(payload_size), deadline);
+    write_all(socket, header.data(), header.size(), deadline);
+    write_all(socket, message.payload.data(), message.payload.size(), deadline);
+}
+
+auto EbvReaderPool::receive_message(int socket, Message &message, Deadline deadline) -> bool {
+    uint32_t header_size;
+    const auto received = read_all(socket, &header_size, sizeof(header_size), deadline);
+    if (received == 0) {
+        return false;
+    }
+
+    uint64_t payload_size;
+    if (received != sizeof(header_size) || read_all(socket, &payload_size, sizeof(payload_size), deadline) != sizeof(payload_size)) {
+        throw EbvReaderPoolException("Truncated message from a reader socket");
+    }
+
+    std::string header(header_size, '\0');
+    message.payload.resize(payload_size);
+    if (read_all(socket, &header[0], header.size(), deadline) != header.size()
+        || read_all(socket, message.payload.data(), message.payload.size(), deadline) != message.payload.size()) {
+        throw EbvReaderPoolException("Truncated message from a reader socket");
+    }
+
+    message.header = Json::Value();
+    if (!Json::Reader().parse(header, message.header)) {
+        throw EbvReaderPoolException("Invalid message header from a reader socket");
+    }
+
+    return true;
+}
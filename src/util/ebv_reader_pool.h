@@ -0,0 +1,143 @@
+#ifndef MAPPING_EBV_EBV_READER_POOL_H
+#define MAPPING_EBV_EBV_READER_POOL_H
+
+#include <json/json.h>
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <sys/types.h>
+#include <vector>
+
+/// Pool of forked reader processes that serve HDF5 reads for the service.
+///
+/// HDF5 serializes all calls of a process behind one global lock, so reads only scale with processes, not threads.
+/// Each worker owns its own HDF5 library state and is connected to the service by a Unix socket.
+/// All requests for one file go to the same worker, so that its open handles and chunk caches stay warm.
+/// A worker that dies or does not respond in time is killed and forked again, the failed request is not retried.
+///
+/// Workers are forked by a single-threaded fork server, which is itself forked once by `start`, since a fork of the
+/// multi-threaded service could copy locks that other threads hold and leave the new worker blocked forever.
+/// The fork server is the parent of all workers, it kills and reaps them on behalf of the service.
+class EbvReaderPool {
+    public:
+        struct EbvReaderPoolException : public std::runtime_error {
+            using std::runtime_error::runtime_error;
+        };
+
+        /// The worker of a request died, timed out or its socket failed, the request may be served in-process instead
+        struct WorkerUnavailableException : public EbvReaderPoolException {
+            using EbvReaderPoolException::EbvReaderPoolException;
+        };
+
+        /// A request or response, binary data such as raster values is sent as `payload`
+        struct Message {
+            Json::Value header;
+            std::vector<uint8_t> payload;
+        };
+
+        /// Serves one request in a worker, an exception is sent back as an error and rethrown by `call`
+        using Handler = std::function<Message(const Message &request)>;
+
+        static auto instance() -> EbvReaderPool &;
+
+        EbvReaderPool() = default;
+
+        ~EbvReaderPool();
+
+        EbvReaderPool(const EbvReaderPool &) = delete;
+
+        EbvReaderPool &operator=(const EbvReaderPool &) = delete;
+
+        /// Forks the fork server and `processes` workers that serve requests with `handler`, does nothing if the pool is
+        /// running. Call it before other threads use HDF5, since a fork only copies the calling thread and the locks of
+        /// the others.
+        /// Workers that need longer than `timeout` for a request are replaced, `0` waits for them indefinitely.
+        void start(size_t processes, Handler handler, std::chrono::milliseconds timeout = std::chrono::seconds(60));
+
+        /// Closes the sockets, which ends the workers, and waits at most `stop_timeout` for them before they are killed.
+        /// Pending calls fail.
+        void stop();
+
+        auto is_running() const -> bool;
+
+        auto size() const -> size_t;
+
+        /// Sends `request` to the worker that serves `file` and waits for its response
+        auto call(const std::string &file, const Message &request) -> Message;
+
+        /// Like `call`, but returns `false` at once if the worker is busy, so that background reads do not queue up
+        /// in front of the requests of users
+        auto try_call(const std::string &file, const Message &request, Message &response) -> bool;
+
+        /// Index of the worker that serves `file`
+        auto worker_index(const std::string &file) const -> size_t;
+
+        /// Process id of a worker, e.g. for monitoring
+        auto worker_pid(size_t index) const -> pid_t;
+
+        /// Time that `stop` gives the workers and the fork server to end
+        static constexpr std::chrono::milliseconds stop_timeout{2000};
+
+        /// Time that the fork server may take for a request
+        static constexpr std::chrono::milliseconds fork_server_timeout{10000};
+
+    private:
+        struct Worker {
+            pid_t pid = -1;
+            /// open as long as the worker is referenced, so that `stop` may shut it down while a call uses it
+            int socket = -1;
+            bool is_alive = false;
+            /// one request at a time per socket
+            std::mutex mutex;
+
+            ~Worker();
+        };
+
+        using Deadline = std::chrono::steady_clock::time_point;
+
+        /// Lets the fork server fork a worker
+        auto spawn() -> std::shared_ptr<Worker>;
+
+        /// Lets the fork server kill and reap a failed worker, call it with the mutex of the worker held
+        void end(Worker &worker);
+
+        /// Replaces an ended worker by a new one, unless the pool was stopped or the worker was replaced already
+        void respawn(const std::shared_ptr<Worker> &worker);
+
+        /// Sends `command` to the fork server and returns its response and the descriptor it sent along, if any
+        auto fork_server_request(const Json::Value &command, int *descriptor) -> Json::Value;
+
+        /// Closes the socket of the fork server, which ends it and its workers, and kills it if it takes too long
+        void stop_fork_server();
+
+        /// Request loop of the fork server, forks workers until the service closes the socket, then ends them
+        static void serve_fork_server(int socket, const Handler &handler);
+
+        /// Exchanges a request with the worker of `file`, returns `false` if it is busy and `may_wait` is not set
+        auto exchange(const std::string &file, const Message &request, bool may_wait, Message &response) -> bool;
+
+        /// Request loop of a worker, returns when the service closes the socket
+        static void serve(int socket, const Handler &handler);
+
+        /// Writes a message, throws once `deadline` has passed
+        static void send_message(int socket, const Message &message, Deadline deadline = Deadline::max());
+
+        /// Returns `false` if the socket was closed before a message started, throws once `deadline` has passed
+        static auto receive_message(int socket, Message &message, Deadline deadline = Deadline::max()) -> bool;
+
+        mutable std::mutex mutex;
+        std::vector<std::shared_ptr<Worker>> workers;
+        std::chrono::milliseconds timeout{0};
+
+        /// one request at a time, `-1` if it is not running
+        std::mutex fork_server_mutex;
+        pid_t fork_server_pid = -1;
+        int fork_server_socket = -1;
+};
+
+#endif //MAPPING_EBV_EBV_READER_POOL_H
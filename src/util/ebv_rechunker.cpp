@@ -0,0 +1,872 @@
+#include "ebv_rechunker.h"
+#include "hdf5_typed_reader.h"
+
+#include <H5DSpublic.h>
+#include <zlib.h>
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <fcntl.h>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+
+constexpr H5Z_filter_t EbvRechunker::zstd_filter;
+constexpr H5Z_filter_t EbvRechunker::lz4_filter;
+
+namespace {
+    /// Iterates over the chunk grid of the target and reads each chunk from the source in stored byte order
+    class ChunkReader {
+        public:
+            ChunkReader(hid_t source, hid_t target) : source(source), file_type(H5Dget_type(source)) {
+                const hid_t space = H5Dget_space(source);
+                H5Sget_simple_extent_dims(space, dimensions, nullptr);
+                H5Sclose(space);
+
+                const hid_t creation_properties = H5Dget_create_plist(target);
+                H5Pget_chunk(creation_properties, 3, chunk);
+                fill_value.resize(H5Tget_size(file_type));
+                H5Pget_fill_value(creation_properties, file_type, fill_value.data());
+                H5Pclose(creation_properties);
+            }
+
+            ~ChunkReader() {
+                H5Tclose(file_type);
+            }
+
+            ChunkReader(const ChunkReader &) = delete;
+
+            ChunkReader &operator=(const ChunkReader &) = delete;
+
+            /// Moves to the next chunk in (time, lat, lon) order, returns `false` after the last one
+            auto next() -> bool {
+                if (!is_started) {
+                    is_started = true;
+                    return dimensions[0] > 0 && dimensions[1] > 0 && dimensions[2] > 0;
+                }
+                for (int dimension = 2; dimension >= 0; --dimension) {
+                    position[dimension] += chunk[dimension];
+                    if (position[dimension] < dimensions[dimension]) {
+                        return true;
+                    }
+                    position[dimension] = 0;
+                }
+                return false;
+            }
+
+            /// Reads the current chunk into `buffer` and pads edge chunks with the fill value.
+            /// Returns `false` if the chunk contains fill values only.
+            auto read(std::vector<uint8_t> &buffer) const -> bool {
+                const size_t element_size = fill_value.size();
+                buffer.resize(chunk_bytes());
+
+                const hsize_t count[3] = {valid_count(0), valid_count(1), valid_count(2)};
+                if (count[0] != chunk[0] || count[1] != chunk[1] || count[2] != chunk[2]) {
+                    for (size_t i = 0; i < buffer.size(); i += element_size) {
+                        std::memcpy(&buffer[i], fill_value.data(), element_size);
+                    }
+                }
+
+                const hsize_t memory_offset[3] = {0, 0, 0};
+                const hid_t memory_space = H5Screate_simple(3, chunk, nullptr);
+                H5Sselect_hyperslab(memory_space, H5S_SELECT_SET, memory_offset, nullptr, count, nullptr);
+                const hid_t file_space = H5Dget_space(source);
+                H5Sselect_hyperslab(file_space, H5S_SELECT_SET, position, nullptr, count, nullptr);
+
+                const herr_t status = H5Dread(source, file_type, memory_space, file_space, H5P_DEFAULT, buffer.data());
+
+                H5Sclose(file_space);
+                H5Sclose(memory_space);
+
+                if (status < 0) {
+                    throw EbvRechunker::EbvRechunkerException("Unable to read the chunk at time " + std::to_string(position[0])
+                                                              + ", lat " + std::to_string(position[1])
+                                                              + ", lon " + std::to_string(position[2]));
+                }
+
+                for (size_t i = 0; i < buffer.size(); i += element_size) {
+                    if (std::memcmp(&buffer[i], fill_value.data(), element_size) != 0) {
+                        return true;
+                    }
+                }
+                return false;
+            }
+
+            /// Writes a chunk that was read by `read` through the filter pipeline
+            void write(hid_t target, const std::vector<uint8_t> &buffer) const {
+                const hsize_t count[3] = {valid_count(0), valid_count(1), valid_count(2)};
+                const hsize_t memory_offset[3] = {0, 0, 0};
+                const hid_t memory_space = H5Screate_simple(3, chunk, nullptr);
+                H5Sselect_hyperslab(memory_space, H5S_SELECT_SET, memory_offset, nullptr, count, nullptr);
+                const hid_t file_space = H5Dget_space(target);
+                H5Sselect_hyperslab(file_space, H5S_SELECT_SET, position, nullptr, count, nullptr);
+
+                const herr_t status = H5Dwrite(target, file_type, memory_space, file_space, H5P_DEFAULT, buffer.data());
+
+                H5Sclose(file_space);
+                H5Sclose(memory_space);
+
+                if (status < 0) {
+                    throw EbvRechunker::EbvRechunkerException("Unable to write a chunk");
+                }
+            }
+
+            auto offset() const -> const hsize_t * {
+                return position;
+            }
+
+            auto chunk_bytes() const -> size_t {
+                return chunk[0] * chunk[1] * chunk[2] * fill_value.size();
+            }
+
+            auto element_size() const -> size_t {
+                return fill_value.size();
+            }
+
+        private:
+            auto valid_count(int dimension) const -> hsize_t {
+                return std::min(chunk[dimension], dimensions[dimension] - position[dimension]);
+            }
+
+            hid_t source;
+            hid_t file_type;
+            hsize_t dimensions[3] = {0, 0, 0};
+            hsize_t chunk[3] = {1, 1, 1};
+            hsize_t position[3] = {0, 0, 0};
+            bool is_started = false;
+            std::vector<uint8_t> fill_value;
+    };
+}
+
+/// Whether `dataset` is an entity, i.e. a numeric dataset of rank three
+static auto is_entity(hid_t dataset) -> bool {
+    const hid_t space = H5Dget_space(dataset);
+    const hid_t type = H5Dget_type(dataset);
+    const auto type_class = H5Tget_class(type);
+
+    const bool result = H5Sget_simple_extent_ndims(space) == 3 && (type_class == H5T_INTEGER || type_class == H5T_FLOAT);
+
+    H5Tclose(type);
+    H5Sclose(space);
+    return result;
+}
+
+/// Extent of a target chunk, `0` stands for the full extent of the dimension
+static auto chunk_extent(hsize_t chunk, hsize_t dimension) -> hsize_t {
+    return std::max<hsize_t>(1, chunk == 0 ? dimension : std::min(chunk, dimension));
+}
+
+/// Bytes of the source chunks that one row of target chunks overlaps, since target chunks are written row by row.
+/// With a smaller chunk cache, source chunks are decompressed again for every target chunk of the row.
+static auto source_chunk_cache_bytes(hid_t dataset, const EbvRechunker::Layout &layout) -> size_t {
+    const hid_t space = H5Dget_space(dataset);
+    hsize_t dimensions[3];
+    H5Sget_simple_extent_dims(space, dimensions, nullptr);
+    H5Sclose(space);
+
+    const hid_t creation_properties = H5Dget_create_plist(dataset);
+    hsize_t source_chunk[3];
+    const bool is_chunked = H5Pget_layout(creation_properties) == H5D_CHUNKED
+                            && H5Pget_chunk(creation_properties, 3, source_chunk) == 3;
+    H5Pclose(creation_properties);
+
+    if (!is_chunked) {
+        return 0;
+    }
+
+    // chunks of the source that `extent` values starting at any offset overlap, at most all of the dimension
+    const auto overlapped = [](hsize_t extent, hsize_t source_extent, hsize_t dimension) -> hsize_t {
+        const hsize_t all = (dimension + source_extent - 1) / source_extent;
+        return std::min(all, (extent + source_extent - 1) / source_extent + (extent % source_extent != 0 ? 1 : 0));
+    };
+
+    const hsize_t chunks = overlapped(chunk_extent(layout.chunk_time, dimensions[0]), source_chunk[0], dimensions[0])
+                           * overlapped(chunk_extent(layout.chunk_height, dimensions[1]), source_chunk[1], dimensions[1])
+                           * ((dimensions[2] + source_chunk[2] - 1) / source_chunk[2]);
+
+    const hid_t type = H5Dget_type(dataset);
+    const size_t chunk_bytes = source_chunk[0] * source_chunk[1] * source_chunk[2] * H5Tget_size(type);
+    H5Tclose(type);
+
+    return chunks * chunk_bytes;
+}
+
+/// Iteration order that keeps the creation order of NetCDF-4 files, which track and index it
+static auto iteration_index(unsigned int creation_order_flags) -> H5_index_t {
+    return (creation_order_flags & H5P_CRT_ORDER_INDEXED) != 0 ? H5_INDEX_CRT_ORDER : H5_INDEX_NAME;
+}
+
+static auto link_names(hid_t group, H5_index_t index) -> std::vector<std::string> {
+    std::vector<std::string> names;
+
+    const auto collect = [](hid_t, const char *name, const H5L_info_t *, void *data) -> herr_t {
+        static_cast<std::vector<std::string> *>(data)->emplace_back(name);
+        return 0;
+    };
+
+    hsize_t position = 0;
+    if (H5Literate(group, index, H5_ITER_INC, &position, collect, &names) < 0) {
+        throw EbvRechunker::EbvRechunkerException("Unable to list the members of a group");
+    }
+
+    return names;
+}
+
+/// Applies the shuffle and deflate filters exactly like HDF5, so that the result can be written with `H5Dwrite_chunk`
+static auto filter_chunk(std::vector<uint8_t> chunk, size_t element_size, const EbvRechunker::Layout &layout) -> std::vector<uint8_t> {
+    if (layout.shuffle && element_size > 1) {
+        const size_t number_of_elements = chunk.size() / element_size;
+        std::vector<uint8_t> shuffled(chunk.size());
+        for (size_t byte = 0; byte < element_size; ++byte) {
+            for (size_t i = 0; i < number_of_elements; ++i) {
+                shuffled[byte * number_of_elements + i] = chunk[i * element_size + byte];
+            }
+        }
+        chunk.swap(shuffled);
+    }
+
+    if (layout.codec != EbvRechunker::Codec::Deflate) {
+        return chunk;
+    }
+
+    uLongf compressed_size = compressBound(chunk.size());
+    std::vector<uint8_t> compressed(compressed_size);
+    if (compress2(compressed.data(), &compressed_size, chunk.data(), chunk.size(), layout.level) != Z_OK) {
+        throw EbvRechunker::EbvRechunkerException("Unable to deflate a chunk");
+    }
+    compressed.resize(compressed_size);
+
+    return compressed;
+}
+
+auto EbvRechunker::Layout::to_string() const -> std::string {
+    std::string layout = std::to_string(chunk_time) + "x" + std::to_string(chunk_height) + "x" + std::to_string(chunk_width);
+
+    switch (codec) {
+        case Codec::None:
+            layout += "/none";
+            break;
+        case Codec::Deflate:
+            layout += "/deflate:" + std::to_string(level);
+            break;
+        case Codec::Zstd:
+            layout += "/zstd:" + std::to_string(level);
+            break;
+        case Codec::Lz4:
+            layout += "/lz4";
+            break;
+    }
+
+    if (shuffle) {
+        layout += "/shuffle";
+    }
+
+    return layout;
+}
+
+auto EbvRechunker::Layout::parse(const std::string &layout) -> Layout {
+    Layout result;
+
+    std::istringstream parts(layout);
+    std::string part;
+
+    std::getline(parts, part, '/');
+    unsigned long long chunk_time, chunk_height, chunk_width;
+    char rest;
+    if (std::sscanf(part.c_str(), "%llux%llux%llu%c", &chunk_time, &chunk_height, &chunk_width, &rest) != 3) {
+        throw EbvRechunkerException("Invalid chunk shape `" + part + "`, expected <time>x<lat>x<lon>");
+    }
+    result.chunk_time = chunk_time;
+    result.chunk_height = chunk_height;
+    result.chunk_width = chunk_width;
+
+    while (std::getline(parts, part, '/')) {
+        const auto colon = part.find(':');
+        const auto name = part.substr(0, colon);
+
+        if (name == "shuffle") {
+            result.shuffle = true;
+            continue;
+        } else if (name == "none") {
+            result.codec = Codec::None;
+        } else if (name == "deflate") {
+            result.codec = Codec::Deflate;
+        } else if (name == "zstd") {
+            result.codec = Codec::Zstd;
+            result.level = 3;
+        } else if (name == "lz4") {
+            result.codec = Codec::Lz4;
+        } else {
+            throw EbvRechunkerException("Unknown codec `" + name + "`");
+        }
+
+        if (colon != std::string::npos) {
+            try {
+                result.level = std::stoi(part.substr(colon + 1));
+            } catch (const std::logic_error &e) {
+                throw EbvRechunkerException("Invalid compression level in `" + part + "`");
+            }
+        }
+    }
+
+    if ((result.codec == Codec::Deflate && (result.level < 0 || result.level > 9))
+        || (result.codec == Codec::Zstd && (result.level < 1 || result.level > 22))) {
+        throw EbvRechunkerException("Compression level out of range in `" + layout + "`");
+    }
+
+    return result;
+}
+
+auto EbvRechunker::is_available(Codec codec) -> bool {
+    switch (codec) {
+        case Codec::None:
+            return true;
+        case Codec::Deflate:
+            return H5Zfilter_avail(H5Z_FILTER_DEFLATE) > 0;
+        case Codec::Zstd:
+            return H5Zfilter_avail(zstd_filter) > 0;
+        case Codec::Lz4:
+            return H5Zfilter_avail(lz4_filter) > 0;
+    }
+    return false;
+}
+
+auto EbvRechunker::rechunk(const std::string &source, const std::string &target, const Options &options) -> Summary {
+    if (!is_available(options.layout.codec)) {
+        throw EbvRechunkerException("The codec of `" + options.layout.to_string() + "` is not available, check HDF5_PLUGIN_PATH");
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+
+    const hid_t source_file = H5Fopen(source.c_str(), H5F_ACC_RDONLY, H5P_DEFAULT);
+    if (source_file < 0) {
+        throw EbvRechunkerException("Unable to open `" + source + "`");
+    }
+
+    // the file creation properties also hold the link creation order of the root group
+    const hid_t file_creation_properties = H5Fget_create_plist(source_file);
+    const hid_t target_file = H5Fcreate(target.c_str(), H5F_ACC_TRUNC, file_creation_properties, H5P_DEFAULT);
+    H5Pclose(file_creation_properties);
+    if (target_file < 0) {
+        H5Fclose(source_file);
+        throw EbvRechunkerException("Unable to create `" + target + "`");
+    }
+
+    Summary summary{};
+
+    try {
+        const hid_t source_root = H5Gopen2(source_file, "/", H5P_DEFAULT);
+        const hid_t target_root = H5Gopen2(target_file, "/", H5P_DEFAULT);
+        const hid_t group_creation_properties = H5Gget_create_plist(source_root);
+        unsigned int creation_order_flags = 0;
+        H5Pget_attr_creation_order(group_creation_properties, &creation_order_flags);
+        H5Pclose(group_creation_properties);
+
+        copy_attributes(source_root, target_root, iteration_index(creation_order_flags));
+
+        std::vector<std::string> datasets_with_dimensions;
+        copy_group(source_root, target_root, "", options, summary, datasets_with_dimensions);
+
+        H5Gclose(target_root);
+        H5Gclose(source_root);
+
+        attach_dimension_scales(source_file, target_file, datasets_with_dimensions);
+    } catch (...) {
+        H5Fclose(target_file);
+        H5Fclose(source_file);
+        throw;
+    }
+
+    H5Fclose(target_file);
+    H5Fclose(source_file);
+
+    summary.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    return summary;
+}
+
+void EbvRechunker::copy_group(hid_t source, hid_t target, const std::string &path, const Options &options,
+                              Summary &summary, std::vector<std::string> &datasets_with_dimensions) {
+    const hid_t group_creation_properties = H5Gget_create_plist(source);
+    unsigned int link_order_flags = 0;
+    H5Pget_link_creation_order(group_creation_properties, &link_order_flags);
+    H5Pclose(group_creation_properties);
+
+    for (const auto &name : link_names(source, iteration_index(link_order_flags))) {
+        const auto object_path = path + "/" + name;
+
+        H5O_info_t info;
+        if (H5Oget_info_by_name(source, name.c_str(), &info, H5P_DEFAULT) < 0) {
+            throw EbvRechunkerException("Unable to inspect `" + object_path + "`");
+        }
+
+        if (info.type == H5O_TYPE_GROUP) {
+            const hid_t source_group = H5Gopen2(source, name.c_str(), H5P_DEFAULT);
+            const hid_t creation_properties = H5Gget_create_plist(source_group);
+            const hid_t target_group = H5Gcreate2(target, name.c_str(), H5P_DEFAULT, creation_properties, H5P_DEFAULT);
+
+            unsigned int attribute_order_flags = 0;
+            H5Pget_attr_creation_order(creation_properties, &attribute_order_flags);
+            H5Pclose(creation_properties);
+
+            if (target_group < 0) {
+                H5Gclose(source_group);
+                throw EbvRechunkerException("Unable to create `" + object_path + "`");
+            }
+
+            copy_attributes(source_group, target_group, iteration_index(attribute_order_flags));
+            copy_group(source_group, target_group, object_path, options, summary, datasets_with_dimensions);
+
+            H5Gclose(target_group);
+            H5Gclose(source_group);
+        } else if (info.type == H5O_TYPE_DATASET) {
+            hid_t source_dataset = H5Dopen2(source, name.c_str(), H5P_DEFAULT);
+            if (source_dataset < 0) {
+                throw EbvRechunkerException("Unable to open `" + object_path + "`");
+            }
+
+            hid_t target_dataset;
+            if (is_entity(source_dataset)) {
+                // the chunk cache gets half the budget, but at least the source chunks of one row of target chunks
+                const auto row_bytes = source_chunk_cache_bytes(source_dataset, options.layout);
+                if (row_bytes > options.memory_limit / 2) {
+                    summary.warnings.push_back("The source chunks of one row of chunks of `" + object_path + "` need "
+                                               + std::to_string(row_bytes >> 20u) + " MiB of chunk cache, which exceeds the memory limit");
+                }
+
+                const hid_t access_properties = H5Pcreate(H5P_DATASET_ACCESS);
+                H5Pset_chunk_cache(access_properties, 12421, std::max<size_t>(options.memory_limit / 2, row_bytes), 1.);
+                H5Dclose(source_dataset);
+                source_dataset = H5Dopen2(source, name.c_str(), access_properties);
+                H5Pclose(access_properties);
+
+                target_dataset = copy_entity(source_dataset, target, name, options, summary);
+            } else {
+                // attributes are copied separately, since the dimension scale references point into the source file
+                const hid_t copy_properties = H5Pcreate(H5P_OBJECT_COPY);
+                H5Pset_copy_object(copy_properties, H5O_COPY_WITHOUT_ATTR_FLAG);
+                const herr_t status = H5Ocopy(source, name.c_str(), target, name.c_str(), copy_properties, H5P_DEFAULT);
+                H5Pclose(copy_properties);
+
+                if (status < 0) {
+                    H5Dclose(source_dataset);
+                    throw EbvRechunkerException("Unable to copy `" + object_path + "`");
+                }
+                target_dataset = H5Dopen2(target, name.c_str(), H5P_DEFAULT);
+            }
+
+            const hid_t creation_properties = H5Dget_create_plist(source_dataset);
+            unsigned int attribute_order_flags = 0;
+            H5Pget_attr_creation_order(creation_properties, &attribute_order_flags);
+            H5Pclose(creation_properties);
+
+            copy_attributes(source_dataset, target_dataset, iteration_index(attribute_order_flags));
+
+            if (H5Aexists(source_dataset, "DIMENSION_LIST") > 0) {
+                datasets_with_dimensions.push_back(object_path);
+            }
+
+            H5Dclose(target_dataset);
+            H5Dclose(source_dataset);
+        } else if (H5Ocopy(source, name.c_str(), target, name.c_str(), H5P_DEFAULT, H5P_DEFAULT) < 0) { // named datatypes
+            throw EbvRechunkerException("Unable to copy `" + object_path + "`");
+        }
+    }
+}
+
+void EbvRechunker::copy_attributes(hid_t source, hid_t target, H5_index_t index) {
+    const auto copy = [](hid_t location, const char *name, const H5A_info_t *, void *data) -> herr_t {
+        // maintained by the dimension scale API, see `attach_dimension_scales`
+        if (std::strcmp(name, "DIMENSION_LIST") == 0 || std::strcmp(name, "REFERENCE_LIST") == 0) {
+            return 0;
+        }
+
+        const hid_t target = *static_cast<const hid_t *>(data);
+
+        const hid_t attribute = H5Aopen(location, name, H5P_DEFAULT);
+        const hid_t file_type = H5Aget_type(attribute);
+        const hid_t space = H5Aget_space(attribute);
+        const hid_t memory_type = H5Tget_native_type(file_type, H5T_DIR_ASCEND);
+
+        herr_t status = -1;
+        if (memory_type >= 0) {
+            const auto number_of_values = std::max<hssize_t>(H5Sget_simple_extent_npoints(space), 1);
+            std::vector<uint8_t> buffer(static_cast<size_t>(number_of_values) * H5Tget_size(memory_type));
+
+            if (H5Aread(attribute, memory_type, buffer.data()) >= 0) {
+                const hid_t target_attribute = H5Acreate2(target, name, file_type, space, H5P_DEFAULT, H5P_DEFAULT);
+                status = target_attribute < 0 ? -1 : H5Awrite(target_attribute, memory_type, buffer.data());
+                if (target_attribute >= 0) {
+                    H5Aclose(target_attribute);
+                }
+
+                if (H5Tdetect_class(memory_type, H5T_VLEN) > 0 || H5Tis_variable_str(memory_type) > 0) {
+                    H5Dvlen_reclaim(memory_type, space, H5P_DEFAULT, buffer.data());
+                }
+            }
+
+            H5Tclose(memory_type);
+        }
+
+        H5Sclose(space);
+        H5Tclose(file_type);
+        H5Aclose(attribute);
+
+        return status;
+    };
+
+    hsize_t position = 0;
+    if (H5Aiterate2(source, index, H5_ITER_INC, &position, copy, &target) < 0) {
+        throw EbvRechunkerException("Unable to copy attributes");
+    }
+}
+
+auto EbvRechunker::copy_entity(hid_t source, hid_t target_group, const std::string &name, const Options &options,
+                               Summary &summary) -> hid_t {
+    const auto &layout = options.layout;
+
+    const hid_t space = H5Dget_space(source);
+    hsize_t dimensions[3];
+    H5Sget_simple_extent_dims(space, dimensions, nullptr);
+
+    const hsize_t chunk[3] = {
+            chunk_extent(layout.chunk_time, dimensions[0]),
+            chunk_extent(layout.chunk_height, dimensions[1]),
+            chunk_extent(layout.chunk_width, dimensions[2]),
+    };
+
+    // keeps the fill value and attribute creation order of the source
+    const hid_t creation_properties = H5Dget_create_plist(source);
+    if (H5Pget_nfilters(creation_properties) > 0) {
+        H5Premove_filter(creation_properties, H5Z_FILTER_ALL);
+    }
+    H5Pset_chunk(creation_properties, 3, chunk);
+    H5Pset_alloc_time(creation_properties, H5D_ALLOC_TIME_INCR);
+
+    if (layout.shuffle) {
+        H5Pset_shuffle(creation_properties);
+    }
+    const auto level = static_cast<unsigned int>(layout.level);
+    switch (layout.codec) {
+        case Codec::None:
+            break;
+        case Codec::Deflate:
+            H5Pset_deflate(creation_properties, level);
+            break;
+        case Codec::Zstd:
+            H5Pset_filter(creation_properties, zstd_filter, H5Z_FLAG_MANDATORY, 1, &level);
+            break;
+        case Codec::Lz4:
+            H5Pset_filter(creation_properties, lz4_filter, H5Z_FLAG_MANDATORY, 0, nullptr);
+            break;
+    }
+
+    const hid_t file_type = H5Dget_type(source);
+    const hid_t target = H5Dcreate2(target_group, name.c_str(), file_type, space, H5P_DEFAULT, creation_properties, H5P_DEFAULT);
+    H5Tclose(file_type);
+    H5Pclose(creation_properties);
+    H5Sclose(space);
+
+    if (target < 0) {
+        throw EbvRechunkerException("Unable to create entity `" + name + "` with layout " + layout.to_string());
+    }
+
+    try {
+        if (layout.codec == Codec::None || layout.codec == Codec::Deflate) {
+            copy_chunks_parallel(source, target, options, summary);
+        } else {
+            copy_chunks_serial(source, target, summary);
+        }
+    } catch (...) {
+        H5Dclose(target);
+        throw;
+    }
+
+    const hid_t type = H5Dget_type(source);
+    summary.raw_bytes += dimensions[0] * dimensions[1] * dimensions[2] * H5Tget_size(type);
+    H5Tclose(type);
+    summary.stored_bytes += H5Dget_storage_size(target);
+    ++summary.entities;
+
+    return target;
+}
+
+void EbvRechunker::copy_chunks_parallel(hid_t source, hid_t target, const Options &options, Summary &summary) {
+    struct Chunk {
+        hsize_t offset[3];
+        std::vector<uint8_t> data;
+    };
+
+    ChunkReader reader(source, target);
+    const auto chunk_bytes = reader.chunk_bytes();
+    const auto element_size = reader.element_size();
+    const auto memory_limit = std::max<size_t>(options.memory_limit / 2, chunk_bytes);
+
+    std::mutex mutex;
+    std::condition_variable jobs_available;
+    std::condition_variable results_available;
+    std::deque<Chunk> jobs;
+    std::deque<Chunk> results;
+    std::exception_ptr error;
+    bool is_finished = false;
+    size_t bytes_in_flight = 0;
+
+    const auto compress = [&]() {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            jobs_available.wait(lock, [&]() { return is_finished || !jobs.empty(); });
+            if (jobs.empty()) {
+                return;
+            }
+
+            Chunk chunk = std::move(jobs.front());
+            jobs.pop_front();
+            lock.unlock();
+
+            try {
+                chunk.data = filter_chunk(std::move(chunk.data), element_size, options.layout);
+                lock.lock();
+                results.push_back(std::move(chunk));
+            } catch (...) {
+                lock.lock();
+                error = std::current_exception();
+            }
+            results_available.notify_one();
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < std::max<size_t>(options.threads, 1); ++i) {
+        threads.emplace_back(compress);
+    }
+
+    // HDF5 is only used by this thread, it writes the chunks that the threads compressed in between reads
+    const auto write_results = [&](std::unique_lock<std::mutex> &lock, bool wait) {
+        if (wait) {
+            results_available.wait(lock, [&]() { return error || !results.empty(); });
+        }
+        if (error) {
+            std::rethrow_exception(error);
+        }
+
+        while (!results.empty()) {
+            Chunk chunk = std::move(results.front());
+            results.pop_front();
+            bytes_in_flight -= chunk_bytes;
+            lock.unlock();
+
+            const herr_t status = H5Dwrite_chunk(target, H5P_DEFAULT, 0, chunk.offset, chunk.data.size(), chunk.data.data());
+
+            lock.lock();
+            if (status < 0) {
+                throw EbvRechunkerException("Unable to write a chunk");
+            }
+            ++summary.chunks;
+        }
+    };
+
+    try {
+        std::vector<uint8_t> buffer;
+        while (reader.next()) {
+            if (!reader.read(buffer)) {
+                ++summary.empty_chunks; // left unallocated, so that reads return the fill value
+                continue;
+            }
+
+            Chunk chunk{{reader.offset()[0], reader.offset()[1], reader.offset()[2]}, std::move(buffer)};
+            buffer = std::vector<uint8_t>();
+
+            std::unique_lock<std::mutex> lock(mutex);
+            write_results(lock, false);
+            while (bytes_in_flight > 0 && bytes_in_flight + chunk_bytes > memory_limit) {
+                write_results(lock, true);
+            }
+
+            jobs.push_back(std::move(chunk));
+            bytes_in_flight += chunk_bytes;
+            jobs_available.notify_one();
+        }
+
+        std::unique_lock<std::mutex> lock(mutex);
+        while (bytes_in_flight > 0) {
+            write_results(lock, true);
+        }
+        is_finished = true;
+    } catch (...) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            is_finished = true;
+            jobs.clear();
+        }
+        jobs_available.notify_all();
+        for (auto &thread : threads) {
+            thread.join();
+        }
+        throw;
+    }
+
+    jobs_available.notify_all();
+    for (auto &thread : threads) {
+        thread.join();
+    }
+}
+
+void EbvRechunker::copy_chunks_serial(hid_t source, hid_t target, Summary &summary) {
+    ChunkReader reader(source, target);
+
+    std::vector<uint8_t> buffer;
+    while (reader.next()) {
+        if (!reader.read(buffer)) {
+            ++summary.empty_chunks;
+            continue;
+        }
+
+        reader.write(target, buffer);
+        ++summary.chunks;
+    }
+}
+
+void EbvRechunker::attach_dimension_scales(hid_t source_file, hid_t target_file, const std::vector<std::string> &datasets) {
+    const auto collect = [](hid_t, unsigned int, hid_t scale, void *data) -> herr_t {
+        const auto length = H5Iget_name(scale, nullptr, 0);
+        std::string name(static_cast<size_t>(length), '\0');
+        H5Iget_name(scale, &name[0], name.size() + 1);
+        static_cast<std::vector<std::string> *>(data)->push_back(name);
+        return 0;
+    };
+
+    for (const auto &path : datasets) {
+        const hid_t source = H5Dopen2(source_file, path.c_str(), H5P_DEFAULT);
+        const hid_t target = H5Dopen2(target_file, path.c_str(), H5P_DEFAULT);
+
+        const hid_t space = H5Dget_space(source);
+        const auto rank = static_cast<unsigned int>(H5Sget_simple_extent_ndims(space));
+        H5Sclose(space);
+
+        herr_t status = 0;
+        for (unsigned int dimension = 0; dimension < rank && status >= 0; ++dimension) {
+            std::vector<std::string> scales;
+            H5DSiterate_scales(source, dimension, nullptr, collect, &scales);
+
+            for (const auto &scale_path : scales) {
+                const hid_t scale = H5Dopen2(target_file, scale_path.c_str(), H5P_DEFAULT);
+                status = scale < 0 ? -1 : H5DSattach_scale(target, scale, dimension);
+                if (scale >= 0) {
+                    H5Dclose(scale);
+                }
+            }
+        }
+
+        H5Dclose(target);
+        H5Dclose(source);
+
+        if (status < 0) {
+            throw EbvRechunkerException("Unable to attach the dimension scales of `" + path + "`");
+        }
+    }
+}
+
+auto EbvRechunker::benchmark(const std::string &file, size_t tile_size, size_t reads, unsigned int seed) -> BenchmarkResult {
+    BenchmarkResult result{};
+
+    struct stat file_stat{};
+    if (stat(file.c_str(), &file_stat) != 0) {
+        throw EbvRechunkerException("Unable to access `" + file + "`");
+    }
+    result.file_size = static_cast<uint64_t>(file_stat.st_size);
+
+    const H5::H5File h5_file(file, H5F_ACC_RDONLY);
+
+    std::vector<std::string> entities;
+    const auto visit = [](hid_t location, const char *name, const H5O_info_t *info, void *data) -> herr_t {
+        if (info->type == H5O_TYPE_DATASET) {
+            const hid_t dataset = H5Dopen2(location, name, H5P_DEFAULT);
+            if (is_entity(dataset)) {
+                static_cast<std::vector<std::string> *>(data)->emplace_back(name);
+            }
+            H5Dclose(dataset);
+        }
+        return 0;
+    };
+    H5Ovisit(h5_file.getId(), H5_INDEX_NAME, H5_ITER_INC, visit, &entities);
+
+    if (entities.empty()) {
+        throw EbvRechunkerException("`" + file + "` contains no entities");
+    }
+
+    std::mt19937 random(seed);
+    const auto uniform = [&random](hsize_t max) -> hsize_t {
+        return std::uniform_int_distribution<hsize_t>(0, max)(random);
+    };
+
+    std::vector<float> buffer;
+
+    const auto read = [&](size_t i, bool is_time_series) -> uint64_t {
+        const auto dataset = h5_file.openDataSet(entities[i % entities.size()]);
+        H5::DataSpace file_space = dataset.getSpace();
+        hsize_t dimensions[3];
+        file_space.getSimpleExtentDims(dimensions);
+
+        hsize_t count[3];
+        if (is_time_series) {
+            count[0] = dimensions[0];
+            count[1] = count[2] = 1;
+        } else {
+            count[0] = 1;
+            count[1] = std::min<hsize_t>(tile_size, dimensions[1]);
+            count[2] = std::min<hsize_t>(tile_size, dimensions[2]);
+        }
+        const hsize_t offset[3] = {
+                uniform(dimensions[0] - count[0]),
+                uniform(dimensions[1] - count[1]),
+                uniform(dimensions[2] - count[2]),
+        };
+        file_space.selectHyperslab(H5S_SELECT_SET, count, offset);
+
+        buffer.resize(count[0] * count[1] * count[2]);
+        Hdf5TypedReader::read_dataset(dataset, buffer.data(), file_space);
+
+        return buffer.size();
+    };
+
+    drop_cached_pages(file);
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < reads; ++i) {
+        result.tile_values += read(i, false);
+    }
+    result.tile_reads = reads;
+    result.tile_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    drop_cached_pages(file);
+    start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < reads; ++i) {
+        result.time_series_values += read(i, true);
+    }
+    result.time_series_reads = reads;
+    result.time_series_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    return result;
+}
+
+void EbvRechunker::drop_cached_pages(const std::string &file) {
+    const int descriptor = open(file.c_str(), O_RDONLY | O_CLOEXEC);
+    if (descriptor < 0) {
+        throw EbvRechunkerException("Unable to access `" + file + "`");
+    }
+
+    // only clean pages are dropped, so the ones of a file that was just written must reach the disk first
+    const bool is_dropped = fsync(descriptor) == 0 && posix_fadvise(descriptor, 0, 0, POSIX_FADV_DONTNEED) == 0;
+    close(descriptor);
+
+    if (!is_dropped) {
+        throw EbvRechunkerException("Unable to drop the cached pages of `" + file + "`");
+    }
+}
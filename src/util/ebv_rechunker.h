@@ -0,0 +1,111 @@
+#ifndef MAPPING_EBV_EBV_RECHUNKER_H
+#define MAPPING_EBV_EBV_RECHUNKER_H
+
+#include <H5Cpp.h>
+
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+/// Rewrites EBV NetCDF files with a different chunk shape and compression of their entities.
+///
+/// Groups, datasets, attributes and dimension scales are copied as they are, so that the result is still a NetCDF-4 file
+/// that `NetCdfParser` reads like the original. Only the (time, lat, lon) entity datasets get the new layout.
+class EbvRechunker {
+    public:
+        struct EbvRechunkerException : public std::runtime_error {
+            using std::runtime_error::runtime_error;
+        };
+
+        enum class Codec {
+            None, Deflate, Zstd, Lz4,
+        };
+
+        /// Chunk shape and compression of the entity datasets
+        struct Layout {
+            /// chunk extents, `0` stands for the full extent of the dimension
+            hsize_t chunk_time = 1;
+            hsize_t chunk_height = 256;
+            hsize_t chunk_width = 256;
+
+            Codec codec = Codec::Deflate;
+            /// level of deflate (0-9) and zstd (1-22)
+            int level = 4;
+            bool shuffle = false;
+
+            /// Formats the layout as accepted by `parse`
+            auto to_string() const -> std::string;
+
+            /// Parses `<time>x<lat>x<lon>[/none|/deflate[:<level>]|/zstd[:<level>]|/lz4][/shuffle]`, e.g. `12x32x32/deflate:6/shuffle`
+            static auto parse(const std::string &layout) -> Layout;
+        };
+
+        struct Options {
+            Layout layout;
+            /// threads that compress chunks, only used for `Codec::None` and `Codec::Deflate`
+            size_t threads = 4;
+            /// bound of the memory for the chunk cache of the source and the chunks that wait for compression, the chunk cache
+            /// exceeds it if one row of target chunks overlaps more source chunks, see `Summary::warnings`
+            size_t memory_limit = 256u << 20u;
+        };
+
+        struct Summary {
+            size_t entities;
+            /// chunks that were written, chunks with fill values only are left unallocated
+            size_t chunks;
+            size_t empty_chunks;
+            uint64_t raw_bytes;
+            uint64_t stored_bytes;
+            double seconds;
+            /// e.g. source chunk caches that exceed the memory limit
+            std::vector<std::string> warnings;
+        };
+
+        /// Read throughput of one file for tile-style and time-series-style access
+        struct BenchmarkResult {
+            uint64_t file_size;
+            size_t tile_reads;
+            uint64_t tile_values;
+            double tile_seconds;
+            size_t time_series_reads;
+            uint64_t time_series_values;
+            double time_series_seconds;
+        };
+
+        static auto rechunk(const std::string &source, const std::string &target, const Options &options) -> Summary;
+
+        /// Reads `reads` random tiles of at most `tile_size`² values and `reads` random full time series from the entities
+        /// of `file`. Every read opens its dataset again, like the raster read path does, so that no chunk cache is reused.
+        /// Both kinds of reads start cold: the file is synced and its pages are dropped from the page cache before each,
+        /// so files that were just written are not favored over ones that were never read.
+        static auto benchmark(const std::string &file, size_t tile_size, size_t reads, unsigned int seed) -> BenchmarkResult;
+
+        /// Whether HDF5 can write `codec`, zstd and LZ4 require the filter plugins of the HDF Group
+        static auto is_available(Codec codec) -> bool;
+
+        /// Writes the dirty pages of `file` and evicts all of its pages from the page cache
+        static void drop_cached_pages(const std::string &file);
+
+        static constexpr H5Z_filter_t zstd_filter = 32015;
+        static constexpr H5Z_filter_t lz4_filter = 32004;
+
+    private:
+        static void copy_group(hid_t source, hid_t target, const std::string &path, const Options &options,
+                               Summary &summary, std::vector<std::string> &datasets_with_dimensions);
+
+        static void copy_attributes(hid_t source, hid_t target, H5_index_t index);
+
+        static auto copy_entity(hid_t source, hid_t target_group, const std::string &name, const Options &options,
+                                Summary &summary) -> hid_t;
+
+        /// Compresses chunks in parallel and writes them with `H5Dwrite_chunk`
+        static void copy_chunks_parallel(hid_t source, hid_t target, const Options &options, Summary &summary);
+
+        /// Writes chunks through the filter pipeline of HDF5, for filters that are only available as plugins
+        static void copy_chunks_serial(hid_t source, hid_t target, Summary &summary);
+
+        static void attach_dimension_scales(hid_t source_file, hid_t target_file, const std::vector<std::string> &datasets);
+};
+
+#endif //MAPPING_EBV_EBV_RECHUNKER_H
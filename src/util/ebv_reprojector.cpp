@@ -0,0 +1,265 @@
+#include "ebv_reprojector.h"
+#include "crs_cache.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <sstream>
+
+auto EbvReprojector::CoordinateGrid::source_window(size_t source_width, size_t source_height) const -> EbvRasterReader::Window {
+    double min_column = static_cast<double>(source_width), max_column = -1;
+    double min_row = static_cast<double>(source_height), max_row = -1;
+
+    for (size_t i = 0; i < columns.size(); ++i) {
+        const double column = std::floor(columns[i]);
+        const double row = std::floor(rows[i]);
+        if (!(column >= 0 && column < source_width && row >= 0 && row < source_height)) { // also skips NaN
+            continue;
+        }
+
+        min_column = std::min(min_column, column);
+        max_column = std::max(max_column, column);
+        min_row = std::min(min_row, row);
+        max_row = std::max(max_row, row);
+    }
+
+    if (max_column < 0) {
+        return EbvRasterReader::Window{.x_offset = 0, .y_offset = 0, .width = 0, .height = 0};
+    }
+
+    return EbvRasterReader::Window{
+            .x_offset = static_cast<size_t>(min_column),
+            .y_offset = static_cast<size_t>(min_row),
+            .width = static_cast<size_t>(max_column - min_column) + 1,
+            .height = static_cast<size_t>(max_row - min_row) + 1,
+    };
+}
+
+auto EbvReprojector::instance() -> EbvReprojector & {
+    static EbvReprojector reprojector;
+    return reprojector;
+}
+
+EbvReprojector::EbvReprojector(size_t max_bytes, size_t grid_step) : max_bytes(max_bytes), grid_step(grid_step) {}
+
+void EbvReprojector::configure(size_t max_bytes, size_t grid_step) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    this->max_bytes = max_bytes;
+    if (this->grid_step != grid_step) { // cached grids were computed with the other step
+        this->grid_step = grid_step;
+        grids.clear();
+        lru.clear();
+        bytes = 0;
+    }
+
+    evict();
+}
+
+auto EbvReprojector::grid(const std::string &source_crs,
+                          const NetCdfParser::NetCdfGeoReference &source,
+                          const std::string &target_crs,
+                          const Bounds &target,
+                          size_t width,
+                          size_t height) -> std::shared_ptr<const CoordinateGrid> {
+    std::ostringstream key_stream;
+    key_stream << std::setprecision(17)
+               << source_crs << '\n' << source.origin_x << ' ' << source.origin_y << ' ' << source.pixel_width << ' '
+               << source.pixel_height << ' ' << source.width << ' ' << source.height << '\n'
+               << target_crs << '\n' << target.min_x << ' ' << target.min_y << ' ' << target.max_x << ' ' << target.max_y
+               << '\n' << width << ' ' << height;
+    const auto key = key_stream.str();
+
+    size_t step;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        const auto entry = grids.find(key);
+        if (entry != grids.end()) {
+            lru.splice(lru.begin(), lru, entry->second.lru_position);
+            return entry->second.grid;
+        }
+
+        step = grid_step;
+    }
+
+    const auto transformation = CrsCache::instance().transformation(target_crs, source_crs);
+    auto grid = std::make_shared<const CoordinateGrid>(compute_grid(
+            source, target, width, height,
+            [&transformation](size_t count, double *x, double *y) { transformation->transform(count, x, y); },
+            step
+    ));
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    const auto entry_bytes = grid_bytes(*grid);
+    if (grids.find(key) == grids.end() && entry_bytes <= max_bytes) {
+        lru.push_front(key);
+        grids.emplace(key, Entry{grid, entry_bytes, lru.begin()});
+        bytes += entry_bytes;
+        evict();
+    }
+
+    return grid;
+}
+
+auto EbvReprojector::compute_grid(const NetCdfParser::NetCdfGeoReference &source,
+                                  const Bounds &target,
+                                  size_t width,
+                                  size_t height,
+                                  const Transform &to_source,
+                                  size_t step,
+                                  double max_error) -> CoordinateGrid {
+    if (width == 0 || height == 0 || step == 0) {
+        throw EbvReprojectorException("EbvReprojector: The raster and the grid step must not be empty");
+    }
+
+    CoordinateGrid grid{width, height, std::vector<double>(width * height), std::vector<double>(width * height)};
+
+    const double target_pixel_width = (target.max_x - target.min_x) / static_cast<double>(width);
+    const double target_pixel_height = (target.max_y - target.min_y) / static_cast<double>(height);
+
+    // turns target pixel positions into source pixel positions, with one call of `to_source`
+    const auto transform_pixels = [&](std::vector<double> &x, std::vector<double> &y) {
+        for (size_t i = 0; i < x.size(); ++i) {
+            x[i] = target.min_x + (x[i] + 0.5) * target_pixel_width;
+            y[i] = target.max_y - (y[i] + 0.5) * target_pixel_height;
+        }
+
+        to_source(x.size(), x.data(), y.data());
+
+        for (size_t i = 0; i < x.size(); ++i) {
+            x[i] = (x[i] - source.origin_x) / source.pixel_width;
+            y[i] = (y[i] - source.origin_y) / source.pixel_height;
+        }
+    };
+
+    // lattice of exactly transformed pixels, including the last row and column
+    const auto lattice = [step](size_t size) -> std::vector<size_t> {
+        std::vector<size_t> nodes;
+        for (size_t node = 0; node < size - 1; node += step) {
+            nodes.push_back(node);
+        }
+        nodes.push_back(size - 1);
+        return nodes;
+    };
+    const auto node_columns = lattice(width);
+    const auto node_rows = lattice(height);
+    const size_t cell_columns = node_columns.size() - 1;
+    const size_t cell_rows = node_rows.size() - 1;
+
+    // nodes first, then the centers of the cells between them
+    std::vector<double> x, y;
+    for (const auto row : node_rows) {
+        for (const auto column : node_columns) {
+            x.push_back(column);
+            y.push_back(row);
+        }
+    }
+    for (size_t j = 0; j < cell_rows; ++j) {
+        for (size_t i = 0; i < cell_columns; ++i) {
+            x.push_back((node_columns[i] + node_columns[i + 1]) / 2.0);
+            y.push_back((node_rows[j] + node_rows[j + 1]) / 2.0);
+        }
+    }
+    transform_pixels(x, y);
+
+    const auto node = [&](size_t i, size_t j) -> size_t { return j * node_columns.size() + i; };
+    const size_t centers = node_columns.size() * node_rows.size();
+
+    std::vector<size_t> exact_pixels;
+    if (cell_columns == 0 || cell_rows == 0) { // a single row or column
+        for (size_t pixel = 0; pixel < width * height; ++pixel) {
+            exact_pixels.push_back(pixel);
+        }
+    }
+
+    for (size_t j = 0; j < cell_rows; ++j) {
+        for (size_t i = 0; i < cell_columns; ++i) {
+            const size_t corners[] = {node(i, j), node(i + 1, j), node(i, j + 1), node(i + 1, j + 1)};
+            const size_t center = centers + j * cell_columns + i;
+
+            bool is_linear = std::isfinite(x[center]) && std::isfinite(y[center]);
+            double mean_x = 0, mean_y = 0;
+            for (const auto corner : corners) {
+                is_linear = is_linear && std::isfinite(x[corner]) && std::isfinite(y[corner]);
+                mean_x += x[corner] / 4;
+                mean_y += y[corner] / 4;
+            }
+            is_linear = is_linear && std::abs(mean_x - x[center]) <= max_error && std::abs(mean_y - y[center]) <= max_error;
+
+            const size_t column_begin = node_columns[i], column_end = node_columns[i + 1];
+            const size_t row_begin = node_rows[j], row_end = node_rows[j + 1];
+
+            for (size_t row = row_begin; row <= row_end; ++row) {
+                for (size_t column = column_begin; column <= column_end; ++column) {
+                    const size_t pixel = row * width + column;
+
+                    if (!is_linear) {
+                        exact_pixels.push_back(pixel);
+                        continue;
+                    }
+
+                    const double u = static_cast<double>(column - column_begin) / static_cast<double>(column_end - column_begin);
+                    const double v = static_cast<double>(row - row_begin) / static_cast<double>(row_end - row_begin);
+                    const auto interpolate = [u, v, &corners](const std::vector<double> &values) -> double {
+                        return (1 - v) * ((1 - u) * values[corners[0]] + u * values[corners[1]])
+                               + v * ((1 - u) * values[corners[2]] + u * values[corners[3]]);
+                    };
+
+                    grid.columns[pixel] = interpolate(x);
+                    grid.rows[pixel] = interpolate(y);
+                }
+            }
+        }
+    }
+
+    // pixels on the edge of a linear and a non-linear cell end up exact, since these are written last
+    if (!exact_pixels.empty()) {
+        std::vector<double> exact_x(exact_pixels.size()), exact_y(exact_pixels.size());
+        for (size_t k = 0; k < exact_pixels.size(); ++k) {
+            exact_x[k] = static_cast<double>(exact_pixels[k] % width);
+            exact_y[k] = static_cast<double>(exact_pixels[k] / width);
+        }
+        transform_pixels(exact_x, exact_y);
+        for (size_t k = 0; k < exact_pixels.size(); ++k) {
+            grid.columns[exact_pixels[k]] = exact_x[k];
+            grid.rows[exact_pixels[k]] = exact_y[k];
+        }
+    }
+
+    return grid;
+}
+
+auto EbvReprojector::resample(const CoordinateGrid &grid, const EbvRasterReader::Tile &tile) -> std::vector<float> {
+    std::vector<float> values(grid.width * grid.height, tile.no_data);
+    if (tile.is_empty) {
+        return values;
+    }
+
+    const auto &window = tile.window;
+    for (size_t i = 0; i < values.size(); ++i) {
+        const double column = std::floor(grid.columns[i]) - static_cast<double>(window.x_offset);
+        const double row = std::floor(grid.rows[i]) - static_cast<double>(window.y_offset);
+        if (!(column >= 0 && column < window.width && row >= 0 && row < window.height)) { // also skips NaN
+            continue;
+        }
+
+        values[i] = tile.values[static_cast<size_t>(row) * window.width + static_cast<size_t>(column)];
+    }
+
+    return values;
+}
+
+auto EbvReprojector::grid_bytes(const CoordinateGrid &grid) -> size_t {
+    return sizeof(CoordinateGrid) + (grid.columns.capacity() + grid.rows.capacity()) * sizeof(double);
+}
+
+void EbvReprojector::evict() {
+    while (bytes > max_bytes && !lru.empty()) {
+        const auto entry = grids.find(lru.back());
+        bytes -= entry->second.bytes;
+        grids.erase(entry);
+        lru.pop_back();
+    }
+}
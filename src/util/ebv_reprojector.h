@@ -0,0 +1,105 @@
+#ifndef MAPPING_EBV_EBV_REPROJECTOR_H
+#define MAPPING_EBV_EBV_REPROJECTOR_H
+
+#include "ebv_raster_reader.h"
+#include "netcdf_parser.h"
+
+#include <functional>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+/// Reprojects windows of EBV grids to rasters in another coordinate reference system, e.g. Web Mercator tiles.
+///
+/// The source position of each target pixel is kept in a coordinate grid, which is computed from a sparse lattice of
+/// exactly transformed points and cached, so that repeated requests for a tile transform no coordinates at all.
+class EbvReprojector {
+    public:
+        struct EbvReprojectorException : public std::runtime_error {
+            using std::runtime_error::runtime_error;
+        };
+
+        /// Extent of a target raster in its coordinate reference system
+        struct Bounds {
+            double min_x;
+            double min_y;
+            double max_x;
+            double max_y;
+        };
+
+        /// Fractional source pixel positions of the pixel centers of a target raster, row-major.
+        /// Positions that can not be transformed are NaN.
+        struct CoordinateGrid {
+            size_t width;
+            size_t height;
+            std::vector<double> columns;
+            std::vector<double> rows;
+
+            /// The smallest window of a `source_width` x `source_height` grid that contains all positions,
+            /// with a `width` of zero if it contains none
+            auto source_window(size_t source_width, size_t source_height) const -> EbvRasterReader::Window;
+        };
+
+        /// Transforms `count` coordinates from the target to the source reference system in place, failures are NaN
+        using Transform = std::function<void(size_t count, double *x, double *y)>;
+
+        static auto instance() -> EbvReprojector &;
+
+        /// Caches coordinate grids up to `max_bytes`, a grid takes 16 bytes per pixel
+        explicit EbvReprojector(size_t max_bytes = 64u << 20u, size_t grid_step = 16);
+
+        EbvReprojector(const EbvReprojector &) = delete;
+
+        EbvReprojector &operator=(const EbvReprojector &) = delete;
+
+        void configure(size_t max_bytes, size_t grid_step);
+
+        /// The coordinate grid of a `width` x `height` raster in `target_crs`, computed once and then taken from the cache
+        auto grid(const std::string &source_crs,
+                  const NetCdfParser::NetCdfGeoReference &source,
+                  const std::string &target_crs,
+                  const Bounds &target,
+                  size_t width,
+                  size_t height) -> std::shared_ptr<const CoordinateGrid>;
+
+        /// Transforms every `step`th pixel and interpolates the others bilinearly.
+        /// Cells whose center deviates more than `max_error` source pixels from the interpolation are transformed
+        /// pixel by pixel.
+        static auto compute_grid(const NetCdfParser::NetCdfGeoReference &source,
+                                 const Bounds &target,
+                                 size_t width,
+                                 size_t height,
+                                 const Transform &to_source,
+                                 size_t step,
+                                 double max_error = 0.125) -> CoordinateGrid;
+
+        /// Nearest neighbor values of `tile` at the positions of `grid`, and `tile.no_data` outside of it
+        static auto resample(const CoordinateGrid &grid, const EbvRasterReader::Tile &tile) -> std::vector<float>;
+
+    private:
+        struct Entry {
+            std::shared_ptr<const CoordinateGrid> grid;
+            size_t bytes;
+            std::list<std::string>::iterator lru_position;
+        };
+
+        static auto grid_bytes(const CoordinateGrid &grid) -> size_t;
+
+        void evict();
+
+        std::mutex mutex;
+        std::map<std::string, Entry> grids;
+        /// most recently used first
+        std::list<std::string> lru;
+
+        size_t bytes = 0;
+
+        size_t max_bytes;
+        size_t grid_step;
+};
+
+#endif //MAPPING_EBV_EBV_REPROJECTOR_H
@@ -0,0 +1,165 @@
+#include "ebv_response_cache.h"
+
+auto EbvResponseCache::instance() -> EbvResponseCache & {
+    static EbvResponseCache cache;
+    return cache;
+}
+
+EbvResponseCache::EbvResponseCache(size_t max_bytes, size_t min_compressed_bytes, int level)
+        : max_bytes(max_bytes), min_compressed_bytes(min_compressed_bytes), level(level) {}
+
+void EbvResponseCache::configure(size_t max_bytes, size_t min_compressed_bytes, int level) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    this->max_bytes = max_bytes;
+    this->level = level;
+
+    if (this->min_compressed_bytes != min_compressed_bytes) { // stored variants may not match the threshold
+        this->min_compressed_bytes = min_compressed_bytes;
+        for (auto &entry : entries) {
+            for (const auto &variant : entry.second.variants) {
+                entry.second.bytes -= variant.second->size();
+                bytes -= variant.second->size();
+            }
+            entry.second.variants.clear();
+        }
+    }
+
+    evict();
+}
+
+auto EbvResponseCache::get(const std::string &key,
+                           const std::string &file,
+                           HttpCompression::Encoding encoding,
+                           Body &body) -> bool {
+    const auto file_status = FileStatus::of(file);
+
+    std::shared_ptr<const std::string> identity;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        auto entry = entries.find(key);
+        if (entry == entries.end()) {
+            return false;
+        }
+
+        if (entry->second.file_status != file_status) {
+            bytes -= entry->second.bytes;
+            lru.erase(entry->second.lru_position);
+            entries.erase(entry);
+            return false;
+        }
+
+        lru.splice(lru.begin(), lru, entry->second.lru_position);
+
+        identity = entry->second.identity;
+
+        const auto variant = entry->second.variants.find(encoding);
+        if (variant != entry->second.variants.end()) {
+            body = Body{encoding, variant->second};
+            return true;
+        }
+    }
+
+    // compress without holding the lock, a concurrent request may do the same and only one variant is kept
+    body = encode(identity, encoding);
+    add_variant(key, identity, body);
+
+    return true;
+}
+
+auto EbvResponseCache::put(const std::string &key,
+                           const FileStatus &file_status,
+                           std::string data,
+                           HttpCompression::Encoding encoding) -> Body {
+    const auto identity = std::make_shared<const std::string>(std::move(data));
+    const auto body = encode(identity, encoding);
+
+    Entry entry{file_status, identity, {}, identity->size(), {}};
+    if (body.encoding != HttpCompression::Encoding::Identity) {
+        entry.variants[body.encoding] = body.data;
+        entry.bytes += body.data->size();
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    auto existing = entries.find(key);
+    if (existing != entries.end()) {
+        bytes -= existing->second.bytes;
+        lru.erase(existing->second.lru_position);
+        entries.erase(existing);
+    }
+
+    if (entry.bytes <= max_bytes) {
+        lru.push_front(key);
+        entry.lru_position = lru.begin();
+        bytes += entry.bytes;
+        entries.emplace(key, std::move(entry));
+
+        evict();
+    }
+
+    return body;
+}
+
+auto EbvResponseCache::size_in_bytes() const -> size_t {
+    std::lock_guard<std::mutex> lock(mutex);
+    return bytes;
+}
+
+void EbvResponseCache::clear() {
+    std::lock_guard<std::mutex> lock(mutex);
+    entries.clear();
+    lru.clear();
+    bytes = 0;
+}
+
+auto EbvResponseCache::encode(const std::shared_ptr<const std::string> &identity,
+                              HttpCompression::Encoding encoding) const -> Body {
+    size_t threshold;
+    int compression_level;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        threshold = min_compressed_bytes;
+        compression_level = level;
+    }
+
+    if (encoding == HttpCompression::Encoding::Identity || identity->size() < threshold) {
+        return Body{HttpCompression::Encoding::Identity, identity};
+    }
+
+    return Body{encoding, std::make_shared<const std::string>(HttpCompression::compress(*identity, encoding, compression_level))};
+}
+
+void EbvResponseCache::add_variant(const std::string &key,
+                                   const std::shared_ptr<const std::string> &identity,
+                                   const Body &body) {
+    if (body.encoding == HttpCompression::Encoding::Identity) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    auto entry = entries.find(key);
+    if (entry == entries.end() || entry->second.identity != identity) {
+        return; // replaced or evicted in the meantime
+    }
+
+    auto &variant = entry->second.variants[body.encoding];
+    if (!variant) {
+        variant = body.data;
+        entry->second.bytes += variant->size();
+        bytes += variant->size();
+
+        evict();
+    }
+}
+
+void EbvResponseCache::evict() {
+    while (bytes > max_bytes && !lru.empty()) {
+        auto entry = entries.find(lru.back());
+        bytes -= entry->second.bytes;
+        entries.erase(entry);
+        lru.pop_back();
+    }
+}
@@ -0,0 +1,84 @@
+#ifndef MAPPING_EBV_EBV_RESPONSE_CACHE_H
+#define MAPPING_EBV_EBV_RESPONSE_CACHE_H
+
+#include "file_status.h"
+#include "http_compression.h"
+
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+/// Process-wide cache of serialized responses that are derived from a single EBV file.
+///
+/// Each entry keeps its body together with the compressed variants that were requested so far,
+/// so a hit is sent without serializing or compressing again.
+/// Entries are dropped if their file was modified and, least recently used first, if the cache exceeds its size.
+class EbvResponseCache {
+    public:
+        /// A response body and the encoding it is stored in
+        struct Body {
+            HttpCompression::Encoding encoding;
+            std::shared_ptr<const std::string> data;
+        };
+
+        static auto instance() -> EbvResponseCache &;
+
+        /// Bodies below `min_compressed_bytes` are always sent as they are
+        explicit EbvResponseCache(size_t max_bytes = 64u << 20u,
+                                  size_t min_compressed_bytes = 1024,
+                                  int level = Z_DEFAULT_COMPRESSION);
+
+        EbvResponseCache(const EbvResponseCache &) = delete;
+
+        EbvResponseCache &operator=(const EbvResponseCache &) = delete;
+
+        void configure(size_t max_bytes, size_t min_compressed_bytes, int level);
+
+        /// Retrieve the body of `key` in `encoding`, compressing and storing the variant if it is missing.
+        /// Returns `false` if there is no valid entry for `key`.
+        auto get(const std::string &key, const std::string &file, HttpCompression::Encoding encoding, Body &body) -> bool;
+
+        /// Store `data` as the body of `key` and return it in `encoding`.
+        /// `file_status` is the one of its file before `data` was derived from it, so that a body of a file that was
+        /// modified meanwhile is dropped on the next `get`.
+        auto put(const std::string &key,
+                 const FileStatus &file_status,
+                 std::string data,
+                 HttpCompression::Encoding encoding) -> Body;
+
+        /// Bytes of all stored bodies and variants
+        auto size_in_bytes() const -> size_t;
+
+        void clear();
+
+    private:
+        struct Entry {
+            FileStatus file_status;
+            std::shared_ptr<const std::string> identity;
+            std::map<HttpCompression::Encoding, std::shared_ptr<const std::string>> variants;
+            size_t bytes;
+            std::list<std::string>::iterator lru_position;
+        };
+
+        /// The variant of `identity`, or `identity` itself if it is too small to be compressed
+        auto encode(const std::shared_ptr<const std::string> &identity, HttpCompression::Encoding encoding) const -> Body;
+
+        /// Store a compressed variant of `key`, if the entry still holds `identity`
+        void add_variant(const std::string &key, const std::shared_ptr<const std::string> &identity, const Body &body);
+
+        void evict();
+
+        mutable std::mutex mutex;
+        std::map<std::string, Entry> entries;
+        /// most recently used first
+        std::list<std::string> lru;
+
+        size_t max_bytes;
+        size_t min_compressed_bytes;
+        int level;
+        size_t bytes = 0;
+};
+
+#endif //MAPPING_EBV_EBV_RESPONSE_CACHE_H
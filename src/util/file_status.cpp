@@ -0,0 +1,39 @@
+#include "file_status.h"
+
+#include <sys/stat.h>
+
+auto FileStatus::of(const std::string &path) -> FileStatus {
+    struct stat file_stat{};
+    if (stat(path.c_str(), &file_stat) != 0) {
+        return FileStatus{0, 0, -1};
+    }
+    return FileStatus{
+            static_cast<int64_t>(file_stat.st_mtim.tv_sec),
+            static_cast<int64_t>(file_stat.st_mtim.tv_nsec),
+            static_cast<int64_t>(file_stat.st_size),
+    };
+}
+
+auto FileStatus::to_json() const -> Json::Value {
+    Json::Value json(Json::objectValue);
+    json["modification_seconds"] = static_cast<Json::Int64>(modification_seconds);
+    json["modification_nanoseconds"] = static_cast<Json::Int64>(modification_nanoseconds);
+    json["size"] = static_cast<Json::Int64>(size);
+    return json;
+}
+
+auto FileStatus::from_json(const Json::Value &json) -> FileStatus {
+    if (!json.isObject()) {
+        throw FileStatusException("Invalid file status");
+    }
+    for (const auto &name : {"modification_seconds", "modification_nanoseconds", "size"}) {
+        if (!json[name].isInt64()) {
+            throw FileStatusException(std::string("Missing or invalid `") + name + "` of a file status");
+        }
+    }
+    return FileStatus{
+            json["modification_seconds"].asInt64(),
+            json["modification_nanoseconds"].asInt64(),
+            json["size"].asInt64(),
+    };
+}
@@ -0,0 +1,48 @@
+#ifndef MAPPING_EBV_FILE_STATUS_H
+#define MAPPING_EBV_FILE_STATUS_H
+
+#include <json/json.h>
+
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+
+/// Version of a file on disk, which changes whenever the file is written or replaced.
+///
+/// Caches of anything derived from a file keep the status it was read at, taken before the read, and drop the entry
+/// once the status differs. Modification times are compared in nanoseconds, so that rewrites within the same second
+/// are noticed as well.
+struct FileStatus {
+    struct FileStatusException : public std::runtime_error {
+        using std::runtime_error::runtime_error;
+    };
+
+    int64_t modification_seconds;
+    int64_t modification_nanoseconds;
+    /// `-1` if the file does not exist
+    int64_t size;
+
+    /// The status of `path`, with a `size` of `-1` if it does not exist
+    static auto of(const std::string &path) -> FileStatus;
+
+    auto exists() const -> bool {
+        return size >= 0;
+    }
+
+    auto operator==(const FileStatus &other) const -> bool {
+        return modification_seconds == other.modification_seconds
+               && modification_nanoseconds == other.modification_nanoseconds
+               && size == other.size;
+    }
+
+    auto operator!=(const FileStatus &other) const -> bool {
+        return !(*this == other);
+    }
+
+    auto to_json() const -> Json::Value;
+
+    /// Throws if `json` is no object of `to_json`
+    static auto from_json(const Json::Value &json) -> FileStatus;
+};
+
+#endif //MAPPING_EBV_FILE_STATUS_H
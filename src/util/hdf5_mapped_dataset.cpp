@@ -0,0 +1,140 @@
+#include "hdf5_mapped_dataset.h"
+#include "file_status.h"
+
+#include <algorithm>
+#include <fcntl.h>
+#include <map>
+#include <mutex>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+Hdf5MappedDataset::MappedFile::~MappedFile() {
+    munmap(const_cast<uint8_t *>(address), length);
+}
+
+auto Hdf5MappedDataset::MappedFile::open(const std::string &path) -> std::shared_ptr<const MappedFile> {
+    /// A file that was replaced has another inode, one rewritten in place another modification time or size
+    struct Version {
+        ino_t inode;
+        FileStatus status;
+
+        auto operator==(const Version &other) const -> bool {
+            return inode == other.inode && status == other.status;
+        }
+    };
+
+    struct CacheEntry {
+        Version version;
+        std::shared_ptr<const MappedFile> file;
+    };
+
+    const auto version_of = [](const std::string &file_path, Version &version) -> bool {
+        struct stat file_stat{};
+        if (stat(file_path.c_str(), &file_stat) != 0) {
+            return false;
+        }
+        version = Version{file_stat.st_ino, FileStatus{file_stat.st_mtim.tv_sec, file_stat.st_mtim.tv_nsec, file_stat.st_size}};
+        return true;
+    };
+
+    static std::mutex mutex;
+    static std::map<std::string, CacheEntry> cache;
+
+    Version version{};
+    if (!version_of(path, version) || version.status.size == 0) {
+        return nullptr;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    const auto entry = cache.find(path);
+    if (entry != cache.end() && entry->second.version == version) {
+        return entry->second.file;
+    }
+
+    const int descriptor = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (descriptor < 0) {
+        return nullptr;
+    }
+
+    const auto length = static_cast<size_t>(version.status.size);
+    void *address = mmap(nullptr, length, PROT_READ, MAP_SHARED, descriptor, 0);
+    close(descriptor); // the mapping keeps the file open
+
+    if (address == MAP_FAILED) {
+        return nullptr;
+    }
+
+    // tiles and time series touch scattered pages, so sequential read-ahead would mostly read unused data
+    madvise(address, length, MADV_RANDOM);
+
+    std::shared_ptr<const MappedFile> file(new MappedFile(static_cast<const uint8_t *>(address), length));
+    cache[path] = CacheEntry{version, file};
+
+    // mapping a file is rare, so that is when the mappings of other files that were deleted or changed are released;
+    // their readers keep them until they are done
+    for (auto other = cache.begin(); other != cache.end();) {
+        Version other_version{};
+        const bool is_superseded = !version_of(other->first, other_version) || !(other_version == other->second.version);
+        other = is_superseded ? cache.erase(other) : std::next(other);
+    }
+
+    return file;
+}
+
+void Hdf5MappedDataset::MappedFile::will_need(size_t offset, size_t bytes) const {
+    static const auto page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+
+    const auto first_page = offset - offset % page_size;
+    const auto end = std::min(offset + bytes, length);
+    if (end <= first_page) {
+        return;
+    }
+
+    madvise(const_cast<uint8_t *>(address) + first_page, end - first_page, MADV_WILLNEED);
+}
+
+auto Hdf5MappedDataset::map(const std::string &path, const H5::DataSet &dataset) -> std::shared_ptr<const Hdf5MappedDataset> {
+    const auto creation_properties = dataset.getCreatePlist();
+    if (creation_properties.getLayout() != H5D_CONTIGUOUS
+        || creation_properties.getNfilters() != 0
+        || creation_properties.getExternalCount() != 0) {
+        return nullptr;
+    }
+
+    const H5::DataType data_type = dataset.getDataType();
+    const auto data_type_class = data_type.getClass();
+    if ((data_type_class != H5T_INTEGER && data_type_class != H5T_FLOAT)
+        || H5Tget_order(data_type.getId()) != H5Tget_order(H5T_NATIVE_INT)) {
+        return nullptr;
+    }
+
+    Hdf5TypedReader::NumericType type;
+    try {
+        type = Hdf5TypedReader::numeric_type(data_type);
+    } catch (const Hdf5TypedReader::Hdf5TypedReaderException &e) {
+        return nullptr;
+    }
+
+    const haddr_t offset = H5Dget_offset(dataset.getId()); // undefined if the storage was never allocated
+    if (offset == HADDR_UNDEF) {
+        return nullptr;
+    }
+
+    const auto space = dataset.getSpace();
+    std::vector<hsize_t> h5_dimensions(static_cast<size_t>(space.getSimpleExtentNdims()));
+    space.getSimpleExtentDims(h5_dimensions.data());
+
+    const std::vector<size_t> dimensions(h5_dimensions.cbegin(), h5_dimensions.cend());
+    const auto bytes = static_cast<size_t>(space.getSimpleExtentNpoints()) * data_type.getSize();
+
+    auto file = MappedFile::open(path);
+    if (!file || offset + bytes > file->size()) {
+        return nullptr;
+    }
+
+    return std::shared_ptr<const Hdf5MappedDataset>(
+            new Hdf5MappedDataset(std::move(file), static_cast<size_t>(offset), type, data_type.getSize(), dimensions)
+    );
+}
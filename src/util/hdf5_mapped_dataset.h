@@ -0,0 +1,95 @@
+#ifndef MAPPING_EBV_HDF5_MAPPED_DATASET_H
+#define MAPPING_EBV_HDF5_MAPPED_DATASET_H
+
+#include "hdf5_typed_reader.h"
+
+#include <H5Cpp.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+/// Zero-copy access to datasets that HDF5 stores as one contiguous, unfiltered, native-endian block.
+///
+/// Such datasets are served from a read-only `mmap` of their file, which is shared by all readers of the process.
+/// Reads then cost neither syscalls nor copies once the pages are in the page cache.
+class Hdf5MappedDataset {
+    public:
+        /// Read-only mapping of a whole file
+        class MappedFile {
+            public:
+                ~MappedFile();
+
+                MappedFile(const MappedFile &) = delete;
+
+                MappedFile &operator=(const MappedFile &) = delete;
+
+                /// Maps `path` or returns the existing mapping, if the file did not change since
+                static auto open(const std::string &path) -> std::shared_ptr<const MappedFile>;
+
+                auto data() const -> const uint8_t * {
+                    return address;
+                }
+
+                auto size() const -> size_t {
+                    return length;
+                }
+
+                /// Asks the kernel to read the pages of a byte range ahead of the access
+                void will_need(size_t offset, size_t bytes) const;
+
+            private:
+                MappedFile(const uint8_t *address, size_t length) : address(address), length(length) {}
+
+                const uint8_t *address;
+                size_t length;
+        };
+
+        /// Maps `dataset` of the file at `path`, or returns `nullptr` if it is not stored contiguously, unfiltered and
+        /// in native byte order
+        static auto map(const std::string &path, const H5::DataSet &dataset) -> std::shared_ptr<const Hdf5MappedDataset>;
+
+        auto numeric_type() const -> Hdf5TypedReader::NumericType {
+            return type;
+        }
+
+        auto dimensions() const -> const std::vector<size_t> & {
+            return extent;
+        }
+
+        auto element_size() const -> size_t {
+            return bytes_per_element;
+        }
+
+        /// Pointer to the first element, valid as long as this object lives
+        auto data() const -> const void * {
+            return file->data() + offset;
+        }
+
+        /// Typed pointer to the first element, `T` must match `numeric_type`
+        template<class T>
+        auto values() const -> const T * {
+            return reinterpret_cast<const T *>(data());
+        }
+
+        /// Asks the kernel to read `number_of_elements` elements from element `first_element` ahead of the access
+        void will_need(size_t first_element, size_t number_of_elements) const {
+            file->will_need(offset + first_element * bytes_per_element, number_of_elements * bytes_per_element);
+        }
+
+    private:
+        Hdf5MappedDataset(std::shared_ptr<const MappedFile> file,
+                          size_t offset,
+                          Hdf5TypedReader::NumericType type,
+                          size_t bytes_per_element,
+                          std::vector<size_t> extent)
+                : file(std::move(file)), offset(offset), type(type), bytes_per_element(bytes_per_element), extent(std::move(extent)) {}
+
+        std::shared_ptr<const MappedFile> file;
+        size_t offset;
+        Hdf5TypedReader::NumericType type;
+        size_t bytes_per_element;
+        std::vector<size_t> extent;
+};
+
+#endif //MAPPING_EBV_HDF5_MAPPED_DATASET_H
@@ -0,0 +1,118 @@
+#include "hdf5_typed_reader.h"
+
+auto Hdf5TypedReader::numeric_type(const H5::DataType &data_type) -> NumericType {
+    const auto size = data_type.getSize();
+
+    switch (data_type.getClass()) {
+        case H5T_INTEGER: {
+            const bool is_signed = H5Tget_sign(data_type.getId()) == H5T_SGN_2;
+            switch (size) {
+                case 1:
+                    return is_signed ? NumericType::Int8 : NumericType::UInt8;
+                case 2:
+                    return is_signed ? NumericType::Int16 : NumericType::UInt16;
+                case 4:
+                    return is_signed ? NumericType::Int32 : NumericType::UInt32;
+                case 8:
+                    return is_signed ? NumericType::Int64 : NumericType::UInt64;
+                default:
+                    throw Hdf5TypedReaderException("Unsupported integer size (" + std::to_string(size) + " bytes)");
+            }
+        }
+        case H5T_FLOAT:
+            switch (size) {
+                case 2:
+                    return NumericType::Half;
+                case 4:
+                    return NumericType::Float;
+                case 8:
+                    return NumericType::Double;
+                default:
+                    throw Hdf5TypedReaderException("Unsupported float size (" + std::to_string(size) + " bytes)");
+            }
+        default:
+            throw Hdf5TypedReaderException("Unsupported datatype class (" + std::to_string(data_type.getClass()) + ")");
+    }
+}
+
+auto Hdf5TypedReader::half_to_float(Half half) -> float {
+    const uint32_t sign = static_cast<uint32_t>(half.bits & 0x8000u) << 16;
+    uint32_t exponent = (half.bits >> 10) & 0x1fu;
+    uint32_t mantissa = half.bits & 0x3ffu;
+
+    uint32_t bits;
+    if (exponent == 0x1f) { // infinity or NaN
+        bits = sign | 0x7f800000u | (mantissa << 13);
+    } else if (exponent != 0) { // normalized
+        bits = sign | ((exponent + 127 - 15) << 23) | (mantissa << 13);
+    } else if (mantissa == 0) { // zero
+        bits = sign;
+    } else { // subnormal, normalize it
+        exponent = 127 - 15 + 1;
+        while ((mantissa & 0x400u) == 0) {
+            mantissa <<= 1;
+            --exponent;
+        }
+        bits = sign | (exponent << 23) | ((mantissa & 0x3ffu) << 13);
+    }
+
+    float result;
+    std::memcpy(&result, &bits, sizeof(float));
+    return result;
+}
+
+auto Hdf5TypedReader::packing(const H5::DataSet &dataset) -> Packing {
+    Packing packing;
+
+    const auto read_scalar = [&dataset](const std::string &name, double &value) -> bool {
+        if (!dataset.attrExists(name)) {
+            return false;
+        }
+        const auto attribute = dataset.openAttribute(name);
+        if (number_of_values(attribute) != 1) {
+            return false;
+        }
+        read_attribute(attribute, &value);
+        return true;
+    };
+
+    read_scalar("scale_factor", packing.scale_factor);
+    read_scalar("add_offset", packing.add_offset);
+    packing.has_fill_value = read_scalar("_FillValue", packing.fill_value)
+                             || read_scalar("missing_value", packing.fill_value);
+
+    if (!packing.has_fill_value) { // fall back to the fill value of the dataset itself
+        const auto creation_properties = dataset.getCreatePlist();
+        if (creation_properties.isFillValueDefined() == H5D_FILL_VALUE_USER_DEFINED) {
+            creation_properties.getFillValue(H5::PredType::NATIVE_DOUBLE, &packing.fill_value);
+            packing.has_fill_value = true;
+        }
+    }
+
+    return packing;
+}
+
+auto Hdf5TypedReader::number_of_values(const H5::Attribute &attribute) -> size_t {
+    return static_cast<size_t>(attribute.getSpace().getSimpleExtentNpoints());
+}
+
+auto Hdf5TypedReader::number_of_values(const H5::DataSet &dataset, const H5::DataSpace &file_space) -> size_t {
+    if (file_space.getId() == H5S_ALL) {
+        return static_cast<size_t>(dataset.getSpace().getSimpleExtentNpoints());
+    }
+    return static_cast<size_t>(file_space.getSelectNpoints());
+}
+
+auto Hdf5TypedReader::memory_type(const H5::DataType &data_type) -> H5::DataType {
+    H5::DataType type(data_type);
+    type.copy(data_type); // detach from the stored type, so that it may be modified
+    H5Tset_order(type.getId(), H5Tget_order(H5T_NATIVE_INT));
+    return type;
+}
+
+void Hdf5TypedReader::check_numeric(const H5::DataType &data_type, const std::string &object_name) {
+    const auto data_type_class = data_type.getClass();
+    if (data_type_class != H5T_INTEGER && data_type_class != H5T_FLOAT) {
+        throw Hdf5TypedReaderException("Unsupported datatype class (" + std::to_string(data_type_class) + ") of `" + object_name + "`");
+    }
+}
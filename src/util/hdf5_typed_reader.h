@@ -0,0 +1,275 @@
+#ifndef MAPPING_EBV_HDF5_TYPED_READER_H
+#define MAPPING_EBV_HDF5_TYPED_READER_H
+
+#include <H5Cpp.h>
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+/// Reads numeric HDF5 attributes and datasets of any integer or floating point type directly into a target type.
+///
+/// Plain reads let HDF5 convert into the caller's buffer in a single pass.
+/// Packed reads (`scale_factor`, `add_offset`, `_FillValue`) read the stored type and unpack it in one fused pass.
+class Hdf5TypedReader {
+    public:
+        struct Hdf5TypedReaderException : public std::runtime_error {
+            using std::runtime_error::runtime_error;
+        };
+
+        /// IEEE 754 binary16 as stored in the file, HDF5 offers no native type for it
+        struct Half {
+            uint16_t bits;
+        };
+
+        enum class NumericType {
+            Int8, UInt8, Int16, UInt16, Int32, UInt32, Int64, UInt64, Half, Float, Double,
+        };
+
+        template<class T>
+        struct TypeTag {
+            using type = T;
+        };
+
+        /// CF packing attributes of a variable
+        struct Packing {
+            double scale_factor = 1.;
+            double add_offset = 0.;
+            bool has_fill_value = false;
+            double fill_value = 0.;
+
+            auto is_identity() const -> bool {
+                return scale_factor == 1. && add_offset == 0. && !has_fill_value;
+            }
+        };
+
+        /// Maps a C++ type to the matching native HDF5 memory type
+        template<class T>
+        static auto native_type() -> const H5::PredType &;
+
+        /// Determines the numeric type of a stored type or throws if it is no integer or floating point type
+        static auto numeric_type(const H5::DataType &data_type) -> NumericType;
+
+        /// Calls `visitor(TypeTag<T>{})` with `T` being the C++ type that matches the stored type
+        template<class Visitor>
+        static auto dispatch(const H5::DataType &data_type, Visitor &&visitor) -> decltype(visitor(TypeTag<double>{})) {
+            return dispatch(numeric_type(data_type), std::forward<Visitor>(visitor));
+        }
+
+        template<class Visitor>
+        static auto dispatch(NumericType type, Visitor &&visitor) -> decltype(visitor(TypeTag<double>{}));
+
+        static auto half_to_float(Half half) -> float;
+
+        /// Reads the CF packing attributes of `dataset`, using its HDF5 fill value if there is no `_FillValue`
+        static auto packing(const H5::DataSet &dataset) -> Packing;
+
+        /// Reads all values of `attribute` into `buffer`, which must hold `number_of_values(attribute)` elements
+        template<class T>
+        static void read_attribute(const H5::Attribute &attribute, T *buffer);
+
+        template<class T>
+        static auto read_attribute(const H5::Attribute &attribute) -> std::vector<T>;
+
+        /// Reads the selection `file_space` of `dataset` into `buffer`, which must hold all selected elements
+        template<class T>
+        static void read_dataset(const H5::DataSet &dataset, T *buffer, const H5::DataSpace &file_space = H5::DataSpace::ALL);
+
+        template<class T>
+        static auto read_dataset(const H5::DataSet &dataset, const H5::DataSpace &file_space = H5::DataSpace::ALL) -> std::vector<T>;
+
+        /// Reads the selection `file_space` of `dataset` into `buffer` and applies `packing`.
+        /// Fill values are replaced by `no_data`.
+        template<class T>
+        static void read_dataset_unpacked(const H5::DataSet &dataset,
+                                          const Packing &packing,
+                                          T *buffer,
+                                          T no_data = default_no_data<T>(),
+                                          const H5::DataSpace &file_space = H5::DataSpace::ALL);
+
+        template<class T>
+        static auto read_dataset_unpacked(const H5::DataSet &dataset,
+                                          const Packing &packing,
+                                          T no_data = default_no_data<T>(),
+                                          const H5::DataSpace &file_space = H5::DataSpace::ALL) -> std::vector<T>;
+
+        static auto number_of_values(const H5::Attribute &attribute) -> size_t;
+
+        static auto number_of_values(const H5::DataSet &dataset, const H5::DataSpace &file_space) -> size_t;
+
+        template<class T>
+        static auto default_no_data() -> T {
+            return std::numeric_limits<T>::has_quiet_NaN ? std::numeric_limits<T>::quiet_NaN() : std::numeric_limits<T>::lowest();
+        }
+
+        /// Unpacks `number_of_values` values from `source` to `target`.
+        /// `source` may alias `target` if `Source` is not larger than `Target`, since values are converted back to front.
+        template<class Source, class Target>
+        static void unpack(const Source *source, Target *target, size_t number_of_values, const Packing &packing, Target no_data);
+
+    private:
+        /// The stored type in native byte order, used for reading values without conversion
+        static auto memory_type(const H5::DataType &data_type) -> H5::DataType;
+
+        static auto as_double(Half value) -> double {
+            return half_to_float(value);
+        }
+
+        template<class Source>
+        static auto as_double(Source value) -> double {
+            return static_cast<double>(value);
+        }
+
+        static void check_numeric(const H5::DataType &data_type, const std::string &object_name);
+};
+
+template<> inline auto Hdf5TypedReader::native_type<int8_t>() -> const H5::PredType & { return H5::PredType::NATIVE_INT8; }
+
+template<> inline auto Hdf5TypedReader::native_type<uint8_t>() -> const H5::PredType & { return H5::PredType::NATIVE_UINT8; }
+
+template<> inline auto Hdf5TypedReader::native_type<int16_t>() -> const H5::PredType & { return H5::PredType::NATIVE_INT16; }
+
+template<> inline auto Hdf5TypedReader::native_type<uint16_t>() -> const H5::PredType & { return H5::PredType::NATIVE_UINT16; }
+
+template<> inline auto Hdf5TypedReader::native_type<int32_t>() -> const H5::PredType & { return H5::PredType::NATIVE_INT32; }
+
+template<> inline auto Hdf5TypedReader::native_type<uint32_t>() -> const H5::PredType & { return H5::PredType::NATIVE_UINT32; }
+
+template<> inline auto Hdf5TypedReader::native_type<int64_t>() -> const H5::PredType & { return H5::PredType::NATIVE_INT64; }
+
+template<> inline auto Hdf5TypedReader::native_type<uint64_t>() -> const H5::PredType & { return H5::PredType::NATIVE_UINT64; }
+
+template<> inline auto Hdf5TypedReader::native_type<float>() -> const H5::PredType & { return H5::PredType::NATIVE_FLOAT; }
+
+template<> inline auto Hdf5TypedReader::native_type<double>() -> const H5::PredType & { return H5::PredType::NATIVE_DOUBLE; }
+
+template<class Visitor>
+auto Hdf5TypedReader::dispatch(NumericType type, Visitor &&visitor) -> decltype(visitor(TypeTag<double>{})) {
+    switch (type) {
+        case NumericType::Int8:
+            return visitor(TypeTag<int8_t>{});
+        case NumericType::UInt8:
+            return visitor(TypeTag<uint8_t>{});
+        case NumericType::Int16:
+            return visitor(TypeTag<int16_t>{});
+        case NumericType::UInt16:
+            return visitor(TypeTag<uint16_t>{});
+        case NumericType::Int32:
+            return visitor(TypeTag<int32_t>{});
+        case NumericType::UInt32:
+            return visitor(TypeTag<uint32_t>{});
+        case NumericType::Int64:
+            return visitor(TypeTag<int64_t>{});
+        case NumericType::UInt64:
+            return visitor(TypeTag<uint64_t>{});
+        case NumericType::Half:
+            return visitor(TypeTag<Half>{});
+        case NumericType::Float:
+            return visitor(TypeTag<float>{});
+        case NumericType::Double:
+        default:
+            return visitor(TypeTag<double>{});
+    }
+}
+
+template<class T>
+void Hdf5TypedReader::read_attribute(const H5::Attribute &attribute, T *buffer) {
+    check_numeric(attribute.getDataType(), attribute.getName());
+
+    attribute.read(native_type<T>(), static_cast<void *>(buffer));
+}
+
+template<class T>
+auto Hdf5TypedReader::read_attribute(const H5::Attribute &attribute) -> std::vector<T> {
+    std::vector<T> buffer(number_of_values(attribute));
+    read_attribute(attribute, buffer.data());
+    return buffer;
+}
+
+template<class T>
+void Hdf5TypedReader::read_dataset(const H5::DataSet &dataset, T *buffer, const H5::DataSpace &file_space) {
+    check_numeric(dataset.getDataType(), dataset.getObjName());
+
+    const hsize_t size = number_of_values(dataset, file_space);
+    const H5::DataSpace memory_space(1, &size);
+
+    dataset.read(static_cast<void *>(buffer), native_type<T>(), memory_space, file_space);
+}
+
+template<class T>
+auto Hdf5TypedReader::read_dataset(const H5::DataSet &dataset, const H5::DataSpace &file_space) -> std::vector<T> {
+    std::vector<T> buffer(number_of_values(dataset, file_space));
+    read_dataset(dataset, buffer.data(), file_space);
+    return buffer;
+}
+
+template<class T>
+void Hdf5TypedReader::read_dataset_unpacked(const H5::DataSet &dataset,
+                                            const Packing &packing,
+                                            T *buffer,
+                                            T no_data,
+                                            const H5::DataSpace &file_space) {
+    if (packing.is_identity()) {
+        read_dataset(dataset, buffer, file_space);
+        return;
+    }
+
+    const H5::DataType data_type = dataset.getDataType();
+    const hsize_t size = number_of_values(dataset, file_space);
+    const H5::DataSpace memory_space(1, &size);
+
+    dispatch(data_type, [&](auto tag) {
+        using Source = typename decltype(tag)::type;
+
+        const auto source_memory_type = memory_type(data_type);
+
+        if (sizeof(Source) <= sizeof(T)) { // read stored values into the target buffer and unpack in place
+            dataset.read(static_cast<void *>(buffer), source_memory_type, memory_space, file_space);
+            unpack(reinterpret_cast<const Source *>(buffer), buffer, size, packing, no_data);
+        } else {
+            std::vector<Source> source(size);
+            dataset.read(static_cast<void *>(source.data()), source_memory_type, memory_space, file_space);
+            unpack(source.data(), buffer, size, packing, no_data);
+        }
+    });
+}
+
+template<class T>
+auto Hdf5TypedReader::read_dataset_unpacked(const H5::DataSet &dataset,
+                                            const Packing &packing,
+                                            T no_data,
+                                            const H5::DataSpace &file_space) -> std::vector<T> {
+    std::vector<T> buffer(number_of_values(dataset, file_space));
+    read_dataset_unpacked(dataset, packing, buffer.data(), no_data, file_space);
+    return buffer;
+}
+
+template<class Source, class Target>
+void Hdf5TypedReader::unpack(const Source *source,
+                             Target *target,
+                             size_t number_of_values,
+                             const Packing &packing,
+                             Target no_data) {
+    const double scale_factor = packing.scale_factor;
+    const double add_offset = packing.add_offset;
+    const bool has_fill_value = packing.has_fill_value;
+    const double fill_value = packing.fill_value;
+    const bool fill_value_is_nan = std::isnan(fill_value);
+
+    for (size_t i = number_of_values; i-- > 0;) {
+        Source raw;
+        std::memcpy(&raw, &source[i], sizeof(Source)); // `source[i]` and `target[i]` may overlap
+        const double value = as_double(raw);
+
+        const bool is_fill = has_fill_value && (value == fill_value || (fill_value_is_nan && std::isnan(value)));
+
+        target[i] = is_fill ? no_data : static_cast<Target>(value * scale_factor + add_offset);
+    }
+}
+
+#endif //MAPPING_EBV_HDF5_TYPED_READER_H
@@ -0,0 +1,193 @@
+#include "http_compression.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <sstream>
+
+auto HttpCompression::negotiate(const std::string &accept_encoding) -> Encoding {
+    double gzip_quality = -1, deflate_quality = -1, wildcard_quality = -1;
+
+    std::istringstream codings(accept_encoding);
+    std::string coding;
+    while (std::getline(codings, coding, ',')) {
+        std::string name = coding.substr(0, coding.find(';'));
+        name.erase(std::remove_if(name.begin(), name.end(), [](char c) { return std::isspace(static_cast<unsigned char>(c)); }), name.end());
+        std::transform(name.begin(), name.end(), name.begin(), [](char c) { return std::tolower(static_cast<unsigned char>(c)); });
+
+        double quality = 1;
+        const auto q = coding.find("q=");
+        if (q != std::string::npos) {
+            try {
+                quality = std::stod(coding.substr(q + 2));
+            } catch (const std::logic_error &e) {
+                quality = 0;
+            }
+        }
+
+        if (name == "gzip" || name == "x-gzip") {
+            gzip_quality = quality;
+        } else if (name == "deflate") {
+            deflate_quality = quality;
+        } else if (name == "*") {
+            wildcard_quality = quality;
+        }
+    }
+
+    // codings that are not listed take the quality of `*`
+    if (gzip_quality < 0) {
+        gzip_quality = wildcard_quality;
+    }
+    if (deflate_quality < 0) {
+        deflate_quality = wildcard_quality;
+    }
+
+    if (gzip_quality > 0 && gzip_quality >= deflate_quality) {
+        return Encoding::Gzip;
+    }
+    if (deflate_quality > 0) {
+        return Encoding::Deflate;
+    }
+    return Encoding::Identity;
+}
+
+auto HttpCompression::negotiate_environment(const char *const *environment) -> Encoding {
+    static const std::string variable = "HTTP_ACCEPT_ENCODING=";
+
+    for (auto entry = environment; entry != nullptr && *entry != nullptr; ++entry) {
+        if (std::strncmp(*entry, variable.c_str(), variable.size()) == 0) {
+            return negotiate(std::string(*entry + variable.size()));
+        }
+    }
+
+    return Encoding::Identity;
+}
+
+auto HttpCompression::name(Encoding encoding) -> std::string {
+    switch (encoding) {
+        case Encoding::Gzip:
+            return "gzip";
+        case Encoding::Deflate:
+            return "deflate";
+        case Encoding::Identity:
+        default:
+            return "identity";
+    }
+}
+
+auto HttpCompression::compress(const std::string &data, Encoding encoding, int level) -> std::string {
+    std::ostringstream compressed;
+    {
+        StreamBuffer buffer(compressed, encoding, 0, level, nullptr);
+        std::ostream stream(&buffer);
+        stream.write(data.data(), static_cast<std::streamsize>(data.size()));
+        buffer.finish();
+    }
+    return compressed.str();
+}
+
+HttpCompression::StreamBuffer::StreamBuffer(std::ostream &sink, Encoding encoding, size_t threshold, int level, StartCallback on_start)
+        : sink(sink), encoding(encoding), threshold(threshold), level(level), on_start(std::move(on_start)) {
+    setp(input.data(), input.data() + input.size());
+}
+
+HttpCompression::StreamBuffer::~StreamBuffer() {
+    if (is_deflating) {
+        deflateEnd(&stream);
+    }
+}
+
+auto HttpCompression::StreamBuffer::overflow(int_type character) -> int_type {
+    consume(pbase(), static_cast<size_t>(pptr() - pbase()));
+    setp(input.data(), input.data() + input.size());
+
+    if (!traits_type::eq_int_type(character, traits_type::eof())) {
+        *pptr() = traits_type::to_char_type(character);
+        pbump(1);
+    }
+    return traits_type::not_eof(character);
+}
+
+auto HttpCompression::StreamBuffer::sync() -> int {
+    consume(pbase(), static_cast<size_t>(pptr() - pbase()));
+    setp(input.data(), input.data() + input.size());
+    return 0;
+}
+
+void HttpCompression::StreamBuffer::finish() {
+    if (is_finished) {
+        return;
+    }
+
+    sync();
+
+    if (!is_started) { // smaller than the threshold
+        start(pending.size() < threshold ? Encoding::Identity : encoding);
+    }
+
+    if (is_deflating) {
+        deflate_to_sink(nullptr, 0, Z_FINISH);
+    }
+
+    sink.flush();
+    is_finished = true;
+}
+
+void HttpCompression::StreamBuffer::consume(const char *data, size_t size) {
+    if (size == 0) {
+        return;
+    }
+
+    if (!is_started) {
+        pending.append(data, size);
+        if (pending.size() >= threshold && threshold > 0) {
+            start(encoding);
+        }
+        return;
+    }
+
+    if (is_deflating) {
+        deflate_to_sink(data, size, Z_NO_FLUSH);
+    } else {
+        sink.write(data, static_cast<std::streamsize>(size));
+    }
+}
+
+void HttpCompression::StreamBuffer::start(Encoding chosen_encoding) {
+    is_started = true;
+
+    if (on_start) {
+        on_start(chosen_encoding);
+    }
+
+    if (chosen_encoding != Encoding::Identity) {
+        // gzip adds 16 to the window bits, HTTP `deflate` is the zlib format
+        const int window_bits = chosen_encoding == Encoding::Gzip ? 15 + 16 : 15;
+        if (deflateInit2(&stream, level, Z_DEFLATED, window_bits, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+            throw HttpCompressionException("Unable to initialize the compressor");
+        }
+        is_deflating = true;
+    }
+
+    std::string buffered;
+    buffered.swap(pending);
+    consume(buffered.data(), buffered.size());
+}
+
+void HttpCompression::StreamBuffer::deflate_to_sink(const char *data, size_t size, int flush) {
+    stream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(data));
+    stream.avail_in = static_cast<uInt>(size);
+
+    int status;
+    do {
+        stream.next_out = reinterpret_cast<Bytef *>(output.data());
+        stream.avail_out = static_cast<uInt>(output.size());
+
+        status = deflate(&stream, flush);
+        if (status == Z_STREAM_ERROR) {
+            throw HttpCompressionException("Unable to compress the response");
+        }
+
+        sink.write(output.data(), static_cast<std::streamsize>(output.size() - stream.avail_out));
+    } while (stream.avail_out == 0 || (flush == Z_FINISH && status != Z_STREAM_END));
+}
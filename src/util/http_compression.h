@@ -0,0 +1,86 @@
+#ifndef MAPPING_EBV_HTTP_COMPRESSION_H
+#define MAPPING_EBV_HTTP_COMPRESSION_H
+
+#include <zlib.h>
+
+#include <array>
+#include <functional>
+#include <ostream>
+#include <stdexcept>
+#include <streambuf>
+#include <string>
+
+/// HTTP content encoding of response bodies with zlib
+class HttpCompression {
+    public:
+        struct HttpCompressionException : public std::runtime_error {
+            using std::runtime_error::runtime_error;
+        };
+
+        enum class Encoding {
+            Identity, Gzip, Deflate,
+        };
+
+        /// Chooses the supported encoding with the highest quality of an `Accept-Encoding` header, preferring gzip
+        static auto negotiate(const std::string &accept_encoding) -> Encoding;
+
+        /// Negotiates with the `Accept-Encoding` header in the CGI environment of a request, which is the null-terminated
+        /// `envp` of a FastCGI request. The process environment is no option, since FastCGI does not set it per request.
+        static auto negotiate_environment(const char *const *environment) -> Encoding;
+
+        /// The `Content-Encoding` token of `encoding`
+        static auto name(Encoding encoding) -> std::string;
+
+        static auto compress(const std::string &data, Encoding encoding, int level = Z_DEFAULT_COMPRESSION) -> std::string;
+
+        /// Compresses everything written to it into `sink`, without holding the whole body.
+        ///
+        /// The encoding is decided once `threshold` bytes were written, or at `finish` for smaller bodies, which are
+        /// then sent as they are. `on_start` is called with the decision before the first byte reaches `sink`,
+        /// e.g. to send the headers.
+        class StreamBuffer : public std::streambuf {
+            public:
+                using StartCallback = std::function<void(Encoding encoding)>;
+
+                StreamBuffer(std::ostream &sink, Encoding encoding, size_t threshold, int level, StartCallback on_start);
+
+                ~StreamBuffer() override;
+
+                StreamBuffer(const StreamBuffer &) = delete;
+
+                StreamBuffer &operator=(const StreamBuffer &) = delete;
+
+                /// Writes the remaining bytes and the end of the compressed stream
+                void finish();
+
+            protected:
+                auto overflow(int_type character) -> int_type override;
+
+                auto sync() -> int override;
+
+            private:
+                void consume(const char *data, size_t size);
+
+                void start(Encoding chosen_encoding);
+
+                void deflate_to_sink(const char *data, size_t size, int flush);
+
+                std::ostream &sink;
+                Encoding encoding;
+                size_t threshold;
+                int level;
+                StartCallback on_start;
+
+                bool is_started = false;
+                bool is_finished = false;
+                bool is_deflating = false;
+                /// bytes before the decision, at most `threshold`
+                std::string pending;
+
+                z_stream stream{};
+                std::array<char, 16384> input{};
+                std::array<char, 16384> output{};
+        };
+};
+
+#endif //MAPPING_EBV_HTTP_COMPRESSION_H
@@ -6,7 +6,8 @@
 #include <boost/date_time/posix_time/ptime.hpp>
 #include <boost/date_time/posix_time/posix_time_duration.hpp>
 #include "netcdf_parser.h"
-#include <gdal/ogr_spatialref.h>
+#include "hdf5_typed_reader.h"
+#include "crs_cache.h"
 
 auto attribute_to_string(const H5::Attribute &attribute) -> std::string {
     std::string buffer;
@@ -64,16 +65,6 @@ auto dataset_to_string_vector(const H5::DataSet &dataSet) -> std::vector<std::st
     return strings;
 }
 
-auto dataset_to_float_vector(const H5::DataSet &dataSet) -> std::vector<float> {
-    const auto number_of_values = dataSet.getSpace().getSimpleExtentNpoints();
-
-    std::vector<float> buffer(number_of_values);
-
-    dataSet.read(static_cast<void *>(buffer.data()), dataSet.getDataType());
-
-    return buffer;
-}
-
 auto NetCdfParser::crs_wkt() const -> std::string {
     const auto dataSet = file.openDataSet("crs");
     const auto attribute = dataSet.openAttribute("spatial_ref");
@@ -81,26 +72,7 @@ auto NetCdfParser::crs_wkt() const -> std::string {
 }
 
 auto NetCdfParser::crs_as_code() const -> std::string {
-
-    const std::string crs_wkt = this->crs_wkt();
-    Log::debug(concat("NetCdfParser: CRS wkt string: ", crs_wkt));
-
-    std::string crs_code;
-    OGRSpatialReference sref = OGRSpatialReference(crs_wkt.c_str());
-    if (sref.IsGeographic()) {
-        const std::string geogcs_authority = std::string(sref.GetAuthorityName("GEOGCS"));
-        const std::string geogcs_code = std::string(sref.GetAuthorityCode("GEOGCS"));
-        crs_code = concat(geogcs_authority, ":", geogcs_code);
-    }
-    if (sref.IsProjected()) {
-        const std::string projcs_authority = std::string(sref.GetAuthorityName("PROJCS"));
-        const std::string projcs_code = std::string(sref.GetAuthorityCode("PROJCS"));
-        crs_code = concat(projcs_authority, ":", projcs_code);
-    }
-
-    Log::debug(concat("NetCdfParser: CRS code: ", crs_code));
-
-    return crs_code;
+    return CrsCache::instance().code(this->crs_wkt());
 }
 
 auto NetCdfParser::ebv_class() const -> std::string {
@@ -221,8 +193,7 @@ auto NetCdfParser::time_info() const -> NetCdfParser::NetCdfTimeInfo {
     std::transform(time_delta_unit.begin(), time_delta_unit.end(), time_delta_unit.begin(),
                    [](unsigned char c) { return std::tolower(c); });
 
-    const auto time_vector = dataset_to_float_vector(time_field);
-    const auto time_points = std::vector<double>(time_vector.cbegin(), time_vector.cend());
+    const auto time_points = Hdf5TypedReader::read_dataset<double>(time_field);
 
     return {
             .time_start = time_start,
@@ -286,7 +257,7 @@ auto NetCdfParser::unit_range(const std::vector<std::string> &entity_path) const
     for (const auto &group_name : entity_path) {
         if (group.attrExists(value_range_identifier)) {
             H5::Attribute value_range = group.openAttribute(value_range_identifier);
-            std::vector<double> range = attribute_to_casted_double_vector(value_range);
+            const std::vector<double> range = Hdf5TypedReader::read_attribute<double>(value_range);
 
             if (range.size() != 2) {
                 throw NetCdfParserException(concat("Attribute `value_range` must contain 2 element, but contains ", range.size()));
@@ -301,53 +272,24 @@ auto NetCdfParser::unit_range(const std::vector<std::string> &entity_path) const
     return {0., 1.}; // default if nothing is found
 }
 
-/// Reads `to.capacity()` number of values from the attribute, casts it and pastes it to `to`
-template<class NumberType>
-auto NetCdfParser::attribute_to_casted_double_vector_typed(const H5::Attribute &attribute) -> std::vector<double> {
-    const auto number_of_values = attribute.getSpace().getSimpleExtentNpoints();
-
-    std::vector<NumberType> buffer(number_of_values);
-
-    attribute.read(attribute.getDataType(), static_cast<void *>(buffer.data()));
-
-    std::vector<double> result;
-    result.reserve(number_of_values);
+auto NetCdfParser::geo_reference() const -> NetCdfParser::NetCdfGeoReference {
+    const auto lon = Hdf5TypedReader::read_dataset<double>(file.openDataSet("lon"));
+    const auto lat = Hdf5TypedReader::read_dataset<double>(file.openDataSet("lat"));
 
-    for (auto value : buffer) {
-        result.emplace_back(value);
+    if (lon.size() < 2 || lat.size() < 2) {
+        throw NetCdfParserException("NetCdfParser: `lat` and `lon` need at least two coordinates");
     }
 
-    return result;
-}
+    // coordinates are pixel centers on a regular grid
+    const double pixel_width = (lon.back() - lon.front()) / static_cast<double>(lon.size() - 1);
+    const double pixel_height = (lat.back() - lat.front()) / static_cast<double>(lat.size() - 1);
 
-auto NetCdfParser::attribute_to_casted_double_vector(const H5::Attribute &attribute) -> std::vector<double> {
-    const H5::DataType datatype = attribute.getDataType();
-    const H5T_class_t datatype_class = datatype.getClass();
-
-    switch (datatype_class) {
-        case H5T_INTEGER: {
-            const auto precision = attribute.getIntType().getPrecision();
-            switch (precision) {
-                case 32:
-                    return attribute_to_casted_double_vector_typed<int>(attribute);
-                case 64:
-                    return attribute_to_casted_double_vector_typed<long>(attribute);
-                default:
-                    throw NetCdfParserException(concat("Unsupported int precision (", precision, ") for `value_range`"));
-            }
-        }
-        case H5T_FLOAT: {
-            const auto precision = attribute.getFloatType().getPrecision();
-            switch (precision) {
-                case 32:
-                    return attribute_to_casted_double_vector_typed<float>(attribute);
-                case 64:
-                    return attribute_to_casted_double_vector_typed<double>(attribute);
-                default:
-                    throw NetCdfParserException(concat("Unsupported float precision (", precision, ") for `value_range`"));
-            }
-        }
-        default:
-            throw NetCdfParserException(concat("Unsupported Datatype `", datatype_class, "` for `value_range`"));
-    }
+    return {
+            .origin_x = lon.front() - pixel_width / 2,
+            .origin_y = lat.front() - pixel_height / 2,
+            .pixel_width = pixel_width,
+            .pixel_height = pixel_height,
+            .width = lon.size(),
+            .height = lat.size(),
+    };
 }
@@ -89,16 +89,40 @@ class NetCdfParser {
 
         auto unit_range(const std::vector<std::string> &dataset_path) const -> std::array<double, 2>;
 
+        /// Affine georeference of the `lat` and `lon` grid, whose coordinates are the centers of the pixels
+        struct NetCdfGeoReference {
+            /// upper left corner of the pixel (0, 0)
+            double origin_x;
+            double origin_y;
+
+            double pixel_width;
+            /// negative if the rows run from north to south
+            double pixel_height;
+
+            size_t width;
+            size_t height;
+
+            bool operator==(const NetCdfGeoReference &rhs) const {
+                return origin_x == rhs.origin_x &&
+                       origin_y == rhs.origin_y &&
+                       pixel_width == rhs.pixel_width &&
+                       pixel_height == rhs.pixel_height &&
+                       width == rhs.width &&
+                       height == rhs.height;
+            }
+
+            bool operator!=(const NetCdfGeoReference &rhs) const {
+                return !(rhs == *this);
+            }
+        };
+
+        auto geo_reference() const -> NetCdfGeoReference;
+
     protected:
         static auto time_points_as_unix(double time_start,
                                  const std::string &time_unit,
                                  const std::vector<double> &time_points) -> std::vector<double>;
 
-        static auto attribute_to_casted_double_vector(const H5::Attribute &attribute) -> std::vector<double>;
-
-        template<class T>
-        static auto attribute_to_casted_double_vector_typed(const H5::Attribute &attribute) -> std::vector<double>;
-
     private:
         H5::H5File file;
 };
@@ -0,0 +1,59 @@
+#include "string_arena.h"
+
+#include <cstring>
+#include <stdexcept>
+
+auto StringArena::View::operator==(const std::string &string) const -> bool {
+    return size == string.size() && std::memcmp(data, string.data(), size) == 0;
+}
+
+auto StringArena::intern(const std::string &string) -> Id {
+    if (ids.empty() && size() > 0) { // after `shrink`
+        for (Id id = 0; id < size(); ++id) {
+            ids.emplace(get(id), id);
+        }
+    }
+
+    const auto existing = ids.find(string);
+    if (existing != ids.end()) {
+        return existing->second;
+    }
+
+    const auto id = static_cast<Id>(size());
+    characters += string;
+    offsets.push_back(static_cast<uint32_t>(characters.size()));
+    ids.emplace(string, id);
+    return id;
+}
+
+auto StringArena::get(Id id) const -> std::string {
+    if (id >= size()) {
+        throw std::out_of_range("StringArena: Unknown string id");
+    }
+    return characters.substr(offsets[id], offsets[id + 1] - offsets[id]);
+}
+
+auto StringArena::view(Id id) const -> View {
+    if (id >= size()) {
+        throw std::out_of_range("StringArena: Unknown string id");
+    }
+    return View{characters.data() + offsets[id], offsets[id + 1] - offsets[id]};
+}
+
+auto StringArena::size() const -> size_t {
+    return offsets.size() - 1;
+}
+
+void StringArena::shrink() {
+    characters.shrink_to_fit();
+    offsets.shrink_to_fit();
+    std::unordered_map<std::string, Id>().swap(ids);
+}
+
+auto StringArena::memory_usage() const -> size_t {
+    size_t bytes = characters.capacity() + offsets.capacity() * sizeof(uint32_t);
+    for (const auto &entry : ids) {
+        bytes += entry.first.capacity() + sizeof(entry) + sizeof(void *); // node and bucket
+    }
+    return bytes;
+}
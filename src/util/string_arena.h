@@ -0,0 +1,48 @@
+#ifndef MAPPING_EBV_STRING_ARENA_H
+#define MAPPING_EBV_STRING_ARENA_H
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/// Deduplicated strings, stored back to back in a single buffer and referenced by id.
+///
+/// Each distinct string is stored once, however often it is interned. Call `shrink` once all strings are interned,
+/// to release the lookup table and the unused capacity.
+class StringArena {
+    public:
+        using Id = uint32_t;
+
+        /// Characters of a stored string, valid until the next `intern` or `shrink`
+        struct View {
+            const char *data;
+            size_t size;
+
+            auto operator==(const std::string &string) const -> bool;
+        };
+
+        /// Id of the string, storing it if it is new
+        auto intern(const std::string &string) -> Id;
+
+        auto get(Id id) const -> std::string;
+
+        /// Like `get`, without copying the string
+        auto view(Id id) const -> View;
+
+        auto size() const -> size_t;
+
+        /// Drops the lookup table of `intern`, which is rebuilt on its next call
+        void shrink();
+
+        /// Bytes of the buffer and offsets, including unused capacity
+        auto memory_usage() const -> size_t;
+
+    private:
+        std::string characters;
+        /// start of each string in `characters`, followed by the end of the last one
+        std::vector<uint32_t> offsets = {0};
+        std::unordered_map<std::string, Id> ids;
+};
+
+#endif //MAPPING_EBV_STRING_ARENA_H
@@ -0,0 +1,412 @@
+/// Load generator for the `geo_bon_catalog` service.
+///
+/// Replays a recorded workload (one query string per line, e.g. `request=subgroups&ebv_path=...`) or generates a
+/// synthetic mix of `classes`, `datasets`, `subgroups`, `subgroup_values` and `data_loading_info` requests.
+/// For the synthetic mix, the catalog is discovered through the service itself before the measurement starts.
+///
+/// Usage: mapping_ebv_load_generator --url=<service url> --session=<sessiontoken>
+///                                   [--concurrency=8] [--requests=1000] [--seed=42]
+///                                   [--workload=<file> | --mix=classes:1,datasets:2,subgroups:4,subgroup_values:8,data_loading_info:4]
+
+#include <curl/curl.h>
+#include <json/json.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct LoadGeneratorOptions {
+    std::string url;
+    std::string session;
+    size_t concurrency = 8;
+    size_t requests = 1000;
+    unsigned int seed = 42;
+    std::string workload;
+    std::map<std::string, double> mix{
+            {"classes",           1},
+            {"datasets",          2},
+            {"subgroups",         4},
+            {"subgroup_values",   8},
+            {"data_loading_info", 4},
+    };
+};
+
+auto parse_options(int argc, char *argv[]) -> LoadGeneratorOptions {
+    LoadGeneratorOptions options;
+
+    for (int i = 1; i < argc; ++i) {
+        const std::string argument(argv[i]);
+        const auto separator = argument.find('=');
+        const auto key = argument.substr(0, separator);
+        const auto value = separator == std::string::npos ? "" : argument.substr(separator + 1);
+
+        if (key == "--url") {
+            options.url = value;
+        } else if (key == "--session") {
+            options.session = value;
+        } else if (key == "--concurrency") {
+            options.concurrency = std::max(1ul, std::stoul(value));
+        } else if (key == "--requests") {
+            options.requests = std::stoul(value);
+        } else if (key == "--seed") {
+            options.seed = static_cast<unsigned int>(std::stoul(value));
+        } else if (key == "--workload") {
+            options.workload = value;
+        } else if (key == "--mix") {
+            options.mix.clear();
+            std::istringstream entries(value);
+            std::string entry;
+            while (std::getline(entries, entry, ',')) {
+                const auto colon = entry.find(':');
+                options.mix[entry.substr(0, colon)] = colon == std::string::npos ? 1. : std::stod(entry.substr(colon + 1));
+            }
+        } else {
+            throw std::invalid_argument("Unknown argument `" + argument + "`");
+        }
+    }
+
+    if (options.url.empty()) {
+        throw std::invalid_argument("Missing argument `--url`");
+    }
+
+    return options;
+}
+
+/// A request to the service, given by its query parameters
+struct CatalogRequest {
+    std::string type;
+    std::string query;
+};
+
+struct CatalogResponse {
+    bool success;
+    Json::Value json;
+};
+
+/// One connection to the service, not thread-safe
+class CatalogClient {
+    public:
+        CatalogClient(const LoadGeneratorOptions &options) : options(options), curl(curl_easy_init()) {
+            if (!curl) {
+                throw std::runtime_error("Unable to initialize cURL");
+            }
+        }
+
+        ~CatalogClient() {
+            curl_easy_cleanup(curl);
+        }
+
+        CatalogClient(const CatalogClient &) = delete;
+
+        CatalogClient &operator=(const CatalogClient &) = delete;
+
+        auto escape(const std::string &value) -> std::string {
+            char *escaped = curl_easy_escape(curl, value.c_str(), static_cast<int>(value.size()));
+            std::string result(escaped);
+            curl_free(escaped);
+            return result;
+        }
+
+        auto perform(const std::string &query) -> CatalogResponse {
+            const std::string url = options.url + (options.url.find('?') == std::string::npos ? "?" : "&")
+                                    + "service=geo_bon_catalog&sessiontoken=" + escape(options.session) + "&" + query;
+
+            std::string body;
+            curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
+            curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, &CatalogClient::write);
+            curl_easy_setopt(curl, CURLOPT_WRITEDATA, &body);
+            curl_easy_setopt(curl, CURLOPT_ACCEPT_ENCODING, ""); // accept every encoding cURL supports
+
+            if (curl_easy_perform(curl) != CURLE_OK) {
+                return {false, Json::Value()};
+            }
+
+            long status = 0;
+            curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &status);
+
+            Json::Value json;
+            if (status != 200 || !Json::Reader().parse(body, json)) {
+                return {false, json};
+            }
+
+            return {json.get("success", false).asBool(), json};
+        }
+
+    private:
+        static auto write(char *data, size_t size, size_t count, void *body) -> size_t {
+            static_cast<std::string *>(body)->append(data, size * count);
+            return size * count;
+        }
+
+        const LoadGeneratorOptions &options;
+        CURL *curl;
+};
+
+/// Reads a recorded workload and repeats it until it contains `number_of_requests` requests
+auto read_workload(const std::string &path, size_t number_of_requests) -> std::vector<CatalogRequest> {
+    std::ifstream file(path);
+    if (!file) {
+        throw std::runtime_error("Unable to open workload `" + path + "`");
+    }
+
+    std::vector<CatalogRequest> requests;
+    std::string line;
+    while (std::getline(file, line)) {
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+
+        std::string type = "unknown";
+        const auto request_position = line.find("request=");
+        if (request_position != std::string::npos) {
+            const auto start = request_position + sizeof("request=") - 1;
+            type = line.substr(start, line.find('&', start) - start);
+        }
+
+        requests.push_back(CatalogRequest{type, line});
+    }
+
+    if (requests.empty()) {
+        throw std::runtime_error("Workload `" + path + "` is empty");
+    }
+
+    const auto recorded_requests = requests.size();
+    for (size_t i = recorded_requests; i < number_of_requests; ++i) {
+        requests.push_back(requests[i % recorded_requests]);
+    }
+
+    return requests;
+}
+
+/// Everything that can be requested, discovered by walking the catalog
+struct CatalogTargets {
+    std::vector<std::string> ebv_names;
+    std::vector<std::string> ebv_paths;
+    /// query parameters for `subgroup_values`
+    std::vector<std::string> subgroup_queries;
+    /// query parameters for `data_loading_info`
+    std::vector<std::string> entity_queries;
+};
+
+auto join(const std::vector<std::string> &parts, char separator) -> std::string {
+    std::string result;
+    for (const auto &part : parts) {
+        if (!result.empty()) {
+            result += separator;
+        }
+        result += part;
+    }
+    return result;
+}
+
+void discover_subgroup_level(CatalogClient &client,
+                             CatalogTargets &targets,
+                             const std::string &ebv_path,
+                             const std::vector<std::string> &subgroups,
+                             const std::vector<std::string> &path) {
+    const auto &subgroup = subgroups[path.size()];
+    const auto query = "ebv_path=" + client.escape(ebv_path) + "&ebv_subgroup=" + client.escape(subgroup)
+                       + "&ebv_group_path=" + client.escape(join(path, '/'));
+    targets.subgroup_queries.push_back("request=subgroup_values&" + query);
+
+    const auto response = client.perform("request=subgroup_values&" + query);
+    for (const auto &value : response.json["values"]) {
+        std::vector<std::string> value_path(path);
+        value_path.push_back(value["name"].asString());
+
+        if (value_path.size() == subgroups.size()) {
+            targets.entity_queries.push_back("request=data_loading_info&ebv_path=" + client.escape(ebv_path)
+                                             + "&ebv_entity_path=" + client.escape(join(value_path, '/')));
+        } else {
+            discover_subgroup_level(client, targets, ebv_path, subgroups, value_path);
+        }
+    }
+}
+
+auto discover_catalog(CatalogClient &client) -> CatalogTargets {
+    CatalogTargets targets;
+
+    const auto classes = client.perform("request=classes");
+    if (!classes.success) {
+        throw std::runtime_error("Unable to discover catalog: `classes` failed");
+    }
+
+    for (const auto &ebv_class : classes.json["classes"]) {
+        for (const auto &ebv_name : ebv_class["ebv_names"]) {
+            targets.ebv_names.push_back(ebv_name.asString());
+
+            const auto datasets = client.perform("request=datasets&ebv_name=" + client.escape(ebv_name.asString()));
+            for (const auto &dataset : datasets.json["datasets"]) {
+                targets.ebv_paths.push_back(dataset["dataset_path"].asString());
+            }
+        }
+    }
+
+    for (const auto &ebv_path : targets.ebv_paths) {
+        const auto subgroups_response = client.perform("request=subgroups&ebv_path=" + client.escape(ebv_path));
+
+        std::vector<std::string> subgroups;
+        for (const auto &subgroup : subgroups_response.json["subgroups"]) {
+            subgroups.push_back(subgroup["name"].asString());
+        }
+
+        if (!subgroups.empty()) {
+            discover_subgroup_level(client, targets, ebv_path, subgroups, {});
+        }
+    }
+
+    return targets;
+}
+
+auto synthesize_workload(const LoadGeneratorOptions &options, CatalogClient &client) -> std::vector<CatalogRequest> {
+    const auto targets = discover_catalog(client);
+
+    std::cout << "discovered " << targets.ebv_names.size() << " EBV names, " << targets.ebv_paths.size() << " files, "
+              << targets.entity_queries.size() << " entities" << std::endl;
+
+    std::vector<std::string> types;
+    std::vector<double> weights;
+    for (const auto &entry : options.mix) {
+        types.push_back(entry.first);
+        weights.push_back(entry.second);
+    }
+
+    std::mt19937 random(options.seed);
+    std::discrete_distribution<size_t> type_distribution(weights.begin(), weights.end());
+
+    auto pick = [&random](const std::vector<std::string> &values) -> const std::string & {
+        if (values.empty()) {
+            throw std::runtime_error("Unable to synthesize workload: catalog is empty");
+        }
+        return values[std::uniform_int_distribution<size_t>(0, values.size() - 1)(random)];
+    };
+
+    std::vector<CatalogRequest> requests;
+    requests.reserve(options.requests);
+    while (requests.size() < options.requests) {
+        const auto &type = types[type_distribution(random)];
+
+        std::string query;
+        if (type == "classes") {
+            query = "request=classes";
+        } else if (type == "datasets") {
+            query = "request=datasets&ebv_name=" + client.escape(pick(targets.ebv_names));
+        } else if (type == "subgroups") {
+            query = "request=subgroups&ebv_path=" + client.escape(pick(targets.ebv_paths));
+        } else if (type == "subgroup_values") {
+            query = pick(targets.subgroup_queries);
+        } else if (type == "data_loading_info") {
+            query = pick(targets.entity_queries);
+        } else {
+            throw std::invalid_argument("Unknown request type `" + type + "` in mix");
+        }
+
+        requests.push_back(CatalogRequest{type, query});
+    }
+
+    return requests;
+}
+
+struct Measurement {
+    double latency_ms;
+    bool success;
+};
+
+auto percentile(const std::vector<double> &sorted_values, double p) -> double {
+    if (sorted_values.empty()) {
+        return 0;
+    }
+    const auto index = static_cast<size_t>(p * (sorted_values.size() - 1) + 0.5);
+    return sorted_values[std::min(index, sorted_values.size() - 1)];
+}
+
+void report(const std::vector<CatalogRequest> &requests, const std::vector<Measurement> &measurements, double seconds) {
+    std::map<std::string, std::vector<size_t>> indices_by_type;
+    for (size_t i = 0; i < requests.size(); ++i) {
+        indices_by_type[requests[i].type].push_back(i);
+        indices_by_type["total"].push_back(i);
+    }
+
+    std::cout << std::endl
+              << "requests: " << requests.size() << ", duration: " << std::fixed << std::setprecision(2) << seconds << "s"
+              << ", throughput: " << requests.size() / seconds << " req/s" << std::endl << std::endl;
+
+    std::cout << std::left << std::setw(20) << "request" << std::right
+              << std::setw(8) << "count" << std::setw(9) << "errors" << std::setw(9) << "err %"
+              << std::setw(10) << "p50 ms" << std::setw(10) << "p90 ms" << std::setw(10) << "p99 ms" << std::setw(10) << "max ms"
+              << std::endl;
+
+    for (const auto &entry : indices_by_type) {
+        std::vector<double> latencies;
+        size_t errors = 0;
+        for (const auto i : entry.second) {
+            latencies.push_back(measurements[i].latency_ms);
+            errors += measurements[i].success ? 0 : 1;
+        }
+        std::sort(latencies.begin(), latencies.end());
+
+        std::cout << std::left << std::setw(20) << entry.first << std::right
+                  << std::setw(8) << entry.second.size() << std::setw(9) << errors
+                  << std::setw(9) << 100. * errors / entry.second.size()
+                  << std::setw(10) << percentile(latencies, .5) << std::setw(10) << percentile(latencies, .9)
+                  << std::setw(10) << percentile(latencies, .99) << std::setw(10) << latencies.back()
+                  << std::endl;
+    }
+}
+
+int main(int argc, char *argv[]) {
+    try {
+        const auto options = parse_options(argc, argv);
+
+        curl_global_init(CURL_GLOBAL_ALL);
+
+        std::vector<CatalogRequest> requests;
+        {
+            CatalogClient client(options);
+            requests = options.workload.empty() ? synthesize_workload(options, client) : read_workload(options.workload, options.requests);
+        }
+
+        std::vector<Measurement> measurements(requests.size());
+        std::atomic<size_t> next_request(0);
+
+        const auto start = std::chrono::steady_clock::now();
+
+        std::vector<std::thread> threads;
+        for (size_t t = 0; t < options.concurrency; ++t) {
+            threads.emplace_back([&]() {
+                CatalogClient client(options);
+                for (auto i = next_request++; i < requests.size(); i = next_request++) {
+                    const auto request_start = std::chrono::steady_clock::now();
+                    const auto response = client.perform(requests[i].query);
+                    const auto request_end = std::chrono::steady_clock::now();
+
+                    measurements[i] = Measurement{
+                            std::chrono::duration<double, std::milli>(request_end - request_start).count(),
+                            response.success,
+                    };
+                }
+            });
+        }
+        for (auto &thread : threads) {
+            thread.join();
+        }
+
+        const auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        report(requests, measurements, seconds);
+
+        curl_global_cleanup();
+    } catch (const std::exception &e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+}
@@ -0,0 +1,200 @@
+/// Local stand-in for the GEO BON portal API (`ebv.webservice_endpoint`).
+///
+/// Serves canned JSON from a data directory:
+///  * `<prefix>ebv` returns `ebv.json`
+///  * `<prefix>datasets/ebvName/<name>` returns the entries of `datasets.json` with that `ebvName`
+///  * `<prefix>datasets/id/<id>` returns the entry of `datasets.json` with that `id`
+///
+/// Usage: mapping_ebv_mock_portal [--port=8042] [--data=<dir>] [--prefix=/api/v1/] [--latency=<ms>]
+
+#include <boost/asio.hpp>
+#include <json/json.h>
+
+#include <cctype>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <thread>
+
+using boost::asio::ip::tcp;
+
+struct MockPortalOptions {
+    unsigned short port = 8042;
+    std::string data_directory = "test/data/portal";
+    std::string prefix = "/api/v1/";
+    int latency_ms = 0;
+};
+
+auto parse_options(int argc, char *argv[]) -> MockPortalOptions {
+    MockPortalOptions options;
+
+    for (int i = 1; i < argc; ++i) {
+        const std::string argument(argv[i]);
+        const auto separator = argument.find('=');
+        const auto key = argument.substr(0, separator);
+        const auto value = separator == std::string::npos ? "" : argument.substr(separator + 1);
+
+        if (key == "--port") {
+            options.port = static_cast<unsigned short>(std::stoi(value));
+        } else if (key == "--data") {
+            options.data_directory = value;
+        } else if (key == "--prefix") {
+            options.prefix = value;
+        } else if (key == "--latency") {
+            options.latency_ms = std::stoi(value);
+        } else {
+            throw std::invalid_argument("Unknown argument `" + argument + "`");
+        }
+    }
+
+    return options;
+}
+
+auto read_json_file(const std::string &path) -> Json::Value {
+    std::ifstream file(path);
+    if (!file) {
+        throw std::runtime_error("Unable to open `" + path + "`");
+    }
+
+    Json::Value json;
+    file >> json;
+    return json;
+}
+
+auto url_decode(const std::string &input) -> std::string {
+    std::string output;
+    output.reserve(input.size());
+
+    for (size_t i = 0; i < input.size(); ++i) {
+        // a malformed escape is kept as it is, `std::stoi` would throw on it
+        if (input[i] == '%' && i + 3 <= input.size()
+            && std::isxdigit(static_cast<unsigned char>(input[i + 1])) && std::isxdigit(static_cast<unsigned char>(input[i + 2]))) {
+            output += static_cast<char>(std::stoi(input.substr(i + 1, 2), nullptr, 16));
+            i += 2;
+        } else if (input[i] == '+') {
+            output += ' ';
+        } else {
+            output += input[i];
+        }
+    }
+
+    return output;
+}
+
+class MockPortal {
+    public:
+        explicit MockPortal(const MockPortalOptions &options)
+                : options(options),
+                  ebv_classes(read_json_file(options.data_directory + "/ebv.json")),
+                  datasets(read_json_file(options.data_directory + "/datasets.json")) {}
+
+        /// Returns HTTP status and body for a request target
+        auto respond(const std::string &target) const -> std::pair<int, Json::Value> {
+            if (target.compare(0, options.prefix.size(), options.prefix) != 0) {
+                return not_found(target);
+            }
+
+            const auto route = target.substr(options.prefix.size());
+
+            if (route == "ebv") {
+                return {200, ebv_classes};
+            }
+
+            const std::string by_name = "datasets/ebvName/";
+            if (route.compare(0, by_name.size(), by_name) == 0) {
+                return {200, filter_datasets("ebvName", url_decode(route.substr(by_name.size())), false)};
+            }
+
+            const std::string by_id = "datasets/id/";
+            if (route.compare(0, by_id.size(), by_id) == 0) {
+                return {200, filter_datasets("id", url_decode(route.substr(by_id.size())), true)};
+            }
+
+            return not_found(target);
+        }
+
+        void handle(tcp::socket socket) const {
+            try {
+                boost::asio::streambuf request_buffer;
+                boost::asio::read_until(socket, request_buffer, "\r\n\r\n");
+
+                std::istream request_stream(&request_buffer);
+                std::string method, target, version;
+                request_stream >> method >> target >> version;
+
+                if (options.latency_ms > 0) {
+                    std::this_thread::sleep_for(std::chrono::milliseconds(options.latency_ms));
+                }
+
+                const auto response = respond(target);
+                const auto body = Json::FastWriter().write(response.second);
+
+                std::ostringstream message;
+                message << "HTTP/1.1 " << response.first << (response.first == 200 ? " OK" : " Not Found") << "\r\n"
+                        << "Content-Type: application/json\r\n"
+                        << "Content-Length: " << body.size() << "\r\n"
+                        << "Connection: close\r\n\r\n"
+                        << body;
+
+                boost::asio::write(socket, boost::asio::buffer(message.str()));
+            } catch (const std::exception &e) {
+                std::cerr << "mock portal: " << e.what() << std::endl;
+            }
+        }
+
+    private:
+        auto filter_datasets(const std::string &field, const std::string &value, bool single) const -> Json::Value {
+            Json::Value data(Json::arrayValue);
+            for (const auto &dataset : datasets["data"]) {
+                if (dataset.get(field, "").asString() == value) {
+                    if (single) {
+                        data = dataset;
+                        break;
+                    }
+                    data.append(dataset);
+                }
+            }
+
+            Json::Value result(Json::objectValue);
+            result["code"] = 200;
+            result["data"] = data;
+            return result;
+        }
+
+        static auto not_found(const std::string &target) -> std::pair<int, Json::Value> {
+            Json::Value result(Json::objectValue);
+            result["code"] = 404;
+            result["message"] = "Unknown resource " + target;
+            return {404, result};
+        }
+
+        const MockPortalOptions options;
+        const Json::Value ebv_classes;
+        const Json::Value datasets;
+};
+
+int main(int argc, char *argv[]) {
+    try {
+        const auto options = parse_options(argc, argv);
+        const MockPortal portal(options);
+
+        boost::asio::io_service io_service;
+        tcp::acceptor acceptor(io_service, tcp::endpoint(tcp::v4(), options.port));
+
+        std::cout << "mock portal listening on http://localhost:" << options.port << options.prefix << std::endl;
+
+        while (true) {
+            tcp::socket socket(io_service);
+            acceptor.accept(socket);
+            std::thread([&portal](tcp::socket socket) {
+                portal.handle(std::move(socket));
+            }, std::move(socket)).detach();
+        }
+    } catch (const std::exception &e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+}
@@ -0,0 +1,37 @@
+#include <gtest/gtest.h>
+#include <util/ebv_batch.h>
+
+TEST(EbvBatch, Parse) { // NOLINT(cert-err58-cpp)
+    const auto requests = EbvBatch::parse(R"([
+        {"request": "subgroups", "ebv_path": "a.nc"},
+        {"request": "entity_tile", "time_index": 3, "width": 256.5, "flag": true, "empty": null},
+        {"request": "subgroup_values", "ebv_group_path": ["past"]},
+        {"request": "subgroup_values", "ebv_group_path": {"past": 1}},
+        "subgroups",
+        {}
+    ])", 10);
+    ASSERT_EQ(requests.size(), 6);
+
+    EXPECT_TRUE(requests[0].error.empty());
+    EXPECT_EQ(requests[0].parameters, (std::map<std::string, std::string>{{"request", "subgroups"}, {"ebv_path", "a.nc"}}));
+
+    // scalars are converted to strings
+    EXPECT_TRUE(requests[1].error.empty());
+    EXPECT_EQ(requests[1].parameters.at("time_index"), "3");
+    EXPECT_EQ(std::stod(requests[1].parameters.at("width")), 256.5);
+    EXPECT_EQ(requests[1].parameters.at("flag"), "true");
+    EXPECT_EQ(requests[1].parameters.at("empty"), "");
+
+    // malformed requests only fail themselves
+    EXPECT_NE(requests[2].error.find("ebv_group_path"), std::string::npos);
+    EXPECT_NE(requests[3].error.find("ebv_group_path"), std::string::npos);
+    EXPECT_FALSE(requests[4].error.empty());
+    EXPECT_TRUE(requests[5].error.empty());
+    EXPECT_TRUE(requests[5].parameters.empty());
+
+    // the batch as a whole fails if it is no array or too large
+    EXPECT_THROW(EbvBatch::parse(R"({"request": "subgroups"})", 10), EbvBatch::EbvBatchException);
+    EXPECT_THROW(EbvBatch::parse("[", 10), EbvBatch::EbvBatchException);
+    EXPECT_THROW(EbvBatch::parse("[{}, {}]", 1), EbvBatch::EbvBatchException);
+    EXPECT_TRUE(EbvBatch::parse("[]", 0).empty());
+}
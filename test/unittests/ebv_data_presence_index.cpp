@@ -0,0 +1,148 @@
+#include <gtest/gtest.h>
+#include <util/ebv_data_presence_index.h>
+#include <util/ebv_raster_reader.h>
+#include "util.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+
+/// Writes a (2, 4, 4) grid with (1, 2, 2) chunks that only contains data in the upper left block of the first time step
+static void write_sparse_grid(const std::string &path) {
+    H5::H5File file(path, H5F_ACC_TRUNC);
+
+    const hsize_t dimensions[3] = {2, 4, 4};
+    const hsize_t chunk_dimensions[3] = {1, 2, 2};
+    const float fill_value = -9999.f;
+
+    H5::DSetCreatPropList creation_properties;
+    creation_properties.setChunk(3, chunk_dimensions);
+    creation_properties.setFillValue(H5::PredType::NATIVE_FLOAT, &fill_value);
+    creation_properties.setDeflate(4);
+
+    auto dataset = file.createGroup("scenario").createDataSet("entity", H5::PredType::IEEE_F32LE,
+                                                                H5::DataSpace(3, dimensions), creation_properties);
+    dataset.createAttribute("_FillValue", H5::PredType::IEEE_F32LE, H5::DataSpace(H5S_SCALAR))
+            .write(H5::PredType::NATIVE_FLOAT, &fill_value);
+
+    const hsize_t count[3] = {1, 2, 2};
+
+    // data in the upper left block of the first time step
+    const std::vector<float> data{1, 2, fill_value, 4};
+    hsize_t offset[3] = {0, 0, 0};
+    H5::DataSpace file_space = dataset.getSpace();
+    file_space.selectHyperslab(H5S_SELECT_SET, count, offset);
+    dataset.write(data.data(), H5::PredType::NATIVE_FLOAT, H5::DataSpace(3, count), file_space);
+
+    // allocated chunk with fill values only in the lower right block of the second time step
+    const std::vector<float> fill(4, fill_value);
+    offset[0] = 1;
+    offset[1] = 2;
+    offset[2] = 2;
+    file_space.selectHyperslab(H5S_SELECT_SET, count, offset);
+    dataset.write(fill.data(), H5::PredType::NATIVE_FLOAT, H5::DataSpace(3, count), file_space);
+}
+
+TEST(EbvDataPresenceIndex, SparseGrid) { // NOLINT(cert-err58-cpp)
+    const std::string path = std::string(P_tmpdir) + "/mapping_ebv_presence_index_test.nc";
+    write_sparse_grid(path);
+
+    const auto index = EbvDataPresenceIndex::build(path);
+    ASSERT_EQ(index.entity_names(), (std::vector<std::string>{"scenario/entity"}));
+
+    const auto entity_index = index.entity("/scenario/entity");
+    ASSERT_NE(entity_index, nullptr);
+    EXPECT_EQ(entity_index->blocks_y, 2);
+    EXPECT_EQ(entity_index->blocks_x, 2);
+    EXPECT_TRUE(entity_index->has_data(0, 0, 0));
+    EXPECT_FALSE(entity_index->has_data(0, 1, 1));
+    EXPECT_FALSE(entity_index->has_data(1, 1, 1));
+
+    const auto bounding_box = entity_index->bounding_box(0);
+    EXPECT_EQ(bounding_box.width, 1);
+    EXPECT_EQ(bounding_box.height, 1);
+    EXPECT_EQ(entity_index->bounding_box(1).width, 0);
+
+    EXPECT_TRUE(index.has_data("scenario/entity", 0, {1, 1, 2, 2}));
+    EXPECT_FALSE(index.has_data("scenario/entity", 0, {2, 0, 2, 4}));
+    EXPECT_FALSE(index.has_data("scenario/entity", 1, {0, 0, 4, 4}));
+    EXPECT_TRUE(index.has_data("scenario/unknown", 1, {0, 0, 4, 4}));
+
+    // sidecar round trip, used by the raster reader
+    EXPECT_EQ(EbvDataPresenceIndex::from_json(index.to_json()).to_json(), index.to_json());
+    std::remove(EbvDataPresenceIndex::sidecar_path(path).c_str());
+
+    const auto tile_without_index = EbvRasterReader(path).read({"scenario", "entity"}, 1, {0, 0, 4, 4});
+    EXPECT_FALSE(tile_without_index.is_empty);
+    EXPECT_TRUE(std::all_of(tile_without_index.values.cbegin(), tile_without_index.values.cend(), [](float value) {
+        return std::isnan(value);
+    }));
+
+    index.write_sidecar(path);
+
+    const EbvRasterReader reader(path);
+    EXPECT_TRUE(reader.read({"scenario", "entity"}, 1, {0, 0, 4, 4}).is_empty);
+
+    const auto tile = reader.read({"scenario", "entity"}, 0, {0, 0, 2, 2});
+    ASSERT_FALSE(tile.is_empty);
+    EXPECT_EQ(tile.values[0], 1.f);
+    EXPECT_EQ(tile.values[1], 2.f);
+    EXPECT_TRUE(std::isnan(tile.values[2]));
+    EXPECT_EQ(tile.values[3], 4.f);
+
+    EXPECT_THROW(reader.read({"scenario", "entity"}, 2, {0, 0, 1, 1}), EbvRasterReader::EbvRasterReaderException);
+
+    std::remove(EbvDataPresenceIndex::sidecar_path(path).c_str());
+    std::remove(path.c_str());
+}
+
+TEST(EbvDataPresenceIndex, MalformedSidecar) { // NOLINT(cert-err58-cpp)
+    const std::string path = std::string(P_tmpdir) + "/mapping_ebv_presence_index_malformed_test.nc";
+    write_sparse_grid(path);
+
+    const auto json = EbvDataPresenceIndex::build(path).to_json();
+    const auto expect_invalid = [&json](const std::function<void(Json::Value &)> &modify) {
+        auto modified = json;
+        modify(modified);
+        EXPECT_THROW(EbvDataPresenceIndex::from_json(modified), EbvDataPresenceIndex::EbvDataPresenceIndexException);
+    };
+
+    expect_invalid([](Json::Value &modified) { modified["version"] = 1; });
+    expect_invalid([](Json::Value &modified) { modified["entities"]["scenario/entity"]["block_width"] = 0; });
+    expect_invalid([](Json::Value &modified) { modified["entities"]["scenario/entity"]["blocks_y"] = 3; });
+    expect_invalid([](Json::Value &modified) { modified["entities"]["scenario/entity"]["height"] = "4"; });
+    expect_invalid([](Json::Value &modified) { modified["entities"]["scenario/entity"]["time_steps"][0] = "zz"; });
+    expect_invalid([](Json::Value &modified) { modified["entities"]["scenario/entity"]["time_steps"][0] = ""; });
+
+    // a sidecar of another version is ignored, reads still work
+    auto outdated = json;
+    outdated["version"] = 1;
+    {
+        std::ofstream sidecar(EbvDataPresenceIndex::sidecar_path(path));
+        sidecar << Json::FastWriter().write(outdated);
+    }
+
+    std::string error;
+    EXPECT_EQ(EbvDataPresenceIndex::load(path, &error), nullptr);
+    EXPECT_NE(error.find("version"), std::string::npos);
+
+    const auto tile = EbvRasterReader(path).read({"scenario", "entity"}, 0, {0, 0, 2, 2});
+    ASSERT_FALSE(tile.is_empty);
+    EXPECT_EQ(tile.values[0], 1.f);
+
+    std::remove(EbvDataPresenceIndex::sidecar_path(path).c_str());
+    std::remove(path.c_str());
+}
+
+TEST(EbvDataPresenceIndex, cSAR) { // NOLINT(cert-err58-cpp)
+    const auto index = EbvDataPresenceIndex::build(test_util::get_data_dir() + "48/netcdf/cSAR_idiv_v1.nc");
+
+    EXPECT_EQ(index.entity_names(), (std::vector<std::string>{"past/mean/0", "past/mean/A", "past/mean/F"}));
+
+    const auto entity_index = index.entity("past/mean/A");
+    ASSERT_NE(entity_index, nullptr);
+    EXPECT_EQ(entity_index->time_steps.size(), 12);
+    EXPECT_TRUE(index.has_data("past/mean/A", 0, {0, 0, 360, 180}));
+}
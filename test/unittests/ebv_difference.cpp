@@ -0,0 +1,99 @@
+#include <gtest/gtest.h>
+#include <util/ebv_difference.h>
+#include "util.h"
+
+#include <cmath>
+
+TEST(EbvDifference, Kernel) { // NOLINT(cert-err58-cpp)
+    const std::vector<float> first{4, 1, 0, NAN, 3, INFINITY};
+    const std::vector<float> second{2, 4, 0, 1, 0, 1};
+    std::vector<float> result(first.size());
+
+    const auto expect_values = [&result](const std::vector<float> &expected) {
+        for (size_t i = 0; i < expected.size(); ++i) {
+            if (std::isnan(expected[i])) {
+                EXPECT_TRUE(std::isnan(result[i])) << "at " << i;
+            } else {
+                EXPECT_FLOAT_EQ(result[i], expected[i]) << "at " << i;
+            }
+        }
+    };
+
+    EbvDifference::apply(EbvDifference::Operation::Difference, first.data(), second.data(), result.data(), first.size());
+    expect_values({2, -3, 0, NAN, 3, NAN});
+
+    EbvDifference::apply(EbvDifference::Operation::Ratio, first.data(), second.data(), result.data(), first.size());
+    expect_values({2, 0.25, NAN, NAN, NAN, NAN});
+
+    EbvDifference::apply(EbvDifference::Operation::PercentChange, first.data(), second.data(), result.data(), first.size());
+    expect_values({100, -75, NAN, NAN, NAN, NAN});
+
+    EXPECT_EQ(EbvDifference::parse_operation("percent_change"), EbvDifference::Operation::PercentChange);
+    EXPECT_THROW(EbvDifference::parse_operation("sum"), EbvDifference::EbvDifferenceException);
+}
+
+TEST(EbvDifference, Blocks) { // NOLINT(cert-err58-cpp)
+    // blocks follow the chunk grid, not the window
+    const auto blocks = EbvDifference::blocks({.x_offset = 5, .y_offset = 0, .width = 20, .height = 12}, 10, 10);
+    ASSERT_EQ(blocks.size(), 6);
+    EXPECT_EQ(blocks[0].x_offset, 5);
+    EXPECT_EQ(blocks[0].width, 5);
+    EXPECT_EQ(blocks[1].x_offset, 10);
+    EXPECT_EQ(blocks[1].width, 10);
+    EXPECT_EQ(blocks[2].x_offset, 20);
+    EXPECT_EQ(blocks[2].width, 5);
+    EXPECT_EQ(blocks[3].y_offset, 10);
+    EXPECT_EQ(blocks[3].height, 2);
+
+    EXPECT_EQ(EbvDifference::block_size(180, 256), 360);
+    EXPECT_EQ(EbvDifference::block_size(1, 256), 256);
+    EXPECT_EQ(EbvDifference::block_size(512, 256), 512);
+}
+
+TEST(EbvDifference, cSAR) { // NOLINT(cert-err58-cpp)
+    const EbvRasterReader reader(test_util::get_data_dir() + "48/netcdf/cSAR_idiv_v1.nc");
+    const std::vector<std::string> first_entity{"past", "mean", "0"};
+    const std::vector<std::string> second_entity{"past", "mean", "A"};
+
+    const auto size = reader.grid_size(first_entity);
+    const auto chunk_size = reader.chunk_size(first_entity);
+    EXPECT_EQ(chunk_size.height, 180);
+    EXPECT_EQ(chunk_size.width, 360);
+
+    const auto read = [&reader](const std::vector<std::string> &entity, size_t time_index) -> EbvDifference::Read {
+        return [&reader, entity, time_index](const EbvRasterReader::Window &window) {
+            return reader.read(entity, time_index, window);
+        };
+    };
+
+    const EbvRasterReader::Window window{.x_offset = 0, .y_offset = 0, .width = size.width, .height = size.height};
+    const auto expected_first = reader.read(first_entity, 3, window);
+    const auto expected_second = reader.read(second_entity, 1, window);
+
+    size_t compared = 0;
+    const auto summary = EbvDifference::stream(
+            window, 64, 100, EbvDifference::Operation::Difference, read(first_entity, 3), read(second_entity, 1),
+            [&](const EbvRasterReader::Tile &block) {
+                ASSERT_LE(block.window.height, 64);
+                ASSERT_LE(block.window.width, 100);
+                if (block.is_empty) {
+                    return;
+                }
+                for (size_t row = 0; row < block.window.height; ++row) {
+                    for (size_t column = 0; column < block.window.width; ++column) {
+                        const size_t i = (block.window.y_offset + row) * size.width + block.window.x_offset + column;
+                        const float expected = expected_first.values[i] - expected_second.values[i];
+                        const float value = block.values[row * block.window.width + column];
+                        if (std::isnan(expected)) {
+                            EXPECT_TRUE(std::isnan(value));
+                        } else {
+                            EXPECT_FLOAT_EQ(value, expected);
+                            ++compared;
+                        }
+                    }
+                }
+            });
+
+    EXPECT_EQ(summary.blocks, 3 * 4);
+    EXPECT_GT(compared, 0);
+}
@@ -0,0 +1,122 @@
+#include <gtest/gtest.h>
+#include <util/ebv_metadata_cache.h>
+#include "util.h"
+
+#include <algorithm>
+
+TEST(EbvMetadataCache, cSAR) { // NOLINT(cert-err58-cpp)
+    const std::string path = test_util::get_data_dir() + "48/netcdf/cSAR_idiv_v1.nc";
+    NetCdfParser parser(path);
+
+    auto &cache = EbvMetadataCache::instance();
+    cache.clear();
+
+    const auto metadata = cache.get(path);
+
+    EXPECT_EQ(metadata->subgroups(), parser.ebv_subgroups());
+    EXPECT_EQ(metadata->subgroup_descriptions(), parser.ebv_subgroup_descriptions());
+    EXPECT_EQ(metadata->nodes.size(), 1 + 1 + 1 + 3); // root, scenario, metric and entities
+
+    EXPECT_EQ(cache.subgroup_values(path, "scenario", {}), parser.ebv_subgroup_values("scenario", {}));
+    EXPECT_EQ(cache.subgroup_values(path, "metric", {"past"}), parser.ebv_subgroup_values("metric", {"past"}));
+    EXPECT_EQ(cache.subgroup_values(path, "entity", {"past", "mean"}), parser.ebv_subgroup_values("entity", {"past", "mean"}));
+
+    EXPECT_EQ(cache.time_info(path), parser.time_info());
+    EXPECT_EQ(cache.crs_as_code(path), parser.crs_as_code());
+
+    EXPECT_EQ(std::count_if(metadata->nodes.begin(), metadata->nodes.end(),
+                            [](const EbvMetadataCache::FileMetadata::Node &node) { return node.has_unit_range; }), 3);
+    EXPECT_EQ(cache.unit_range(path, {"past", "mean", "A"}), parser.unit_range({"past", "mean", "A"}));
+
+    EXPECT_EQ(cache.get(path), metadata); // served from cache
+}
+
+TEST(EbvMetadataCache, Compact) { // NOLINT(cert-err58-cpp)
+    const std::string path = test_util::get_data_dir() + "48/netcdf/cSAR_idiv_v1.nc";
+    NetCdfParser parser(path);
+
+    const auto metadata = EbvMetadataCache::parse(path);
+
+    // the three entities share one description, which is stored once
+    const auto entities = parser.ebv_subgroup_values("entity", {"past", "mean"});
+    size_t characters = 0;
+    for (const auto &entity : entities) {
+        characters += entity.name.size() + entity.label.size() + entity.description.size();
+    }
+    EXPECT_LT(metadata->strings.memory_usage(), characters);
+
+    std::vector<NetCdfParser::NetCdfValue> values;
+    EXPECT_TRUE(metadata->subgroup_values("entity", {"past", "mean"}, values));
+    EXPECT_EQ(values, entities);
+    EXPECT_FALSE(metadata->subgroup_values("metric", {"past", "mean"}, values)); // not the subgroup of this level
+    EXPECT_FALSE(metadata->subgroup_values("entity", {"past", "median"}, values));
+
+    std::vector<std::string> names;
+    EXPECT_TRUE(metadata->child_names({"past", "mean"}, names));
+    ASSERT_EQ(names.size(), entities.size());
+    EXPECT_EQ(names.front(), entities.front().name);
+    EXPECT_FALSE(metadata->child_names({"past", "median"}, names));
+
+    // decades in days, which differ by leap days
+    EXPECT_FALSE(metadata->time_points.is_regular);
+    EXPECT_EQ(metadata->time_info(), parser.time_info());
+
+    const auto regular = EbvMetadataCache::FileMetadata::Axis::compress({1990, 2000, 2010, 2020});
+    EXPECT_TRUE(regular.is_regular);
+    EXPECT_TRUE(regular.values.empty());
+    EXPECT_EQ(regular.expand(), (std::vector<double>{1990, 2000, 2010, 2020}));
+    EXPECT_EQ(EbvMetadataCache::FileMetadata::Axis::from_json(regular.to_json()).expand(), regular.expand());
+
+    const auto irregular = EbvMetadataCache::FileMetadata::Axis::compress({0, 1, 3});
+    EXPECT_FALSE(irregular.is_regular);
+    EXPECT_EQ(irregular.expand(), (std::vector<double>{0, 1, 3}));
+
+    const auto round_trip = EbvMetadataCache::FileMetadata::from_json(metadata->to_json());
+    EXPECT_EQ(round_trip.to_json(), metadata->to_json());
+    EXPECT_EQ(round_trip.time_info(), parser.time_info());
+
+    EXPECT_GT(metadata->memory_usage(), metadata->strings.memory_usage());
+
+    auto &cache = EbvMetadataCache::instance();
+    cache.clear();
+    cache.get(path);
+    const auto usage = cache.memory_usage();
+    ASSERT_EQ(usage.size(), 1);
+    EXPECT_EQ(usage.at(path), cache.get(path)->memory_usage());
+}
+
+TEST(StringArena, Intern) { // NOLINT(cert-err58-cpp)
+    StringArena arena;
+    const auto a = arena.intern("changes in species richness");
+    const auto b = arena.intern("");
+    EXPECT_EQ(arena.intern("changes in species richness"), a);
+    EXPECT_NE(a, b);
+    EXPECT_EQ(arena.size(), 2);
+
+    arena.shrink();
+    EXPECT_EQ(arena.get(a), "changes in species richness");
+    EXPECT_EQ(arena.get(b), "");
+    EXPECT_TRUE(arena.view(a) == "changes in species richness");
+    EXPECT_FALSE(arena.view(a) == "changes in species");
+    EXPECT_TRUE(arena.view(b) == "");
+    EXPECT_THROW(arena.view(2), std::out_of_range);
+    EXPECT_EQ(arena.intern(""), b); // the lookup is rebuilt after `shrink`
+    EXPECT_EQ(arena.intern("other"), 2);
+    EXPECT_THROW(arena.get(3), std::out_of_range);
+}
+
+TEST(EbvMetadataCache, WarmUp) { // NOLINT(cert-err58-cpp)
+    auto &cache = EbvMetadataCache::instance();
+    cache.clear();
+
+    const auto files = EbvMetadataCache::list_netcdf_files(test_util::get_data_dir());
+    ASSERT_EQ(files.size(), 2);
+
+    const auto summary = cache.warm_up(test_util::get_data_dir(), 2);
+
+    EXPECT_EQ(summary.files, 2);
+    EXPECT_EQ(summary.loaded, 1);
+    EXPECT_EQ(summary.failed, 1); // `test.nc` is no EBV file
+    EXPECT_NE(summary.largest_file.find("cSAR_idiv_v1.nc"), std::string::npos);
+    EXPECT_EQ(summary.largest_file_bytes, summary.memory_bytes);
+}
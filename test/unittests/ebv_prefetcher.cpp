@@ -0,0 +1,210 @@
+#include <gtest/gtest.h>
+#include <util/ebv_prefetcher.h>
+#include "util.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <thread>
+
+namespace {
+    auto tile_key(const std::vector<std::string> &entity_path, size_t time_index) -> EbvPrefetcher::TileKey {
+        return EbvPrefetcher::TileKey{
+                test_util::get_data_dir() + "48/netcdf/cSAR_idiv_v1.nc", entity_path, time_index, 0, 0, -1, -1
+        };
+    }
+
+    auto tile_of(const EbvPrefetcher::TileKey &key) -> EbvRasterReader::Tile {
+        EbvRasterReader::Tile tile;
+        tile.window = EbvRasterReader::Window{.x_offset = 0, .y_offset = 0, .width = 2, .height = 1};
+        tile.is_empty = false;
+        tile.values = {static_cast<float>(key.time_index), static_cast<float>(key.entity_path.size())};
+        tile.no_data = 0;
+        return tile;
+    }
+
+    /// Waits until the prefetcher read `count` tiles or gives up after a few seconds
+    auto wait_for_prefetched(const EbvPrefetcher &prefetcher, size_t count) -> bool {
+        for (int i = 0; i < 500; ++i) {
+            if (prefetcher.statistics().prefetched >= count) {
+                return true;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        return false;
+    }
+}
+
+TEST(EbvPrefetcher, Predict) { // NOLINT(cert-err58-cpp)
+    const std::vector<std::vector<std::string>> siblings{{"past", "mean", "0"},
+                                                         {"past", "mean", "A"},
+                                                         {"past", "mean", "B"}};
+    const auto current = tile_key({"past", "mean", "A"}, 5);
+
+    // a first access predicts both time neighbours, then the siblings
+    auto predictions = EbvPrefetcher::predict(nullptr, current, 12, siblings, 2);
+    ASSERT_EQ(predictions.size(), 2 + 2);
+    EXPECT_EQ(predictions[0].time_index, 6);
+    EXPECT_EQ(predictions[1].time_index, 4);
+    EXPECT_EQ(predictions[2].entity_path, siblings[2]);
+    EXPECT_EQ(predictions[2].time_index, 5);
+    EXPECT_EQ(predictions[3].entity_path, siblings[0]);
+
+    // stepping backwards continues backwards
+    const auto later = tile_key({"past", "mean", "A"}, 6);
+    predictions = EbvPrefetcher::predict(&later, current, 12, siblings, 2);
+    ASSERT_GE(predictions.size(), 3);
+    EXPECT_EQ(predictions[0].time_index, 4);
+    EXPECT_EQ(predictions[1].time_index, 3);
+    EXPECT_EQ(predictions[2].time_index, 6);
+
+    // switching entities predicts the siblings first
+    const auto sibling = tile_key({"past", "mean", "0"}, 5);
+    predictions = EbvPrefetcher::predict(&sibling, current, 12, siblings, 2);
+    ASSERT_EQ(predictions.size(), 2 + 2);
+    EXPECT_EQ(predictions[0].entity_path, siblings[2]);
+    EXPECT_EQ(predictions[2].time_index, 6);
+
+    // the time axis bounds the predictions
+    predictions = EbvPrefetcher::predict(nullptr, tile_key({"past", "mean", "A"}, 0), 1, {}, 2);
+    EXPECT_TRUE(predictions.empty());
+}
+
+TEST(EbvPrefetcher, Prefetch) { // NOLINT(cert-err58-cpp)
+    EbvPrefetcher prefetcher;
+
+    std::atomic<size_t> reads(0);
+    prefetcher.start(1, 1 << 20, 1, [&reads](const EbvPrefetcher::TileKey &key) {
+        ++reads;
+        return tile_of(key);
+    });
+    ASSERT_TRUE(prefetcher.is_running());
+
+    prefetcher.record("session", tile_key({"past", "mean", "A"}, 5), 12, {});
+    ASSERT_TRUE(wait_for_prefetched(prefetcher, 2));
+
+    EbvRasterReader::Tile tile;
+    ASSERT_TRUE(prefetcher.get(tile_key({"past", "mean", "A"}, 6), tile));
+    EXPECT_FLOAT_EQ(tile.values[0], 6);
+    ASSERT_TRUE(prefetcher.get(tile_key({"past", "mean", "A"}, 4), tile));
+    EXPECT_FALSE(prefetcher.get(tile_key({"past", "mean", "A"}, 7), tile));
+
+    // cached tiles are not read again, also not for other sessions
+    prefetcher.record("other session", tile_key({"past", "mean", "A"}, 5), 12, {});
+    prefetcher.record("other session", tile_key({"past", "mean", "A"}, 7), 12, {});
+    ASSERT_TRUE(wait_for_prefetched(prefetcher, 3));
+    EXPECT_EQ(reads, 3);
+    ASSERT_TRUE(prefetcher.get(tile_key({"past", "mean", "A"}, 8), tile));
+
+    const auto statistics = prefetcher.statistics();
+    EXPECT_EQ(statistics.hits, 3);
+    EXPECT_EQ(statistics.misses, 1);
+    EXPECT_GT(statistics.bytes, 0);
+
+    prefetcher.stop();
+    EXPECT_FALSE(prefetcher.is_running());
+}
+
+TEST(EbvPrefetcher, CancelAndBudget) { // NOLINT(cert-err58-cpp)
+    size_t tile_bytes;
+    {
+        EbvPrefetcher probe;
+        probe.start(1, 1 << 20, 1, &tile_of);
+        const auto key = tile_key({"past", "mean", "A"}, 6);
+        probe.put(key, tile_of(key), FileStatus::of(key.file));
+        tile_bytes = probe.statistics().bytes;
+    }
+
+    EbvPrefetcher prefetcher;
+
+    // blocks the only thread until the test moves on
+    std::atomic<bool> is_blocked(true);
+    const auto tile_bytes_budget = 2 * tile_bytes + tile_bytes / 2;
+    prefetcher.start(1, tile_bytes_budget, 1, [&is_blocked](const EbvPrefetcher::TileKey &key) {
+        while (is_blocked) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        return tile_of(key);
+    });
+
+    prefetcher.record("session", tile_key({"past", "mean", "A"}, 5), 12, {});
+    std::this_thread::sleep_for(std::chrono::milliseconds(50)); // the thread takes the first prediction
+
+    // the session moved elsewhere, so the queued prediction of the previous access is dropped
+    prefetcher.record("session", tile_key({"past", "mean", "B"}, 10), 12, {});
+    EXPECT_GE(prefetcher.statistics().cancelled, 1);
+
+    is_blocked = false;
+    ASSERT_TRUE(wait_for_prefetched(prefetcher, 3));
+    prefetcher.stop();
+
+    EbvRasterReader::Tile tile;
+    EXPECT_FALSE(prefetcher.get(tile_key({"past", "mean", "A"}, 4), tile));
+    EXPECT_TRUE(prefetcher.get(tile_key({"past", "mean", "B"}, 11), tile));
+    EXPECT_TRUE(prefetcher.get(tile_key({"past", "mean", "B"}, 9), tile));
+
+    // the oldest tile was evicted to stay within the budget
+    EXPECT_LE(prefetcher.statistics().bytes, tile_bytes_budget);
+    EXPECT_FALSE(prefetcher.get(tile_key({"past", "mean", "A"}, 6), tile));
+}
+
+TEST(EbvPrefetcher, StaleTilesAndFailedReads) { // NOLINT(cert-err58-cpp)
+    const std::string path = std::string(P_tmpdir) + "/mapping_ebv_prefetcher_test.nc";
+    std::ofstream(path) << "version 1";
+
+    EbvPrefetcher prefetcher;
+    prefetcher.start(1, 1 << 20, 1, [&path](const EbvPrefetcher::TileKey &key) -> EbvRasterReader::Tile {
+        if (key.time_index == 6) {
+            throw 42; // neither a `std::exception` nor a `H5::Exception`
+        }
+        std::ofstream(path, std::ios::app) << ", modified while it is read";
+        return tile_of(key);
+    });
+
+    auto key = tile_key({"past", "mean", "A"}, 5);
+    key.file = path;
+    prefetcher.record("session", key, 12, {});
+    ASSERT_TRUE(wait_for_prefetched(prefetcher, 1));
+
+    // the file changed during the read of time step 4, so its tile is outdated; time step 6 failed
+    EbvRasterReader::Tile tile;
+    auto predicted = key;
+    predicted.time_index = 4;
+    EXPECT_FALSE(prefetcher.get(predicted, tile));
+    predicted.time_index = 6;
+    EXPECT_FALSE(prefetcher.get(predicted, tile));
+
+    // the thread survived the failed read
+    predicted.time_index = 9;
+    prefetcher.put(predicted, tile_of(predicted), FileStatus::of(path));
+    EXPECT_TRUE(prefetcher.get(predicted, tile));
+    prefetcher.record("session", predicted, 12, {});
+    ASSERT_TRUE(wait_for_prefetched(prefetcher, 2));
+
+    prefetcher.stop();
+    std::remove(path.c_str());
+}
+
+TEST(EbvPrefetcher, SessionsAreEvictedLeastRecentlyActiveFirst) { // NOLINT(cert-err58-cpp)
+    EbvPrefetcher prefetcher;
+    prefetcher.start(1, 1 << 20, 2, [](const EbvPrefetcher::TileKey &key) { return tile_of(key); });
+
+    // reads time steps 6 and 4
+    prefetcher.record("a", tile_key({"past", "mean", "A"}, 5), 12, {});
+    ASSERT_TRUE(wait_for_prefetched(prefetcher, 2));
+
+    // other sessions on a single time step predict nothing, "a" stays active in between
+    for (size_t i = 0; i < EbvPrefetcher::max_sessions - 1; ++i) {
+        prefetcher.record("s" + std::to_string(i), tile_key({"past", "mean", "A"}, 0), 1, {});
+    }
+    prefetcher.record("a", tile_key({"past", "mean", "A"}, 5), 12, {});
+    prefetcher.record("new", tile_key({"past", "mean", "A"}, 0), 1, {});
+
+    // "a" is still known to step backwards, so time steps 3 and 2 are read next
+    prefetcher.record("a", tile_key({"past", "mean", "A"}, 4), 12, {});
+    ASSERT_TRUE(wait_for_prefetched(prefetcher, 4));
+
+    EbvRasterReader::Tile tile;
+    EXPECT_TRUE(prefetcher.get(tile_key({"past", "mean", "A"}, 2), tile));
+}
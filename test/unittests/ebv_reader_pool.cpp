@@ -0,0 +1,167 @@
+#include <gtest/gtest.h>
+#include <util/ebv_metadata_cache.h>
+#include <util/ebv_reader_pool.h>
+#include "util.h"
+
+#include <chrono>
+#include <csignal>
+#include <thread>
+#include <unistd.h>
+
+/// Answers with the process id of the worker and the payload in reverse order
+static auto echo(const EbvReaderPool::Message &request) -> EbvReaderPool::Message {
+    if (request.header["request"].asString() == "fail") {
+        throw std::runtime_error("failed on purpose");
+    }
+    if (request.header["request"].asString() == "hang") {
+        std::this_thread::sleep_for(std::chrono::seconds(10));
+    }
+
+    EbvReaderPool::Message response;
+    response.header["pid"] = getpid();
+    response.header["parent"] = getppid();
+    response.header["file"] = request.header["file"];
+    response.payload.assign(request.payload.rbegin(), request.payload.rend());
+    return response;
+}
+
+TEST(EbvReaderPool, Routing) { // NOLINT(cert-err58-cpp)
+    EbvReaderPool pool;
+    pool.start(3, echo);
+    ASSERT_TRUE(pool.is_running());
+    ASSERT_EQ(pool.size(), 3);
+
+    const auto call = [&pool](const std::string &file, std::vector<uint8_t> payload) -> EbvReaderPool::Message {
+        EbvReaderPool::Message request;
+        request.header["request"] = "echo";
+        request.header["file"] = file;
+        request.payload = std::move(payload);
+        return pool.call(file, request);
+    };
+
+    std::vector<uint8_t> payload(8u << 20u); // larger than a socket buffer
+    for (size_t i = 0; i < payload.size(); ++i) {
+        payload[i] = static_cast<uint8_t>(i % 251);
+    }
+
+    const auto response = call("a.nc", payload);
+    EXPECT_EQ(response.header["file"].asString(), "a.nc");
+    EXPECT_EQ(response.payload, std::vector<uint8_t>(payload.rbegin(), payload.rend()));
+
+    // the same file always goes to the same worker
+    const auto pid = response.header["pid"].asInt();
+    EXPECT_NE(pid, getpid());
+    EXPECT_NE(response.header["parent"].asInt(), getpid()); // forked by the fork server
+    EXPECT_EQ(pid, pool.worker_pid(pool.worker_index("a.nc")));
+    EXPECT_EQ(call("a.nc", {}).header["pid"].asInt(), pid);
+
+    std::vector<std::thread> threads;
+    std::vector<bool> results(8, false);
+    for (size_t t = 0; t < results.size(); ++t) {
+        threads.emplace_back([&, t]() {
+            const auto file = "file" + std::to_string(t) + ".nc";
+            const auto thread_response = call(file, {static_cast<uint8_t>(t), 1});
+            results[t] = thread_response.header["pid"].asInt() == pool.worker_pid(pool.worker_index(file))
+                         && thread_response.payload == std::vector<uint8_t>{1, static_cast<uint8_t>(t)};
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    EXPECT_EQ(results, std::vector<bool>(results.size(), true));
+
+    EbvReaderPool::Message failing_request;
+    failing_request.header["request"] = "fail";
+    EXPECT_THROW(pool.call("a.nc", failing_request), EbvReaderPool::EbvReaderPoolException);
+    EXPECT_EQ(call("a.nc", {}).header["pid"].asInt(), pid); // the worker survives errors
+
+    // a dead worker fails its request and is forked again
+    kill(pid, SIGKILL);
+    EXPECT_THROW(call("a.nc", {}), EbvReaderPool::WorkerUnavailableException);
+    EXPECT_EQ(kill(pid, 0), -1); // reaped
+    const auto new_pid = call("a.nc", {}).header["pid"].asInt();
+    EXPECT_NE(new_pid, pid);
+    EXPECT_EQ(new_pid, pool.worker_pid(pool.worker_index("a.nc")));
+    EXPECT_EQ(pool.size(), 3);
+
+    pool.stop();
+    EXPECT_FALSE(pool.is_running());
+    EXPECT_THROW(call("a.nc", {}), EbvReaderPool::WorkerUnavailableException);
+}
+
+TEST(EbvReaderPool, Timeout) { // NOLINT(cert-err58-cpp)
+    EbvReaderPool pool;
+    pool.start(1, echo, std::chrono::milliseconds(200));
+
+    EbvReaderPool::Message request;
+    request.header["request"] = "echo";
+    const auto pid = pool.call("a.nc", request).header["pid"].asInt();
+
+    const auto start = std::chrono::steady_clock::now();
+    request.header["request"] = "hang";
+    EXPECT_THROW(pool.call("a.nc", request), EbvReaderPool::WorkerUnavailableException);
+    EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(5));
+
+    // a busy worker is not waited for by `try_call`
+    std::thread hanging_call([&pool, request]() {
+        EXPECT_THROW(pool.call("a.nc", request), EbvReaderPool::WorkerUnavailableException);
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    EbvReaderPool::Message response;
+    request.header["request"] = "echo";
+    EXPECT_FALSE(pool.try_call("a.nc", request, response));
+    hanging_call.join();
+
+    // the hung workers were killed and replaced
+    EXPECT_EQ(kill(pid, 0), -1);
+    request.header["request"] = "echo";
+    EXPECT_NE(pool.call("a.nc", request).header["pid"].asInt(), pid);
+    ASSERT_TRUE(pool.try_call("a.nc", request, response));
+    EXPECT_NE(response.header["pid"].asInt(), pid);
+
+    pool.stop();
+}
+
+TEST(EbvReaderPool, StopEndsHungWorkers) { // NOLINT(cert-err58-cpp)
+    EbvReaderPool pool;
+    pool.start(1, echo, std::chrono::milliseconds(0));
+
+    EbvReaderPool::Message request;
+    request.header["request"] = "echo";
+    const auto pid = pool.call("a.nc", request).header["pid"].asInt();
+
+    request.header["request"] = "hang";
+    std::thread hanging_call([&pool, request]() {
+        EXPECT_THROW(pool.call("a.nc", request), EbvReaderPool::WorkerUnavailableException);
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+    const auto start = std::chrono::steady_clock::now();
+    pool.stop();
+    hanging_call.join();
+    EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(5));
+    EXPECT_EQ(kill(pid, 0), -1);
+}
+
+TEST(EbvReaderPool, Metadata) { // NOLINT(cert-err58-cpp)
+    const std::string path = test_util::get_data_dir() + "48/netcdf/cSAR_idiv_v1.nc";
+    const auto parsed = EbvMetadataCache::parse(path);
+
+    const auto round_trip = EbvMetadataCache::FileMetadata::from_json(parsed->to_json());
+    EXPECT_EQ(round_trip.to_json(), parsed->to_json());
+
+    auto &pool = EbvReaderPool::instance();
+    pool.start(2, [](const EbvReaderPool::Message &request) -> EbvReaderPool::Message {
+        EbvReaderPool::Message response;
+        response.header = EbvMetadataCache::parse(request.header["path"].asString())->to_json();
+        return response;
+    });
+
+    const auto loaded = EbvMetadataCache::load(path);
+    EXPECT_EQ(loaded->subgroups(), parsed->subgroups());
+    EXPECT_EQ(loaded->to_json()["nodes"], parsed->to_json()["nodes"]);
+    EXPECT_EQ(loaded->time_info(), parsed->time_info());
+    EXPECT_EQ(loaded->crs_code, parsed->crs_code);
+
+    pool.stop();
+}
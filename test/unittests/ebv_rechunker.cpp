@@ -0,0 +1,83 @@
+#include <gtest/gtest.h>
+#include <util/ebv_rechunker.h>
+#include <util/hdf5_typed_reader.h>
+#include <util/netcdf_parser.h>
+#include "util.h"
+
+#include <H5DSpublic.h>
+
+#include <cstdio>
+
+TEST(EbvRechunker, Layout) { // NOLINT(cert-err58-cpp)
+    const auto layout = EbvRechunker::Layout::parse("12x32x0/deflate:6/shuffle");
+    EXPECT_EQ(layout.chunk_time, 12);
+    EXPECT_EQ(layout.chunk_height, 32);
+    EXPECT_EQ(layout.chunk_width, 0);
+    EXPECT_EQ(layout.codec, EbvRechunker::Codec::Deflate);
+    EXPECT_EQ(layout.level, 6);
+    EXPECT_TRUE(layout.shuffle);
+    EXPECT_EQ(layout.to_string(), "12x32x0/deflate:6/shuffle");
+
+    EXPECT_EQ(EbvRechunker::Layout::parse("1x180x360/none").to_string(), "1x180x360/none");
+    EXPECT_EQ(EbvRechunker::Layout::parse("1x1x1/zstd").level, 3);
+
+    EXPECT_THROW(EbvRechunker::Layout::parse("12x32"), EbvRechunker::EbvRechunkerException);
+    EXPECT_THROW(EbvRechunker::Layout::parse("1x1x1/brotli"), EbvRechunker::EbvRechunkerException);
+    EXPECT_THROW(EbvRechunker::Layout::parse("1x1x1/deflate:10"), EbvRechunker::EbvRechunkerException);
+}
+
+TEST(EbvRechunker, cSAR) { // NOLINT(cert-err58-cpp)
+    const auto source = test_util::get_data_dir() + "48/netcdf/cSAR_idiv_v1.nc";
+    const std::string target = std::string(P_tmpdir) + "/mapping_ebv_rechunker_test.nc";
+
+    EbvRechunker::Options options;
+    options.layout = EbvRechunker::Layout::parse("12x32x32/deflate:4/shuffle");
+    options.threads = 3;
+    options.memory_limit = 64u << 10u; // a few chunks
+
+    const auto summary = EbvRechunker::rechunk(source, target, options);
+    EXPECT_EQ(summary.entities, 3);
+    EXPECT_EQ(summary.chunks + summary.empty_chunks, 3 * 6 * 12);
+    EXPECT_EQ(summary.raw_bytes, 3 * 12 * 180 * 360 * sizeof(float));
+    // twelve time steps of the source chunks do not fit into the chunk cache of the small memory limit
+    EXPECT_EQ(summary.warnings.size(), 3);
+
+    const NetCdfParser source_parser(source);
+    const NetCdfParser target_parser(target);
+    EXPECT_EQ(target_parser.ebv_class(), source_parser.ebv_class());
+    EXPECT_EQ(target_parser.ebv_subgroups(), source_parser.ebv_subgroups());
+    EXPECT_EQ(target_parser.ebv_subgroup_values("entity", {"past", "mean"}),
+              source_parser.ebv_subgroup_values("entity", {"past", "mean"}));
+    EXPECT_EQ(target_parser.crs_wkt(), source_parser.crs_wkt());
+    EXPECT_EQ(target_parser.time_info().time_points, source_parser.time_info().time_points);
+
+    const H5::H5File source_file(source, H5F_ACC_RDONLY);
+    const H5::H5File target_file(target, H5F_ACC_RDONLY);
+
+    for (const auto &entity : {"past/mean/0", "past/mean/A", "past/mean/F"}) {
+        const auto target_dataset = target_file.openDataSet(entity);
+        EXPECT_EQ(Hdf5TypedReader::read_dataset<float>(target_dataset),
+                  Hdf5TypedReader::read_dataset<float>(source_file.openDataSet(entity)));
+
+        hsize_t chunk[3];
+        target_dataset.getCreatePlist().getChunk(3, chunk);
+        EXPECT_EQ(chunk[0], 12);
+        EXPECT_EQ(chunk[1], 32);
+        EXPECT_EQ(target_dataset.getCreatePlist().getNfilters(), 2);
+
+        for (unsigned int dimension = 0; dimension < 3; ++dimension) {
+            EXPECT_EQ(H5DSget_num_scales(target_dataset.getId(), dimension), 1);
+        }
+    }
+
+    EXPECT_EQ(Hdf5TypedReader::read_dataset<float>(target_file.openDataSet("lat")),
+              Hdf5TypedReader::read_dataset<float>(source_file.openDataSet("lat")));
+
+    const auto benchmark = EbvRechunker::benchmark(target, 16, 5, 42);
+    EXPECT_EQ(benchmark.tile_reads, 5);
+    EXPECT_EQ(benchmark.tile_values, 5 * 16 * 16);
+    EXPECT_EQ(benchmark.time_series_values, 5 * 12);
+
+    std::remove(target.c_str());
+    EXPECT_THROW(EbvRechunker::drop_cached_pages(target), EbvRechunker::EbvRechunkerException);
+}
@@ -0,0 +1,151 @@
+#include <gtest/gtest.h>
+#include <util/crs_cache.h>
+#include <util/ebv_metadata_cache.h>
+#include <util/ebv_reprojector.h>
+#include "util.h"
+
+#include <cmath>
+
+static const double earth_radius = 6378137;
+
+/// Web Mercator to WGS 84 longitude and latitude
+static void web_mercator_to_wgs84(size_t count, double *x, double *y) {
+    for (size_t i = 0; i < count; ++i) {
+        x[i] = x[i] / earth_radius * 180 / M_PI;
+        y[i] = std::atan(std::sinh(y[i] / earth_radius)) * 180 / M_PI;
+    }
+}
+
+static auto web_mercator_tile(int zoom, int tile_x, int tile_y) -> EbvReprojector::Bounds {
+    const double extent = M_PI * earth_radius;
+    const double tile_size = 2 * extent / std::pow(2, zoom);
+    return EbvReprojector::Bounds{
+            .min_x = -extent + tile_x * tile_size,
+            .min_y = extent - (tile_y + 1) * tile_size,
+            .max_x = -extent + (tile_x + 1) * tile_size,
+            .max_y = extent - tile_y * tile_size,
+    };
+}
+
+TEST(EbvReprojector, GeoReference) { // NOLINT(cert-err58-cpp)
+    const std::string path = test_util::get_data_dir() + "48/netcdf/cSAR_idiv_v1.nc";
+
+    const auto geo_reference = NetCdfParser(path).geo_reference();
+    EXPECT_EQ(geo_reference, (NetCdfParser::NetCdfGeoReference{
+            .origin_x = -180,
+            .origin_y = 90,
+            .pixel_width = 1,
+            .pixel_height = -1,
+            .width = 360,
+            .height = 180,
+    }));
+
+    const auto metadata = EbvMetadataCache::parse(path);
+    ASSERT_TRUE(metadata->has_geo_reference);
+    EXPECT_EQ(EbvMetadataCache::FileMetadata::from_json(metadata->to_json()).geo_reference, geo_reference);
+}
+
+TEST(EbvReprojector, Grid) { // NOLINT(cert-err58-cpp)
+    const NetCdfParser::NetCdfGeoReference source{
+            .origin_x = -180, .origin_y = 90, .pixel_width = 1, .pixel_height = -1, .width = 360, .height = 180,
+    };
+
+    size_t transformed = 0;
+    const auto transform = [&transformed](size_t count, double *x, double *y) {
+        transformed += count;
+        web_mercator_to_wgs84(count, x, y);
+    };
+
+    for (const auto &tile : {web_mercator_tile(0, 0, 0), web_mercator_tile(2, 1, 0), web_mercator_tile(4, 8, 5)}) {
+        transformed = 0;
+        const auto exact = EbvReprojector::compute_grid(source, tile, 256, 256, transform, 1);
+        EXPECT_GE(transformed, 256 * 256);
+
+        transformed = 0;
+        const auto interpolated = EbvReprojector::compute_grid(source, tile, 256, 256, transform, 16);
+        EXPECT_LT(transformed, 256 * 256);
+
+        double max_error = 0;
+        for (size_t i = 0; i < exact.columns.size(); ++i) {
+            max_error = std::max(max_error, std::abs(exact.columns[i] - interpolated.columns[i]));
+            max_error = std::max(max_error, std::abs(exact.rows[i] - interpolated.rows[i]));
+        }
+        EXPECT_LE(max_error, 0.25);
+    }
+
+    // the center of the world tile is the center of the grid
+    const auto world = EbvReprojector::compute_grid(source, web_mercator_tile(0, 0, 0), 2, 2, transform, 16);
+    EXPECT_NEAR(world.columns[0], 90, 1e-9);
+    EXPECT_NEAR(world.columns[1], 270, 1e-9);
+    EXPECT_NEAR(world.rows[0], 180 - world.rows[2], 1e-9);
+
+    // pixels that can not be transformed stay NaN
+    const auto half = EbvReprojector::compute_grid(source, web_mercator_tile(0, 0, 0), 64, 64, [](size_t count, double *x, double *y) {
+        web_mercator_to_wgs84(count, x, y);
+        for (size_t i = 0; i < count; ++i) {
+            if (x[i] > 0) {
+                x[i] = y[i] = NAN;
+            }
+        }
+    }, 16);
+    EXPECT_FALSE(std::isnan(half.columns[31]));
+    EXPECT_TRUE(std::isnan(half.columns[32]));
+    EXPECT_TRUE(std::isnan(half.rows[64 * 64 - 1]));
+
+    const auto window = half.source_window(source.width, source.height);
+    EXPECT_EQ(window.x_offset, 2); // the first pixel center is at 177.1875 degrees west
+    EXPECT_EQ(window.x_offset + window.width, 178);
+    EXPECT_GT(window.y_offset, 0);
+    EXPECT_LT(window.y_offset + window.height, 180);
+}
+
+TEST(EbvReprojector, Cache) { // NOLINT(cert-err58-cpp)
+    // only EPSG codes, no files, URLs or PROJ strings
+    EXPECT_THROW(CrsCache::Transformation("/etc/passwd", "EPSG:4326"), CrsCache::CrsCacheException);
+    EXPECT_THROW(CrsCache::Transformation("EPSG:4326", "+proj=merc"), CrsCache::CrsCacheException);
+    EXPECT_THROW(CrsCache::Transformation("EPSG:", "EPSG:4326"), CrsCache::CrsCacheException);
+    EXPECT_THROW(CrsCache::Transformation("EPSG:4326", "EPSG:3857x"), CrsCache::CrsCacheException);
+
+    const NetCdfParser::NetCdfGeoReference source{
+            .origin_x = -180, .origin_y = 90, .pixel_width = 1, .pixel_height = -1, .width = 360, .height = 180,
+    };
+
+    // room for two grids of 64 x 64 pixels
+    const size_t grid_bytes = 64 * 64 * 2 * sizeof(double) + sizeof(EbvReprojector::CoordinateGrid);
+    EbvReprojector reprojector(2 * grid_bytes, 16);
+    const auto grid = [&](int tile_x) {
+        return reprojector.grid("EPSG:4326", source, "epsg:3857", web_mercator_tile(1, tile_x, 0), 64, 64);
+    };
+
+    const auto first = grid(0);
+    EXPECT_EQ(grid(0), first);
+    const auto second = grid(1);
+    EXPECT_EQ(grid(0), first);
+
+    grid(0); // the second one is the least recently used
+    reprojector.grid("EPSG:4326", source, "EPSG:3857", web_mercator_tile(1, 0, 1), 64, 64);
+    EXPECT_EQ(grid(0), first);
+    EXPECT_NE(grid(1), second);
+
+    // grids beyond the bound are not cached at all
+    const auto large = reprojector.grid("EPSG:4326", source, "EPSG:3857", web_mercator_tile(0, 0, 0), 128, 128);
+    EXPECT_NE(reprojector.grid("EPSG:4326", source, "EPSG:3857", web_mercator_tile(0, 0, 0), 128, 128), large);
+}
+
+TEST(EbvReprojector, Resample) { // NOLINT(cert-err58-cpp)
+    EbvReprojector::CoordinateGrid grid{3, 1, {10.2, 11.9, NAN}, {20.5, 21.0, 20.0}};
+
+    const auto window = grid.source_window(100, 100);
+    EXPECT_EQ(window.x_offset, 10);
+    EXPECT_EQ(window.y_offset, 20);
+    EXPECT_EQ(window.width, 2);
+    EXPECT_EQ(window.height, 2);
+
+    EbvRasterReader::Tile tile{window, false, {1, 2, 3, 4}, -1};
+    EXPECT_EQ(EbvReprojector::resample(grid, tile), (std::vector<float>{1, 4, -1}));
+
+    tile.is_empty = true;
+    EXPECT_EQ(EbvReprojector::resample(grid, tile), (std::vector<float>{-1, -1, -1}));
+
+    EXPECT_EQ(grid.source_window(5, 5).width, 0);
+}
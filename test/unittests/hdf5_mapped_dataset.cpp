@@ -0,0 +1,153 @@
+#include <gtest/gtest.h>
+#include <util/ebv_raster_reader.h>
+#include <util/hdf5_mapped_dataset.h>
+#include "util.h"
+
+#include <cmath>
+#include <cstdio>
+
+/// Writes a contiguous (2, 3, 4) float grid and a packed int16 grid of the same shape
+static void write_contiguous_grids(const std::string &path) {
+    H5::H5File file(path, H5F_ACC_TRUNC);
+
+    const hsize_t dimensions[3] = {2, 3, 4};
+    const H5::DataSpace space(3, dimensions);
+
+    std::vector<float> values(2 * 3 * 4);
+    for (size_t i = 0; i < values.size(); ++i) {
+        values[i] = static_cast<float>(i) * .5f;
+    }
+    const float fill_value = -9999.f;
+    values[5] = fill_value;
+
+    auto entity = file.createGroup("scenario").createDataSet("entity", H5::PredType::NATIVE_FLOAT, space);
+    entity.write(values.data(), H5::PredType::NATIVE_FLOAT);
+    entity.createAttribute("_FillValue", H5::PredType::NATIVE_FLOAT, H5::DataSpace(H5S_SCALAR))
+            .write(H5::PredType::NATIVE_FLOAT, &fill_value);
+
+    std::vector<int16_t> packed_values(2 * 3 * 4);
+    for (size_t i = 0; i < packed_values.size(); ++i) {
+        packed_values[i] = static_cast<int16_t>(i * 10);
+    }
+    const double scale_factor = .1;
+
+    auto packed = file.openGroup("scenario").createDataSet("packed", H5::PredType::NATIVE_INT16, space);
+    packed.write(packed_values.data(), H5::PredType::NATIVE_INT16);
+    packed.createAttribute("scale_factor", H5::PredType::NATIVE_DOUBLE, H5::DataSpace(H5S_SCALAR))
+            .write(H5::PredType::NATIVE_DOUBLE, &scale_factor);
+}
+
+TEST(Hdf5MappedDataset, cSAR) { // NOLINT(cert-err58-cpp)
+    const auto path = test_util::get_data_dir() + "48/netcdf/cSAR_idiv_v1.nc";
+    const H5::H5File file(path, H5F_ACC_RDONLY);
+
+    for (const auto &name : {"lat", "lon"}) {
+        const auto dataset = file.openDataSet(name);
+        const auto mapping = Hdf5MappedDataset::map(path, dataset);
+        ASSERT_NE(mapping, nullptr);
+        ASSERT_EQ(mapping->numeric_type(), Hdf5TypedReader::NumericType::Float);
+
+        const auto expected = Hdf5TypedReader::read_dataset<float>(dataset);
+        ASSERT_EQ(mapping->dimensions(), (std::vector<size_t>{expected.size()}));
+        EXPECT_EQ(std::vector<float>(mapping->values<float>(), mapping->values<float>() + expected.size()), expected);
+    }
+
+    // chunked and compressed
+    EXPECT_EQ(Hdf5MappedDataset::map(path, file.openDataSet("past/mean/A")), nullptr);
+    EXPECT_EQ(Hdf5MappedDataset::map(path, file.openDataSet("time")), nullptr);
+
+    // the file mapping is shared
+    EXPECT_EQ(Hdf5MappedDataset::MappedFile::open(path), Hdf5MappedDataset::MappedFile::open(path));
+}
+
+TEST(Hdf5MappedDataset, ReplacedFile) { // NOLINT(cert-err58-cpp)
+    const std::string path = std::string(P_tmpdir) + "/mapping_ebv_mapped_dataset_replaced_test.nc";
+    const std::string replacement = path + ".new";
+    write_contiguous_grids(path);
+    write_contiguous_grids(replacement);
+
+    const auto file = Hdf5MappedDataset::MappedFile::open(path);
+    ASSERT_NE(file, nullptr);
+
+    // same size and maybe the same modification time, but another inode
+    ASSERT_EQ(std::rename(replacement.c_str(), path.c_str()), 0);
+    const auto replaced_file = Hdf5MappedDataset::MappedFile::open(path);
+    ASSERT_NE(replaced_file, nullptr);
+    EXPECT_NE(replaced_file, file);
+    EXPECT_EQ(Hdf5MappedDataset::MappedFile::open(path), replaced_file);
+
+    std::remove(path.c_str());
+}
+
+TEST(Hdf5MappedDataset, RasterReader) { // NOLINT(cert-err58-cpp)
+    const std::string path = std::string(P_tmpdir) + "/mapping_ebv_mapped_dataset_test.nc";
+    write_contiguous_grids(path);
+
+    const EbvRasterReader reader(path);
+
+    const auto tile = reader.read({"scenario", "entity"}, 0, {1, 1, 2, 2});
+    ASSERT_EQ(tile.values.size(), 4);
+    EXPECT_TRUE(std::isnan(tile.values[0]));
+    EXPECT_EQ(tile.values[1], 3.f);
+    EXPECT_EQ(tile.values[2], 4.5f);
+    EXPECT_EQ(tile.values[3], 5.f);
+
+    const auto packed_tile = reader.read({"scenario", "packed"}, 1, {0, 2, 4, 1});
+    ASSERT_EQ(packed_tile.values.size(), 4);
+    EXPECT_FLOAT_EQ(packed_tile.values[0], 20.f);
+    EXPECT_FLOAT_EQ(packed_tile.values[3], 23.f);
+
+    const auto second_tile = reader.read({"scenario", "entity"}, 1, {2, 1, 2, 2});
+    EXPECT_EQ(second_tile.values, (std::vector<float>{9.f, 9.5f, 11.f, 11.5f}));
+
+    EXPECT_THROW(reader.read({"scenario", "entity"}, 0, {3, 0, 2, 1}), EbvRasterReader::EbvRasterReaderException);
+
+    std::remove(path.c_str());
+}
+
+TEST(Hdf5MappedDataset, Misaligned) { // NOLINT(cert-err58-cpp)
+    const std::string path = std::string(P_tmpdir) + "/mapping_ebv_mapped_dataset_misaligned_test.nc";
+    {
+        H5::H5File file(path, H5F_ACC_TRUNC);
+
+        // storage is allocated one after another, so an odd number of bytes shifts the next dataset
+        H5::DSetCreatPropList creation_properties;
+        creation_properties.setAllocTime(H5D_ALLOC_TIME_EARLY);
+
+        const hsize_t padding_dimensions[1] = {3};
+        const std::vector<int8_t> padding{1, 2, 3};
+        file.createDataSet("padding", H5::PredType::NATIVE_INT8, H5::DataSpace(1, padding_dimensions), creation_properties)
+                .write(padding.data(), H5::PredType::NATIVE_INT8);
+
+        const hsize_t dimensions[3] = {1, 2, 3};
+        const std::vector<float> values{1, 2, 3, 4, 5, 6};
+        file.createDataSet("entity", H5::PredType::NATIVE_FLOAT, H5::DataSpace(3, dimensions), creation_properties)
+                .write(values.data(), H5::PredType::NATIVE_FLOAT);
+
+        // 3 + 24 bytes before it
+        const std::vector<int16_t> packed_values{10, 20, 30, 40, 50, 60};
+        auto packed = file.createDataSet("packed", H5::PredType::NATIVE_INT16, H5::DataSpace(3, dimensions), creation_properties);
+        packed.write(packed_values.data(), H5::PredType::NATIVE_INT16);
+        const double scale_factor = .5;
+        packed.createAttribute("scale_factor", H5::PredType::NATIVE_DOUBLE, H5::DataSpace(H5S_SCALAR))
+                .write(H5::PredType::NATIVE_DOUBLE, &scale_factor);
+    }
+
+    const H5::H5File file(path, H5F_ACC_RDONLY);
+    const auto mapping = Hdf5MappedDataset::map(path, file.openDataSet("entity"));
+    ASSERT_NE(mapping, nullptr);
+    ASSERT_NE(reinterpret_cast<uintptr_t>(mapping->data()) % alignof(float), 0);
+
+    const EbvRasterReader reader(path);
+    const auto tile = reader.read({"entity"}, 0, {1, 0, 2, 2});
+    EXPECT_EQ(tile.values, (std::vector<float>{2, 3, 5, 6}));
+
+    const auto packed_mapping = Hdf5MappedDataset::map(path, file.openDataSet("packed"));
+    ASSERT_NE(packed_mapping, nullptr);
+    ASSERT_NE(reinterpret_cast<uintptr_t>(packed_mapping->data()) % alignof(int16_t), 0);
+
+    const auto packed_tile = reader.read({"packed"}, 0, {0, 0, 2, 2});
+    EXPECT_EQ(packed_tile.values, (std::vector<float>{5, 10, 20, 25}));
+
+    std::remove(path.c_str());
+}
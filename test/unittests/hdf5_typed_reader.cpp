@@ -0,0 +1,132 @@
+#include <gtest/gtest.h>
+#include <util/hdf5_typed_reader.h>
+#include "util.h"
+
+/// Creates a file that only lives in memory
+static auto create_in_memory_file(const std::string &name) -> H5::H5File {
+    H5::FileAccPropList file_access;
+    file_access.setCore(1 << 16, false);
+    return H5::H5File(name, H5F_ACC_TRUNC, H5::FileCreatPropList::DEFAULT, file_access);
+}
+
+TEST(Hdf5TypedReader, cSAR) { // NOLINT(cert-err58-cpp)
+    const H5::H5File file(test_util::get_data_dir() + "48/netcdf/cSAR_idiv_v1.nc", H5F_ACC_RDONLY);
+
+    const auto time = file.openDataSet("time");
+    EXPECT_EQ(Hdf5TypedReader::numeric_type(time.getDataType()), Hdf5TypedReader::NumericType::Float);
+    EXPECT_EQ(Hdf5TypedReader::read_dataset<double>(time),
+              (std::vector<double>{18262, 21914, 25567, 29219, 32872, 36524, 40177, 43829, 47482, 51134, 54787, 56613}));
+    EXPECT_EQ(Hdf5TypedReader::read_dataset<int32_t>(time)[11], 56613);
+
+    const auto value_range = Hdf5TypedReader::read_attribute<double>(file.openGroup("past/mean").openAttribute("value_range"));
+    ASSERT_EQ(value_range.size(), 2);
+    EXPECT_DOUBLE_EQ(value_range[0], -31.24603271484375);
+    EXPECT_DOUBLE_EQ(value_range[1], 31.14495849609375);
+
+    EXPECT_THROW(Hdf5TypedReader::read_attribute<double>(file.openAttribute("ebv_class")),
+                 Hdf5TypedReader::Hdf5TypedReaderException);
+}
+
+TEST(Hdf5TypedReader, Hyperslab) { // NOLINT(cert-err58-cpp)
+    const H5::H5File file(test_util::get_data_dir() + "48/netcdf/cSAR_idiv_v1.nc", H5F_ACC_RDONLY);
+
+    const auto entity = file.openDataSet("past/mean/A");
+    const auto all_values = Hdf5TypedReader::read_dataset<float>(entity);
+
+    H5::DataSpace file_space = entity.getSpace();
+    const hsize_t offset[3] = {3, 90, 180};
+    const hsize_t count[3] = {1, 2, 4};
+    file_space.selectHyperslab(H5S_SELECT_SET, count, offset);
+
+    std::vector<double> window(8);
+    Hdf5TypedReader::read_dataset(entity, window.data(), file_space);
+
+    for (size_t y = 0; y < 2; ++y) {
+        for (size_t x = 0; x < 4; ++x) {
+            EXPECT_DOUBLE_EQ(window[y * 4 + x], all_values[(3 * 180 + 90 + y) * 360 + 180 + x]);
+        }
+    }
+}
+
+TEST(Hdf5TypedReader, PackedUInt8) { // NOLINT(cert-err58-cpp)
+    auto file = create_in_memory_file("packed_uint8.h5");
+
+    const hsize_t size = 4;
+    const std::vector<uint8_t> values{0, 1, 255, 100};
+    auto dataset = file.createDataSet("packed", H5::PredType::STD_U8LE, H5::DataSpace(1, &size));
+    dataset.write(values.data(), H5::PredType::NATIVE_UINT8);
+
+    const auto write_attribute = [&dataset](const std::string &name, double value) {
+        dataset.createAttribute(name, H5::PredType::IEEE_F64LE, H5::DataSpace(H5S_SCALAR))
+                .write(H5::PredType::NATIVE_DOUBLE, &value);
+    };
+    write_attribute("scale_factor", 0.5);
+    write_attribute("add_offset", -10);
+    write_attribute("_FillValue", 255);
+
+    const auto packing = Hdf5TypedReader::packing(dataset);
+    EXPECT_DOUBLE_EQ(packing.scale_factor, 0.5);
+    EXPECT_DOUBLE_EQ(packing.add_offset, -10);
+    EXPECT_TRUE(packing.has_fill_value);
+
+    EXPECT_EQ(Hdf5TypedReader::read_dataset_unpacked<float>(dataset, packing, -9999.f),
+              (std::vector<float>{-10, -9.5, -9999, 40}));
+    EXPECT_EQ(Hdf5TypedReader::read_dataset_unpacked<int8_t>(dataset, packing, int8_t(-128)),
+              (std::vector<int8_t>{-10, -9, -128, 40}));
+
+    const auto unpacked = Hdf5TypedReader::read_dataset_unpacked<double>(dataset, packing);
+    EXPECT_TRUE(std::isnan(unpacked[2]));
+}
+
+TEST(Hdf5TypedReader, PackedInt16) { // NOLINT(cert-err58-cpp)
+    auto file = create_in_memory_file("packed_int16.h5");
+
+    const hsize_t size = 3;
+    const std::vector<int16_t> values{-32767, 1000, -32768};
+    auto dataset = file.createDataSet("packed", H5::PredType::STD_I16BE, H5::DataSpace(1, &size));
+    dataset.write(values.data(), H5::PredType::NATIVE_INT16);
+
+    Hdf5TypedReader::Packing packing;
+    packing.scale_factor = 0.01;
+    packing.has_fill_value = true;
+    packing.fill_value = -32768;
+
+    const auto unpacked = Hdf5TypedReader::read_dataset_unpacked<float>(dataset, packing);
+    EXPECT_FLOAT_EQ(unpacked[0], -327.67f);
+    EXPECT_FLOAT_EQ(unpacked[1], 10.f);
+    EXPECT_TRUE(std::isnan(unpacked[2]));
+
+    EXPECT_EQ(Hdf5TypedReader::read_dataset<int64_t>(dataset), (std::vector<int64_t>{-32767, 1000, -32768}));
+}
+
+TEST(Hdf5TypedReader, Half) { // NOLINT(cert-err58-cpp)
+    auto file = create_in_memory_file("half.h5");
+
+    H5::FloatType half_type(H5::PredType::IEEE_F32LE);
+    half_type.setFields(15, 10, 5, 0, 10);
+    half_type.setOffset(0);
+    half_type.setPrecision(16);
+    half_type.setSize(2);
+    half_type.setEbias(15);
+
+    const hsize_t size = 5;
+    const std::vector<uint16_t> values{0x3c00, 0xc000, 0x3555, 0x0001, 0x7c00}; // 1, -2, ~1/3, smallest subnormal, inf
+    auto dataset = file.createDataSet("half", half_type, H5::DataSpace(1, &size));
+    dataset.write(values.data(), half_type);
+
+    EXPECT_EQ(Hdf5TypedReader::numeric_type(dataset.getDataType()), Hdf5TypedReader::NumericType::Half);
+
+    const auto converted = Hdf5TypedReader::read_dataset<float>(dataset);
+    EXPECT_FLOAT_EQ(converted[0], 1.f);
+    EXPECT_FLOAT_EQ(converted[1], -2.f);
+    EXPECT_NEAR(converted[2], 1. / 3., 1e-3);
+
+    Hdf5TypedReader::Packing packing;
+    packing.scale_factor = 2;
+
+    const auto unpacked = Hdf5TypedReader::read_dataset_unpacked<double>(dataset, packing);
+    EXPECT_DOUBLE_EQ(unpacked[0], 2.);
+    EXPECT_DOUBLE_EQ(unpacked[1], -4.);
+    EXPECT_DOUBLE_EQ(unpacked[3], 2. * 5.960464477539063e-8);
+    EXPECT_TRUE(std::isinf(unpacked[4]));
+}
@@ -0,0 +1,160 @@
+#include <gtest/gtest.h>
+#include <util/ebv_response_cache.h>
+#include <util/http_compression.h>
+#include "util.h"
+
+#include <cstdlib>
+#include <sstream>
+
+/// Decompress a gzip or zlib stream
+static auto inflate_all(const std::string &compressed) -> std::string {
+    z_stream stream{};
+    EXPECT_EQ(inflateInit2(&stream, 15 + 32), Z_OK); // detects both headers
+
+    stream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(compressed.data()));
+    stream.avail_in = static_cast<uInt>(compressed.size());
+
+    std::string data;
+    char output[4096];
+    int status;
+    do {
+        stream.next_out = reinterpret_cast<Bytef *>(output);
+        stream.avail_out = sizeof(output);
+        status = inflate(&stream, Z_NO_FLUSH);
+        data.append(output, sizeof(output) - stream.avail_out);
+    } while (status == Z_OK);
+
+    EXPECT_EQ(status, Z_STREAM_END);
+    inflateEnd(&stream);
+    return data;
+}
+
+static auto json_body(size_t entries) -> std::string {
+    std::string data = "[";
+    for (size_t i = 0; i < entries; ++i) {
+        data += "{\"name\":\"entity " + std::to_string(i) + "\",\"description\":\"Changes in species richness\"},";
+    }
+    data.back() = ']';
+    return data;
+}
+
+TEST(HttpCompression, Negotiate) { // NOLINT(cert-err58-cpp)
+    using Encoding = HttpCompression::Encoding;
+
+    EXPECT_EQ(HttpCompression::negotiate(""), Encoding::Identity);
+    EXPECT_EQ(HttpCompression::negotiate("br"), Encoding::Identity);
+    EXPECT_EQ(HttpCompression::negotiate("gzip, deflate, br"), Encoding::Gzip);
+    EXPECT_EQ(HttpCompression::negotiate("deflate, gzip"), Encoding::Gzip);
+    EXPECT_EQ(HttpCompression::negotiate("gzip;q=0.5, deflate"), Encoding::Deflate);
+    EXPECT_EQ(HttpCompression::negotiate("DEFLATE ; q=0.8"), Encoding::Deflate);
+    EXPECT_EQ(HttpCompression::negotiate("x-gzip"), Encoding::Gzip);
+    EXPECT_EQ(HttpCompression::negotiate("gzip;q=0, deflate;q=0"), Encoding::Identity);
+    EXPECT_EQ(HttpCompression::negotiate("*"), Encoding::Gzip);
+    EXPECT_EQ(HttpCompression::negotiate("gzip;q=0, *"), Encoding::Deflate);
+
+    // the header is taken from the environment of the request, not from the one of the process
+    setenv("HTTP_ACCEPT_ENCODING", "gzip", 1);
+    const char *const without_header[] = {"QUERY_STRING=request=subgroups", nullptr};
+    EXPECT_EQ(HttpCompression::negotiate_environment(without_header), Encoding::Identity);
+    EXPECT_EQ(HttpCompression::negotiate_environment(nullptr), Encoding::Identity);
+    unsetenv("HTTP_ACCEPT_ENCODING");
+    const char *const with_header[] = {"HTTP_ACCEPT=*/*", "HTTP_ACCEPT_ENCODING=gzip;q=0.5, deflate", nullptr};
+    EXPECT_EQ(HttpCompression::negotiate_environment(with_header), Encoding::Deflate);
+
+    EXPECT_EQ(HttpCompression::name(Encoding::Gzip), "gzip");
+    EXPECT_EQ(HttpCompression::name(Encoding::Deflate), "deflate");
+}
+
+TEST(HttpCompression, Stream) { // NOLINT(cert-err58-cpp)
+    using Encoding = HttpCompression::Encoding;
+
+    const auto data = json_body(10000);
+
+    for (const auto encoding : {Encoding::Gzip, Encoding::Deflate}) {
+        const auto compressed = HttpCompression::compress(data, encoding);
+        EXPECT_LT(compressed.size(), data.size() / 10);
+        EXPECT_EQ(inflate_all(compressed), data);
+        EXPECT_EQ(static_cast<unsigned char>(compressed[0]) == 0x1f, encoding == Encoding::Gzip);
+    }
+
+    const auto stream = [](const std::string &body, size_t threshold, Encoding &started) -> std::string {
+        std::ostringstream sink;
+        HttpCompression::StreamBuffer buffer(sink, Encoding::Gzip, threshold, 6, [&](Encoding encoding) {
+            EXPECT_TRUE(sink.str().empty()); // before the first byte
+            started = encoding;
+        });
+        std::ostream output(&buffer);
+        for (const auto c : body) { // in small writes
+            output.put(c);
+        }
+        buffer.finish();
+        return sink.str();
+    };
+
+    Encoding started = Encoding::Deflate;
+    EXPECT_EQ(stream("{\"result\":true}", 1024, started), "{\"result\":true}");
+    EXPECT_EQ(started, Encoding::Identity);
+
+    EXPECT_EQ(inflate_all(stream(data, 1024, started)), data);
+    EXPECT_EQ(started, Encoding::Gzip);
+}
+
+TEST(EbvResponseCache, Variants) { // NOLINT(cert-err58-cpp)
+    using Encoding = HttpCompression::Encoding;
+
+    const std::string file = test_util::get_data_dir() + "48/netcdf/cSAR_idiv_v1.nc";
+    const auto data = json_body(1000);
+
+    EbvResponseCache cache(1u << 20u, 1024, 6);
+
+    EbvResponseCache::Body body;
+    EXPECT_FALSE(cache.get("subgroups", file, Encoding::Gzip, body));
+
+    body = cache.put("subgroups", FileStatus::of(file), data, Encoding::Gzip);
+    EXPECT_EQ(body.encoding, Encoding::Gzip);
+    EXPECT_EQ(inflate_all(*body.data), data);
+    const auto stored_bytes = cache.size_in_bytes();
+    EXPECT_EQ(stored_bytes, data.size() + body.data->size());
+
+    // a hit returns the stored variant
+    EbvResponseCache::Body hit;
+    ASSERT_TRUE(cache.get("subgroups", file, Encoding::Gzip, hit));
+    EXPECT_EQ(hit.data, body.data);
+
+    ASSERT_TRUE(cache.get("subgroups", file, Encoding::Identity, hit));
+    EXPECT_EQ(*hit.data, data);
+
+    // a missing variant is compressed once and stored
+    ASSERT_TRUE(cache.get("subgroups", file, Encoding::Deflate, hit));
+    EXPECT_EQ(hit.encoding, Encoding::Deflate);
+    EXPECT_EQ(inflate_all(*hit.data), data);
+    EbvResponseCache::Body second_hit;
+    ASSERT_TRUE(cache.get("subgroups", file, Encoding::Deflate, second_hit));
+    EXPECT_EQ(second_hit.data, hit.data);
+    EXPECT_GT(cache.size_in_bytes(), stored_bytes);
+    const auto subgroups_bytes = cache.size_in_bytes();
+
+    // small bodies are not compressed
+    body = cache.put("small", FileStatus::of(file), "{\"result\":true}", Encoding::Gzip);
+    EXPECT_EQ(body.encoding, Encoding::Identity);
+    EXPECT_EQ(*body.data, "{\"result\":true}");
+
+    // the least recently used entry is evicted first
+    cache.configure(subgroups_bytes + data.size(), 1024, 6);
+    ASSERT_TRUE(cache.get("subgroups", file, Encoding::Identity, hit));
+    cache.put("other", FileStatus::of(file), data, Encoding::Identity);
+    EXPECT_TRUE(cache.get("subgroups", file, Encoding::Identity, hit));
+    EXPECT_FALSE(cache.get("small", file, Encoding::Identity, hit));
+    EXPECT_TRUE(cache.get("other", file, Encoding::Identity, hit));
+    EXPECT_EQ(cache.size_in_bytes(), subgroups_bytes + data.size());
+
+    cache.clear();
+    EXPECT_EQ(cache.size_in_bytes(), 0);
+    EXPECT_FALSE(cache.get("subgroups", file, Encoding::Gzip, hit));
+
+    // a body that was derived from an older version of the file is never served
+    FileStatus read_status = FileStatus::of(file);
+    ++read_status.modification_nanoseconds;
+    cache.put("subgroups", read_status, data, Encoding::Identity);
+    EXPECT_FALSE(cache.get("subgroups", file, Encoding::Identity, hit));
+}